@@ -0,0 +1,1565 @@
+/*
+ * Benchmarks for the native SVF10 pipeline: filter kernels, the fused
+ * preprocessing pipeline, block statistics, SPI payload unpacking, image
+ * conversion, capture from the simulated sensor and, when a host build of
+ * libBMF is available, quality, template extraction and verification.
+ *
+ * Host build (see app/CMakeLists.txt):
+ *   cmake -S app -B build && cmake --build build && build/svf10-bench
+ *
+ * Every vector or fused path is checked against its scalar reference before
+ * it is timed; a mismatch fails the benchmark instead of reporting a number.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <string>
+#include <benchmark/benchmark.h>
+#include "svf10_filter.h"
+#include "svf10_pipeline.h"
+#include "svf10_stats.h"
+#include "svf10_descriptor.h"
+#include "svf10_crc32.h"
+#include "svf10_unpack.h"
+#include "svf10_convert.h"
+#include "svf10_device.h"
+#include "svf10_capture.h"
+#include "svf10_image_pool.h"
+#include "svf10_imagemem.h"
+#include "svf10_sim.h"
+
+#ifdef SVF10_BENCH_BMF
+#include "pb_session.h"
+#include "pb_image.h"
+#include "pb_template.h"
+#include "pb_algorithm.h"
+#include "pb_algorithm_hybrid.h"
+#include "pb_verifierI.h"
+#include "pb_quality_pb.h"
+#include "svf10_quality.h"
+#include "svf10_sensor.h"
+#include "svf10_algorithm.h"
+#include "svf10_verifier.h"
+#include "svf10_identifier.h"
+#include "svf10_identifier_sync.h"
+#include "svf10_database.h"
+#include "svf10_fpdb.h"
+#include "pb_database_multiple_file.h"
+#include "pb_crc32.h"
+#include "pb_identifier_hybrid.h"
+#include "pb_user.h"
+#include "pb_finger.h"
+#endif
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Input data ----------------------------------------------------------------*/
+
+/* A raw frame holding a synthetic ridge pattern (concentric rings with a
+ * ridge period of about 9 pixels, roughly 500 dpi) plus noise, so that
+ * histogram equalization and the BMF extractor see something finger-like. */
+static uint8_t frame[SVF10_FRAME_SIZE];
+
+/* The same pattern as a packed 96x96 image. */
+static uint8_t image[SVF10_IMAGE_SIZE];
+
+static void make_frame(uint8_t* raw, int cx, int cy, unsigned seed)
+{
+    uint8_t* pixels = SVF10_FRAME_PIXELS(raw);
+    double r;
+    int i, j, v;
+
+    srand(seed);
+    for (i = 0; i < SVF10_FRAME_SIZE; i++)
+        raw[i] = (uint8_t) rand();
+    for (i = 0; i < SVF10_IMAGE_HEIGHT; i++) {
+        for (j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+            r = sqrt((double) ((i - cy) * (i - cy) + (j - cx) * (j - cx)));
+            v = 128 + (int) (90.0 * sin(r * 2.0 * M_PI / 9.0)) + rand() % 21 - 10;
+            pixels[i * SVF10_FRAME_STRIDE + j] = (uint8_t) (v < 0 ? 0 : v > 255 ? 255 : v);
+        }
+    }
+}
+
+static void init_input(void)
+{
+    static bool done;
+    int i;
+
+    if (done)
+        return;
+    make_frame(frame, 40, 52, 1);
+    for (i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        memcpy(image + i * SVF10_IMAGE_WIDTH,
+               SVF10_FRAME_PIXELS(frame) + i * SVF10_FRAME_STRIDE, SVF10_IMAGE_WIDTH);
+    done = true;
+}
+
+/* Filter kernels ------------------------------------------------------------*/
+
+typedef void filter_fn(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride);
+
+/* Filters read the pixels straight out of the receive buffer, as FPLoop
+ * does. */
+static void BM_filter(benchmark::State& state, filter_fn* fn, filter_fn* ref)
+{
+    static uint8_t expected[SVF10_IMAGE_SIZE];
+    static uint8_t out[SVF10_IMAGE_SIZE];
+
+    init_input();
+    ref(SVF10_FRAME_PIXELS(frame), SVF10_FRAME_STRIDE, expected, SVF10_IMAGE_WIDTH);
+    fn(SVF10_FRAME_PIXELS(frame), SVF10_FRAME_STRIDE, out, SVF10_IMAGE_WIDTH);
+    if (memcmp(expected, out, sizeof(out))) {
+        state.SkipWithError("output does not match the reference");
+        return;
+    }
+
+    for (auto _ : state) {
+        fn(SVF10_FRAME_PIXELS(frame), SVF10_FRAME_STRIDE, out, SVF10_IMAGE_WIDTH);
+        benchmark::DoNotOptimize(out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel(fn == ref ? "scalar" : svf10_filter_impl());
+}
+
+BENCHMARK_CAPTURE(BM_filter, box2_ref, svf10_filter_box2_ref, svf10_filter_box2_ref);
+BENCHMARK_CAPTURE(BM_filter, box2, svf10_filter_box2, svf10_filter_box2_ref);
+BENCHMARK_CAPTURE(BM_filter, box3_ref, svf10_filter_box3_ref, svf10_filter_box3_ref);
+BENCHMARK_CAPTURE(BM_filter, box3, svf10_filter_box3, svf10_filter_box3_ref);
+BENCHMARK_CAPTURE(BM_filter, box4_ref, svf10_filter_box4_ref, svf10_filter_box4_ref);
+BENCHMARK_CAPTURE(BM_filter, box4, svf10_filter_box4, svf10_filter_box4_ref);
+BENCHMARK_CAPTURE(BM_filter, gaussian3_ref, svf10_filter_gaussian3_ref, svf10_filter_gaussian3_ref);
+BENCHMARK_CAPTURE(BM_filter, gaussian3, svf10_filter_gaussian3, svf10_filter_gaussian3_ref);
+BENCHMARK_CAPTURE(BM_filter, hist_eq_ref, svf10_filter_hist_eq_ref, svf10_filter_hist_eq_ref);
+BENCHMARK_CAPTURE(BM_filter, hist_eq, svf10_filter_hist_eq, svf10_filter_hist_eq_ref);
+
+/* Preprocessing pipeline ----------------------------------------------------*/
+
+/* The stage lists native-lib uses for FPLoop and FPgetTemp2. */
+static const svf10_stage_t fp_loop_stages[] = {
+    SVF10_STAGE_BLOCKS, SVF10_STAGE_BOX4, SVF10_STAGE_HIST_EQ
+};
+static const svf10_stage_t fp_temp_stages[] = {
+    SVF10_STAGE_BOX3, SVF10_STAGE_STATS
+};
+
+/* The same stages as separate full-image passes over reference filters. */
+static void fp_loop_ref(const uint8_t* raw, uint8_t* out)
+{
+    static uint8_t tmp[SVF10_IMAGE_SIZE];
+
+    svf10_filter_box4_ref(SVF10_FRAME_PIXELS(raw), SVF10_FRAME_STRIDE, tmp, SVF10_IMAGE_WIDTH);
+    svf10_filter_hist_eq_ref(tmp, SVF10_IMAGE_WIDTH, out, SVF10_IMAGE_WIDTH);
+}
+
+static void fp_temp_ref(const uint8_t* raw, uint8_t* out)
+{
+    svf10_filter_box3_ref(SVF10_FRAME_PIXELS(raw), SVF10_FRAME_STRIDE, out, SVF10_IMAGE_WIDTH);
+}
+
+static void BM_pipeline(benchmark::State& state, const svf10_stage_t* stages, int nstages,
+                        void (*ref)(const uint8_t* raw, uint8_t* out))
+{
+    static uint8_t expected[SVF10_IMAGE_SIZE];
+    static uint8_t out[SVF10_IMAGE_SIZE];
+    svf10_image_stats_t stats;
+    svf10_pipeline_t* pipeline;
+
+    init_input();
+    pipeline = svf10_pipeline_create(stages, nstages);
+    if (!pipeline) {
+        state.SkipWithError("svf10_pipeline_create failed");
+        return;
+    }
+    ref(frame, expected);
+    svf10_pipeline_run(pipeline, frame, out, SVF10_IMAGE_WIDTH, &stats);
+    if (memcmp(expected, out, sizeof(out))) {
+        svf10_pipeline_delete(pipeline);
+        state.SkipWithError("output does not match the reference");
+        return;
+    }
+
+    for (auto _ : state) {
+        svf10_pipeline_run(pipeline, frame, out, SVF10_IMAGE_WIDTH, &stats);
+        benchmark::DoNotOptimize(out);
+        benchmark::DoNotOptimize(stats);
+        benchmark::ClobberMemory();
+    }
+    svf10_pipeline_delete(pipeline);
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel(svf10_filter_impl());
+}
+
+static void BM_pipeline_ref(benchmark::State& state, void (*ref)(const uint8_t* raw, uint8_t* out))
+{
+    static uint8_t out[SVF10_IMAGE_SIZE];
+
+    init_input();
+    for (auto _ : state) {
+        ref(frame, out);
+        benchmark::DoNotOptimize(out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel("scalar, separate passes");
+}
+
+BENCHMARK_CAPTURE(BM_pipeline_ref, fp_loop_ref, fp_loop_ref);
+BENCHMARK_CAPTURE(BM_pipeline, fp_loop, fp_loop_stages, (int) ARRAY_SIZE(fp_loop_stages), fp_loop_ref);
+BENCHMARK_CAPTURE(BM_pipeline_ref, fp_temp_ref, fp_temp_ref);
+BENCHMARK_CAPTURE(BM_pipeline, fp_temp, fp_temp_stages, (int) ARRAY_SIZE(fp_temp_stages), fp_temp_ref);
+
+/* Block statistics ----------------------------------------------------------*/
+
+#define BLOCK_MIN_VARIANCE 10.0
+
+/* Coverage the way image_quality() would get it: a two-pass mean and
+ * variance over each block. */
+static void coverage_legacy(const uint8_t* raw, svf10_coverage_t* coverage)
+{
+    const uint8_t* src = SVF10_FRAME_PIXELS(raw);
+    const int n = SVF10_BLOCK_SIZE * SVF10_BLOCK_SIZE;
+    double mean, variance;
+    int b = 0;
+
+    coverage->blocks = 0;
+    for (int by = 0; by < SVF10_BLOCKS_Y; by++) {
+        for (int bx = 0; bx < SVF10_BLOCKS_X; bx++, b++) {
+            const uint8_t* block = src + by * SVF10_BLOCK_SIZE * SVF10_FRAME_STRIDE + bx * SVF10_BLOCK_SIZE;
+            mean = variance = 0.0;
+            for (int i = 0; i < SVF10_BLOCK_SIZE; i++)
+                for (int j = 0; j < SVF10_BLOCK_SIZE; j++)
+                    mean += block[i * SVF10_FRAME_STRIDE + j];
+            mean /= n;
+            for (int i = 0; i < SVF10_BLOCK_SIZE; i++)
+                for (int j = 0; j < SVF10_BLOCK_SIZE; j++)
+                    variance += (block[i * SVF10_FRAME_STRIDE + j] - mean) *
+                                (block[i * SVF10_FRAME_STRIDE + j] - mean);
+            coverage->covered[b] = variance / n > BLOCK_MIN_VARIANCE;
+            coverage->blocks += coverage->covered[b];
+        }
+    }
+    coverage->present = coverage->blocks >= SVF10_PRESENT_BLOCKS;
+}
+
+static void coverage_integral(const uint8_t* raw, svf10_coverage_t* coverage)
+{
+    static svf10_integral_t integral;
+
+    svf10_integral_build(&integral, SVF10_FRAME_PIXELS(raw), SVF10_FRAME_STRIDE);
+    svf10_coverage(&integral, BLOCK_MIN_VARIANCE, SVF10_PRESENT_BLOCKS, coverage);
+}
+
+static void BM_coverage(benchmark::State& state, void (*fn)(const uint8_t* raw, svf10_coverage_t* coverage))
+{
+    svf10_coverage_t expected, coverage;
+
+    init_input();
+    coverage_legacy(frame, &expected);
+    fn(frame, &coverage);
+    if (memcmp(expected.covered, coverage.covered, sizeof(coverage.covered)) ||
+        expected.blocks != coverage.blocks || expected.present != coverage.present) {
+        state.SkipWithError("coverage does not match the reference");
+        return;
+    }
+
+    for (auto _ : state) {
+        fn(frame, &coverage);
+        benchmark::DoNotOptimize(coverage);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel(std::to_string(coverage.blocks) + " blocks covered");
+}
+
+BENCHMARK_CAPTURE(BM_coverage, legacy, coverage_legacy);
+BENCHMARK_CAPTURE(BM_coverage, integral, coverage_integral);
+
+typedef uint32_t sad_fn(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride);
+
+/* Frame difference against the same pattern moved by one pixel. */
+static void BM_image_sad(benchmark::State& state, sad_fn* fn)
+{
+    static uint8_t moved[SVF10_FRAME_SIZE];
+    uint32_t sad;
+
+    init_input();
+    make_frame(moved, 41, 52, 2);
+    sad = fn(image, SVF10_IMAGE_WIDTH, SVF10_FRAME_PIXELS(moved), SVF10_FRAME_STRIDE);
+    if (sad != svf10_image_sad_ref(image, SVF10_IMAGE_WIDTH, SVF10_FRAME_PIXELS(moved), SVF10_FRAME_STRIDE)) {
+        state.SkipWithError("output does not match the reference");
+        return;
+    }
+
+    for (auto _ : state) {
+        sad = fn(image, SVF10_IMAGE_WIDTH, SVF10_FRAME_PIXELS(moved), SVF10_FRAME_STRIDE);
+        benchmark::DoNotOptimize(sad);
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel(fn == svf10_image_sad_ref ? "scalar" : svf10_stats_impl());
+}
+
+BENCHMARK_CAPTURE(BM_image_sad, ref, svf10_image_sad_ref);
+BENCHMARK_CAPTURE(BM_image_sad, impl, svf10_image_sad);
+
+/* Fingerprint descriptors ---------------------------------------------------*/
+
+static void BM_descriptor_compute(benchmark::State& state)
+{
+    svf10_descriptor_t d;
+
+    init_input();
+    for (auto _ : state) {
+        svf10_descriptor_compute(image, SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH, SVF10_IMAGE_WIDTH, &d);
+        benchmark::DoNotOptimize(d);
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+}
+
+BENCHMARK(BM_descriptor_compute);
+
+/* Ranking a gallery of descriptors of the pattern moved around the sensor,
+ * what the identifier does per probe before any full match. */
+static void BM_descriptor_rank(benchmark::State& state)
+{
+    static uint8_t raw[SVF10_FRAME_SIZE];
+    static svf10_descriptor_t gallery[1024];
+    svf10_descriptor_t probe;
+    uint32_t best;
+    int n = (int) state.range(0);
+
+    for (int i = 0; i < n; i++) {
+        make_frame(raw, 20 + i % 56, 20 + i / 56 % 56, i + 1);
+        svf10_descriptor_compute(SVF10_FRAME_PIXELS(raw), SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                 SVF10_FRAME_STRIDE, &gallery[i]);
+    }
+    init_input();
+    svf10_descriptor_compute(image, SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH, SVF10_IMAGE_WIDTH, &probe);
+
+    for (auto _ : state) {
+        best = UINT32_MAX;
+        for (int i = 0; i < n; i++) {
+            uint32_t d = svf10_descriptor_distance(&probe, &gallery[i]);
+            if (d < best)
+                best = d;
+        }
+        benchmark::DoNotOptimize(best);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_descriptor_rank)->Arg(64)->Arg(1024);
+
+/* SPI payload unpacking -----------------------------------------------------*/
+
+typedef void unpack_fn(uint8_t* dst, const uint8_t* src, size_t n);
+
+/* The loop every SPI read used to run (without its out-of-bounds write). */
+static void unpack_shifted_legacy(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    memmove(dst, src, n);
+    for (size_t i = n - 1; i > 0; i--) {
+        dst[i] = (dst[i] >> 1) | (dst[i - 1] & 0x01) << 7;
+        dst[i] = svf10_bit_reverse[dst[i]];
+    }
+    dst[0] = svf10_bit_reverse[dst[0] >> 1];
+}
+
+static void BM_unpack(benchmark::State& state, unpack_fn* fn, unpack_fn* ref, const char* impl)
+{
+    static uint8_t expected[SVF10_FRAME_SIZE];
+    static uint8_t out[SVF10_FRAME_SIZE];
+
+    init_input();
+    ref(expected, frame, sizeof(frame));
+    fn(out, frame, sizeof(frame));
+    if (memcmp(expected, out, sizeof(out))) {
+        state.SkipWithError("output does not match the reference");
+        return;
+    }
+
+    for (auto _ : state) {
+        fn(out, frame, sizeof(frame));
+        benchmark::DoNotOptimize(out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_FRAME_SIZE);
+    state.SetLabel(impl ? impl : svf10_unpack_impl());
+}
+
+BENCHMARK_CAPTURE(BM_unpack, shifted_legacy, unpack_shifted_legacy, svf10_unpack_shifted_ref, "legacy loop");
+BENCHMARK_CAPTURE(BM_unpack, shifted_ref, svf10_unpack_shifted_ref, svf10_unpack_shifted_ref, "scalar");
+BENCHMARK_CAPTURE(BM_unpack, shifted, svf10_unpack_shifted, svf10_unpack_shifted_ref, (const char*) 0);
+BENCHMARK_CAPTURE(BM_unpack, inverted_ref, svf10_unpack_inverted_ref, svf10_unpack_inverted_ref, "scalar");
+BENCHMARK_CAPTURE(BM_unpack, inverted, svf10_unpack_inverted, svf10_unpack_inverted_ref, (const char*) 0);
+
+/* CRC-32 --------------------------------------------------------------------*/
+
+typedef uint32_t crc32_fn(uint32_t crc, const void* data, size_t n);
+
+static void BM_crc32(benchmark::State& state, crc32_fn* fn, const char* impl)
+{
+    uint32_t crc = 0;
+
+    init_input();
+    if (fn(0, frame, sizeof(frame)) != svf10_crc32_ref(0, frame, sizeof(frame))) {
+        state.SkipWithError("output does not match the reference");
+        return;
+    }
+    for (auto _ : state) {
+        crc = fn(0, frame, sizeof(frame));
+        benchmark::DoNotOptimize(crc);
+    }
+    state.SetBytesProcessed(state.iterations() * sizeof(frame));
+    state.SetLabel(impl ? impl : svf10_crc32_impl());
+}
+
+BENCHMARK_CAPTURE(BM_crc32, ref, svf10_crc32_ref, "bytewise");
+BENCHMARK_CAPTURE(BM_crc32, dispatched, svf10_crc32, (const char*) 0);
+
+/* Image conversion ----------------------------------------------------------*/
+
+/* What FPLoop used to do per pixel: build an ARGB int and store it. */
+static void grey_to_rgba_legacy(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    uint32_t* out = (uint32_t*) dst;
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = 0xff000000u | (uint32_t) src[i] << 16 | (uint32_t) src[i] << 8 | src[i];
+}
+
+static void BM_grey_to_rgba(benchmark::State& state, unpack_fn* fn, const char* impl)
+{
+    static uint8_t expected[SVF10_IMAGE_SIZE * 4];
+    static uint8_t out[SVF10_IMAGE_SIZE * 4];
+
+    init_input();
+    svf10_convert_grey_to_rgba_ref(expected, image, SVF10_IMAGE_SIZE);
+    fn(out, image, SVF10_IMAGE_SIZE);
+    if (memcmp(expected, out, sizeof(out))) {
+        state.SkipWithError("output does not match the reference");
+        return;
+    }
+
+    for (auto _ : state) {
+        fn(out, image, SVF10_IMAGE_SIZE);
+        benchmark::DoNotOptimize(out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel(impl ? impl : svf10_convert_impl());
+}
+
+BENCHMARK_CAPTURE(BM_grey_to_rgba, legacy, grey_to_rgba_legacy, "legacy loop");
+BENCHMARK_CAPTURE(BM_grey_to_rgba, ref, svf10_convert_grey_to_rgba_ref, "scalar");
+BENCHMARK_CAPTURE(BM_grey_to_rgba, impl, svf10_convert_grey_to_rgba, (const char*) 0);
+
+/* Into a locked bitmap whose rows are padded, as Android may hand out. */
+static void BM_image_to_rgba(benchmark::State& state)
+{
+    enum { STRIDE = SVF10_IMAGE_WIDTH * 4 + 64 };
+    static uint8_t expected[SVF10_IMAGE_SIZE * 4];
+    static uint8_t bitmap[SVF10_IMAGE_HEIGHT * STRIDE];
+    int i;
+
+    init_input();
+    svf10_convert_grey_to_rgba_ref(expected, image, SVF10_IMAGE_SIZE);
+    svf10_convert_image_to_rgba(bitmap, STRIDE, image, SVF10_IMAGE_WIDTH);
+    for (i = 0; i < SVF10_IMAGE_HEIGHT; i++) {
+        if (memcmp(expected + i * SVF10_IMAGE_WIDTH * 4, bitmap + i * STRIDE, SVF10_IMAGE_WIDTH * 4)) {
+            state.SkipWithError("output does not match the reference");
+            return;
+        }
+    }
+
+    for (auto _ : state) {
+        svf10_convert_image_to_rgba(bitmap, STRIDE, image, SVF10_IMAGE_WIDTH);
+        benchmark::DoNotOptimize(bitmap);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * SVF10_IMAGE_SIZE);
+    state.SetLabel(svf10_convert_impl());
+}
+
+BENCHMARK(BM_image_to_rgba);
+
+/* Capture from the simulated sensor -----------------------------------------*/
+
+#define SIM_FRAMES 4
+
+/* Longest BM_sim_engine waits for a new frame, 1 s. */
+#define SIM_ENGINE_TIMEOUT_NS 1000000000LL
+
+/* The register values SenvisService passes to SpiOpen. */
+static const uint8_t sim_registers[SVF10_REG_COUNT] = {
+    0, 1, 0, 0, 0, 1, 1, 5, 0, 1, 0, 0, 100, 10, 0, 0xf0
+};
+
+/* Attaches a simulator replaying SIM_FRAMES synthetic frames with zero
+ * latency and runs SpiOpen's power-up sequence. Returns an error message,
+ * or 0. */
+static const char* sim_open(Svf10Device& device, Svf10Simulator& sim, uint8_t* frames)
+{
+    uint8_t chip_id[SVF10_CHIP_ID_SIZE];
+    uint8_t raw[SVF10_FRAME_SIZE];
+    int i;
+
+    for (i = 0; i < SIM_FRAMES; i++)
+        make_frame(frames + i * SVF10_FRAME_SIZE, 30 + 10 * i, 60 - 5 * i, i + 1);
+    if (sim.set_frames(frames, SIM_FRAMES) < 0)
+        return "Svf10Simulator::set_frames failed";
+
+    device.attach(&sim, 100000);
+    device.set_registers(sim_registers);
+    if (device.initialize(chip_id, 0, 0) < 0)
+        return "Svf10Device::initialize failed";
+    if (memcmp(chip_id + 1, "SVF10P", 6))
+        return "unexpected chip ID";
+    if (device.wait_ready(&svf10_offset_ready, SVF10_OFFSET_TIMEOUT_US, 0, 0) != 1)
+        return "offset capture not ready";
+
+    /* One round trip through the wire encoding. */
+    for (i = 0; i < SIM_FRAMES; i++) {
+        if (device.arm_capture(0) < 0
+            || device.wait_ready(&svf10_capture_ready, SVF10_CAPTURE_TIMEOUT_US, 0, 0) != 1
+            || device.read_frame_mode0(raw) < 0)
+            return "simulated capture failed";
+        if (memcmp(raw, frames + i * SVF10_FRAME_SIZE, SVF10_FRAME_SIZE))
+            return "replayed frame does not match the recording";
+    }
+    return 0;
+}
+
+/* FPLoop's synchronous path: arm, poll the status, read the frame. */
+static void BM_sim_capture(benchmark::State& state)
+{
+    static uint8_t frames[SIM_FRAMES * SVF10_FRAME_SIZE];
+    static uint8_t raw[SVF10_FRAME_SIZE];
+    Svf10Simulator sim;
+    Svf10Device device;
+    const char* error;
+
+    error = sim_open(device, sim, frames);
+    if (error) {
+        state.SkipWithError(error);
+        return;
+    }
+
+    for (auto _ : state) {
+        if (device.arm_capture(0) < 0
+            || device.wait_ready(&svf10_capture_ready, SVF10_CAPTURE_TIMEOUT_US, 0, 0) != 1
+            || device.read_frame_mode0(raw) < 0) {
+            state.SkipWithError("simulated capture failed");
+            break;
+        }
+        benchmark::DoNotOptimize(raw);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_sim_capture)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/* A frame's pixels into a pb_image_t-sized buffer: a raw read followed by
+ * the allocation and row copy pb_image_create() does, against a read
+ * decoded straight into a pooled buffer. */
+static void BM_sim_image(benchmark::State& state, bool pooled)
+{
+    static uint8_t frames[SIM_FRAMES * SVF10_FRAME_SIZE];
+    static uint8_t raw[SVF10_FRAME_SIZE];
+    Svf10Simulator sim;
+    Svf10Device device;
+    svf10_image_pool_t* pool;
+    svf10_image_buffer_t* buffer;
+    uint8_t* image;
+    const char* error;
+    int ret;
+
+    error = sim_open(device, sim, frames);
+    if (error) {
+        state.SkipWithError(error);
+        return;
+    }
+    pool = svf10_image_pool_create(1);
+    if (!pool) {
+        state.SkipWithError("svf10_image_pool_create failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        if (pooled) {
+            buffer = svf10_image_pool_get(pool);
+            ret = device.read_image_mode0(buffer->pixels);
+            benchmark::DoNotOptimize(buffer->pixels);
+            svf10_image_pool_put(buffer);
+        } else {
+            ret = device.read_frame_mode0(raw);
+            image = (uint8_t*) malloc(SVF10_IMAGE_SIZE);
+            for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+                memcpy(image + i * SVF10_IMAGE_WIDTH,
+                       SVF10_FRAME_PIXELS(raw) + i * SVF10_FRAME_STRIDE, SVF10_IMAGE_WIDTH);
+            benchmark::DoNotOptimize(image);
+            free(image);
+        }
+        if (ret < 0) {
+            state.SkipWithError("simulated read failed");
+            break;
+        }
+    }
+    svf10_image_pool_delete(pool);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_CAPTURE(BM_sim_image, copy, false)->UseRealTime();
+BENCHMARK_CAPTURE(BM_sim_image, pooled, true)->UseRealTime();
+
+/* Reads one image through svf10_imagemem streaming from the sensor,
+ * step pixels per read_pixels() call in order, as a renderer
+ * would. Returns false if a call failed. */
+static bool imagemem_read(Svf10Device& device, uint8_t* image, uint32_t step)
+{
+    svf10_imagemem_t* mem;
+    uint32_t offset, n;
+    bool ok = true;
+
+    mem = svf10_imagemem_open_device(&device);
+    if (!mem)
+        return false;
+    for (offset = 0; offset < SVF10_IMAGE_SIZE && ok; offset += n) {
+        n = SVF10_IMAGE_SIZE - offset < step ? SVF10_IMAGE_SIZE - offset : step;
+        ok = svf10_imagemem.read_pixels(mem, image + offset, offset, n) == PB_RC_OK;
+    }
+    svf10_imagemem.close(mem);
+    return ok;
+}
+
+/* The same frames read whole by read_image_mode0() first, then streamed. */
+static void BM_sim_imagemem(benchmark::State& state)
+{
+    static uint8_t frames[SIM_FRAMES * SVF10_FRAME_SIZE];
+    static uint8_t expected[SIM_FRAMES][SVF10_IMAGE_SIZE];
+    static uint8_t out[SVF10_IMAGE_SIZE];
+    const uint32_t step = (uint32_t) state.range(0);
+    Svf10Simulator sim;
+    Svf10Device device;
+    const char* error;
+    int i;
+
+    error = sim_open(device, sim, frames);
+    if (error) {
+        state.SkipWithError(error);
+        return;
+    }
+    sim.rewind();
+    for (i = 0; i < SIM_FRAMES; i++) {
+        if (device.read_image_mode0(expected[i]) < 0) {
+            state.SkipWithError("simulated read failed");
+            return;
+        }
+    }
+    for (i = 0; i < SIM_FRAMES; i++) {
+        if (!imagemem_read(device, out, step) || memcmp(out, expected[i], sizeof(out))) {
+            state.SkipWithError("streamed image does not match read_image_mode0");
+            return;
+        }
+    }
+
+    for (auto _ : state) {
+        if (!imagemem_read(device, out, step)) {
+            state.SkipWithError("streamed read failed");
+            break;
+        }
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_sim_imagemem)->Arg(SVF10_IMAGE_WIDTH)->Arg(SVF10_IMAGE_SIZE)->UseRealTime();
+
+/* The capture engine running fp_loop_stages; one iteration is one new frame
+ * taken from the ring. state.range(0) is the slice rows, 0 for whole
+ * frames. The bus runs at 10 MHz so the readout takes time to overlap;
+ * process_us is the mean time from the end of a readout to its frame being
+ * processed. Any failed read, the deselect that ends a sliced readout
+ * included, fails the benchmark. */
+static void BM_sim_engine(benchmark::State& state)
+{
+    static uint8_t frames[SIM_FRAMES * SVF10_FRAME_SIZE];
+    static const svf10_sim_timing_t timing = { 0, 800, 0, 0, 0 };
+    Svf10Simulator sim;
+    Svf10Device device;
+    Svf10Capture capture(device);
+    const svf10_frame_t* frame;
+    uint32_t last = 0;
+    int64_t since_ns;
+    double process_us = 0.0;
+    const char* error;
+
+    error = sim_open(device, sim, frames);
+    if (error) {
+        state.SkipWithError(error);
+        return;
+    }
+    sim.set_timing(&timing);
+    capture.set_slice_rows((int) state.range(0));
+    if (capture.start(fp_loop_stages, ARRAY_SIZE(fp_loop_stages), -1.0) < 0) {
+        state.SkipWithError("Svf10Capture::start failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        since_ns = svf10_monotonic_ns();
+        for (;;) {
+            frame = capture.begin_read_latest();
+            if (frame && frame->sequence != last)
+                break;
+            if (frame)
+                capture.end_read();
+            if (capture.errors() || svf10_monotonic_ns() - since_ns > SIM_ENGINE_TIMEOUT_NS)
+                break;
+            usleep(50);
+        }
+        if (!frame || frame->sequence == last) {
+            capture.stop();
+            state.SkipWithError(capture.errors() ? "Svf10Capture read failed" : "no frame from Svf10Capture");
+            return;
+        }
+        last = frame->sequence;
+        process_us += frame->process_us;
+        benchmark::DoNotOptimize(frame->image);
+        capture.end_read();
+    }
+    capture.stop();
+    if (capture.errors()) {
+        state.SkipWithError("Svf10Capture read failed");
+        return;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["process_us"] = process_us / state.iterations();
+    state.counters["dropped"] = (double) capture.dropped();
+    state.counters["errors"] = (double) capture.errors();
+}
+
+BENCHMARK(BM_sim_engine)->Arg(0)->Arg(SVF10_CAPTURE_SLICE_ROWS)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/* BMF extraction and verification -------------------------------------------*/
+
+#ifdef SVF10_BENCH_BMF
+
+/* 500 dpi, the resolution the verification paths pass for SVF10 images. */
+#define BENCH_RESOLUTION 500
+
+struct bmf_fixture {
+    pb_session_t* session;
+    pb_algorithm_t* algorithm;
+    pb_image_t* image;
+
+    bmf_fixture() : session(0), algorithm(0), image(0)
+    {
+        static uint8_t preprocessed[SVF10_IMAGE_SIZE];
+        svf10_pipeline_t* pipeline;
+
+        init_input();
+        pipeline = svf10_pipeline_create(fp_loop_stages, ARRAY_SIZE(fp_loop_stages));
+        svf10_pipeline_run(pipeline, frame, preprocessed, SVF10_IMAGE_WIDTH, 0);
+        svf10_pipeline_delete(pipeline);
+
+        session = pb_session_create();
+        algorithm = hybrid_square_xs_algorithm.create(session);
+        image = pb_image_create(SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                BENCH_RESOLUTION, BENCH_RESOLUTION,
+                                preprocessed, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN);
+    }
+
+    ~bmf_fixture()
+    {
+        pb_image_delete(image);
+        pb_algorithm_delete(algorithm);
+        pb_session_delete(session);
+    }
+};
+
+static void BM_bmf_extract(benchmark::State& state)
+{
+    bmf_fixture f;
+    pb_template_t* T;
+
+    if (!f.algorithm || !f.image) {
+        state.SkipWithError("BMF setup failed");
+        return;
+    }
+    for (auto _ : state) {
+        T = 0;
+        if (pb_algorithm_extract_template(f.algorithm, f.image, 0, &T) != PB_RC_OK) {
+            state.SkipWithError("pb_algorithm_extract_template failed");
+            break;
+        }
+        pb_template_delete(T);
+    }
+    state.SetLabel("hybrid_square_xs");
+}
+
+BENCHMARK(BM_bmf_extract)->Unit(benchmark::kMicrosecond);
+
+/* Verification of one template against state.range(0) enrolled templates,
+ * the enrolled set being the same image so every call runs to a decision. */
+static void BM_bmf_verify(benchmark::State& state)
+{
+    bmf_fixture f;
+    pb_template_t* enrolled[8];
+    pb_template_t* T = 0;
+    int n = (int) state.range(0);
+    int decision;
+    int i;
+
+    if (!f.algorithm || !f.image
+        || pb_algorithm_extract_template(f.algorithm, f.image, 0, &T) != PB_RC_OK) {
+        state.SkipWithError("BMF setup failed");
+        return;
+    }
+    for (i = 0; i < n; i++)
+        enrolled[i] = pb_template_retain(T);
+
+    for (auto _ : state) {
+        if (pb_algorithm_verify_templates(f.algorithm, enrolled, (uint8_t) n, T,
+                                          PB_FAR_50000, &decision, 0, 0, 0) != PB_RC_OK) {
+            state.SkipWithError("pb_algorithm_verify_templates failed");
+            break;
+        }
+        benchmark::DoNotOptimize(decision);
+    }
+    for (i = 0; i < n; i++)
+        pb_template_delete(enrolled[i]);
+    pb_template_delete(T);
+    state.SetLabel("hybrid_square_xs");
+}
+
+BENCHMARK(BM_bmf_verify)->Arg(1)->Arg(8)->Unit(benchmark::kMicrosecond);
+
+/* The first extraction and verification of an algorithm, as a caller
+ * without the pool gets it (Arg 0: a new session and algorithm per
+ * iteration), against the same calls on an algorithm taken from the
+ * warmed pool (Arg 1). */
+static void BM_bmf_first_verify(benchmark::State& state)
+{
+    bmf_fixture f;
+    svf10_algorithm_pool_t* pool = 0;
+    pb_session_t* session = 0;
+    pb_algorithm_t* algorithm;
+    pb_template_t* enrolled[1];
+    pb_template_t* T;
+    int pooled = (int) state.range(0);
+    int decision;
+
+    if (pooled)
+        pool = svf10_algorithm_pool_create(&hybrid_square_xs_algorithm, 1);
+    if (!f.image || (pooled && !pool)) {
+        state.SkipWithError("BMF setup failed");
+        return;
+    }
+    for (auto _ : state) {
+        if (pooled) {
+            algorithm = svf10_algorithm_pool_get(pool);
+        } else {
+            session = pb_session_create();
+            algorithm = hybrid_square_xs_algorithm.create(session);
+        }
+        T = 0;
+        if (algorithm && pb_algorithm_extract_template(algorithm, f.image, 0, &T) == PB_RC_OK) {
+            enrolled[0] = T;
+            pb_algorithm_verify_templates(algorithm, enrolled, 1, T, PB_FAR_50000,
+                                          &decision, 0, 0, 0);
+            benchmark::DoNotOptimize(decision);
+            pb_template_delete(T);
+        } else {
+            state.SkipWithError("pb_algorithm_extract_template failed");
+        }
+        if (pooled) {
+            svf10_algorithm_pool_put(pool, algorithm);
+        } else {
+            pb_algorithm_delete(algorithm);
+            pb_session_delete(session);
+        }
+        if (!T)
+            break;
+    }
+    svf10_algorithm_pool_delete(pool);
+    state.SetLabel(pooled ? "pooled" : "cold");
+}
+
+BENCHMARK(BM_bmf_first_verify)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+/* 1:N verification over a gallery of state.range(0) templates with
+ * state.range(1) threads. The gallery is impostors, templates of noise
+ * images, with the probe's own template last, so every call sweeps the
+ * whole gallery before it accepts. */
+static void BM_bmf_gallery(benchmark::State& state)
+{
+    static uint8_t noise[SVF10_IMAGE_SIZE];
+    bmf_fixture f;
+    svf10_verifier_t* verifier;
+    pb_template_t* impostors[4] = { 0, 0, 0, 0 };
+    pb_template_t* gallery[256];
+    pb_template_t* T = 0;
+    pb_image_t* image;
+    int n = (int) state.range(0);
+    int decision = 0, index = -1;
+    int i;
+
+    verifier = svf10_verifier_create(&hybrid_square_xs_algorithm, (int) state.range(1));
+    if (!verifier || !f.image
+        || pb_algorithm_extract_template(f.algorithm, f.image, 0, &T) != PB_RC_OK) {
+        state.SkipWithError("BMF setup failed");
+        svf10_verifier_delete(verifier);
+        pb_template_delete(T);
+        return;
+    }
+    srand(2);
+    for (i = 0; i < (int) ARRAY_SIZE(impostors); i++) {
+        for (int j = 0; j < SVF10_IMAGE_SIZE; j++)
+            noise[j] = (uint8_t) rand();
+        image = pb_image_create(SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                BENCH_RESOLUTION, BENCH_RESOLUTION,
+                                noise, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN);
+        pb_algorithm_extract_template(f.algorithm, image, 0, &impostors[i]);
+        pb_image_delete(image);
+    }
+    for (i = 0; i < n - 1; i++)
+        gallery[i] = impostors[i % ARRAY_SIZE(impostors)];
+    gallery[n - 1] = T;
+
+    for (i = 0; i < (int) ARRAY_SIZE(impostors); i++)
+        if (!impostors[i])
+            break;
+    if (i < (int) ARRAY_SIZE(impostors)) {
+        state.SkipWithError("impostor extraction failed");
+    } else {
+        for (auto _ : state) {
+            if (svf10_verifier_verify(verifier, gallery, n, T, PB_FAR_50000,
+                                      &decision, &index) != PB_RC_OK) {
+                state.SkipWithError("svf10_verifier_verify failed");
+                break;
+            }
+            benchmark::DoNotOptimize(decision);
+        }
+    }
+    for (i = 0; i < (int) ARRAY_SIZE(impostors); i++)
+        pb_template_delete(impostors[i]);
+    pb_template_delete(T);
+    svf10_verifier_delete(verifier);
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetLabel(std::to_string(state.range(1)) + " threads, match at " + std::to_string(index));
+}
+
+BENCHMARK(BM_bmf_gallery)->ArgsProduct({ { 8, 64, 256 }, { 1, 2, 4 } })
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/* Identification of the probe among state.range(0) templates: noise
+ * impostors carrying their images and the probe's own template. The
+ * hybrid identifier is BMF's own for comparison. */
+static void BM_bmf_identify(benchmark::State& state, const pb_identifierI* module, const char* name)
+{
+    static uint8_t noise[SVF10_IMAGE_SIZE];
+    bmf_fixture f;
+    pb_identifier_t* identifier = module->create(f.session, 1);
+    pb_template_t* gallery[256];
+    pb_finger_t* fingers[256];
+    pb_finger_t* identified = 0;
+    pb_image_t* image;
+    pb_user_t* user;
+    int n = (int) state.range(0);
+    int i;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!identifier || !f.algorithm || !f.image) {
+        state.SkipWithError("BMF setup failed");
+        pb_identifier_delete(identifier);
+        return;
+    }
+    if (module == &svf10_identifier)
+        svf10_identifier_set_algorithm(identifier, f.algorithm);
+    else
+        pb_identifier_hybrid_set_algorithm(identifier, f.algorithm);
+
+    srand(3);
+    for (i = 0; i < n; i++) {
+        for (int j = 0; j < SVF10_IMAGE_SIZE; j++)
+            noise[j] = (uint8_t) rand();
+        image = i == n - 1 ? pb_image_retain(f.image) :
+                pb_image_create(SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                BENCH_RESOLUTION, BENCH_RESOLUTION,
+                                noise, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN);
+        gallery[i] = 0;
+        if (rc == PB_RC_OK)
+            rc = pb_algorithm_extract_template(f.algorithm, image, 0, &gallery[i]);
+        if (gallery[i])
+            pb_template_set_image(gallery[i], image);
+        pb_image_delete(image);
+        user = pb_user_create(i + 1);
+        fingers[i] = pb_finger_create(PB_FINGER_POSITION_RIGHT_INDEX, user);
+        pb_user_delete(user);
+    }
+    if (rc == PB_RC_OK)
+        rc = pb_identifier_add_templates(identifier, gallery, fingers, 0, (uint16_t) n);
+
+    if (rc != PB_RC_OK) {
+        state.SkipWithError("gallery setup failed");
+    } else {
+        for (auto _ : state) {
+            pb_finger_delete(identified);
+            identified = 0;
+            if (pb_identifier_identify_template(identifier, gallery[n - 1], 0, PB_FPIR_1000,
+                                                &identified, 0, 0) != PB_RC_OK) {
+                state.SkipWithError("pb_identifier_identify_template failed");
+                break;
+            }
+            benchmark::DoNotOptimize(identified);
+        }
+        state.SetLabel(std::string(name) + (identified && pb_finger_get_user_id(identified) == (uint32_t) n ?
+                                            ", identified" : ", not identified"));
+        pb_finger_delete(identified);
+    }
+    for (i = 0; i < n; i++) {
+        pb_template_delete(gallery[i]);
+        pb_finger_delete(fingers[i]);
+    }
+    pb_identifier_delete(identifier);
+}
+
+BENCHMARK_CAPTURE(BM_bmf_identify, hybrid_identifier, &hybrid_identifier, "hybrid_identifier")
+    ->Arg(64)->Arg(256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_bmf_identify, svf10_identifier, &svf10_identifier, "svf10_identifier")
+    ->Arg(64)->Arg(256)->Unit(benchmark::kMicrosecond);
+
+/* Warm start of svf10_identifier with a gallery of state.range(0)
+ * templates: adding them, which computes every descriptor, against
+ * loading a snapshot of the same gallery. */
+static void BM_bmf_identifier_start(benchmark::State& state, bool snapshot)
+{
+    char path[] = "/tmp/svf10_bench_XXXXXX";
+    bmf_fixture f;
+    pb_identifier_t* identifier = 0;
+    pb_template_t* gallery[256];
+    pb_finger_t* fingers[256];
+    pb_user_t* user;
+    int n = (int) state.range(0);
+    int i, fd;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!f.algorithm || !f.image || (fd = mkstemp(path)) < 0) {
+        state.SkipWithError("BMF setup failed");
+        return;
+    }
+    close(fd);
+    for (i = 0; i < n; i++) {
+        gallery[i] = 0;
+        if (rc == PB_RC_OK)
+            rc = pb_algorithm_extract_template(f.algorithm, f.image, 0, &gallery[i]);
+        if (gallery[i])
+            pb_template_set_image(gallery[i], f.image);
+        user = pb_user_create(i + 1);
+        fingers[i] = pb_finger_create(PB_FINGER_POSITION_RIGHT_INDEX, user);
+        pb_user_delete(user);
+    }
+    if (rc == PB_RC_OK && snapshot) {
+        identifier = svf10_identifier.create(f.session, 1);
+        rc = identifier ? pb_identifier_add_templates(identifier, gallery, fingers, 0, (uint16_t) n)
+                        : PB_RC_MEMORY_ALLOCATION_FAILED;
+        if (rc == PB_RC_OK)
+            rc = svf10_identifier_save(identifier, path);
+        pb_identifier_delete(identifier);
+    }
+
+    if (rc != PB_RC_OK) {
+        state.SkipWithError("gallery setup failed");
+    } else {
+        for (auto _ : state) {
+            identifier = svf10_identifier.create(f.session, 1);
+            if (!identifier) {
+                state.SkipWithError("svf10_identifier.create failed");
+                break;
+            }
+            svf10_identifier_set_algorithm(identifier, f.algorithm);
+            rc = snapshot ? svf10_identifier_load(identifier, path)
+                          : pb_identifier_add_templates(identifier, gallery, fingers, 0, (uint16_t) n);
+            state.PauseTiming();
+            if (rc == PB_RC_OK && snapshot)
+                rc = svf10_identifier_check_snapshot(identifier);
+            pb_identifier_delete(identifier);
+            state.ResumeTiming();
+            if (rc != PB_RC_OK) {
+                state.SkipWithError("filling the identifier failed");
+                break;
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+    }
+    for (i = 0; i < n; i++) {
+        pb_template_delete(gallery[i]);
+        pb_finger_delete(fingers[i]);
+    }
+    remove(path);
+}
+
+BENCHMARK_CAPTURE(BM_bmf_identifier_start, add_templates, false)
+    ->Arg(64)->Arg(256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_bmf_identifier_start, snapshot, true)
+    ->Arg(64)->Arg(256)->Unit(benchmark::kMicrosecond);
+
+static int remove_entry(const char* path, const struct stat*, int, struct FTW*)
+{
+    return remove(path);
+}
+
+/* Configures module to keep its files in dir and starts a session. */
+static pb_rc_t database_start(const pb_databaseI* module, pb_session_t* session, const char* dir)
+{
+    std::string path;
+    pb_rc_t rc;
+
+    if (module == &svf10_database) {
+        svf10_database_conf_t conf = { 0, 0 };
+        path = std::string(dir) + "/svf10.db";
+        conf.db_path = path.c_str();
+        rc = svf10_database_init(session, &conf);
+    } else {
+        multiple_file_database_conf_t conf;
+        path = std::string(dir) + "/db";
+        conf.db_path = path.c_str();
+        rc = multiple_file_database_init(session, &conf);
+    }
+    return rc == PB_RC_OK ? module->start_session(session) : rc;
+}
+
+/* Cold start of a database of state.range(0) templates: starting the
+ * session and getting the template of every finger it iterates, as an
+ * identifier being filled at startup does. multiple_file_database is
+ * BMF's own for comparison. The page cache is warm, so this measures
+ * the calls made rather than the flash. */
+static void BM_bmf_database_open(benchmark::State& state, const pb_databaseI* module, const char* name)
+{
+    char dir[] = "/tmp/svf10_bench_XXXXXX";
+    bmf_fixture f;
+    pb_template_t* T = 0;
+    pb_template_t* got;
+    pb_iterator_t* it;
+    pb_finger_t* finger;
+    pb_user_t* user;
+    int n = (int) state.range(0);
+    int i, count = 0;
+    pb_rc_t rc;
+
+    if (!f.algorithm || !f.image || !mkdtemp(dir)
+        || pb_algorithm_extract_template(f.algorithm, f.image, 0, &T) != PB_RC_OK) {
+        state.SkipWithError("BMF setup failed");
+        pb_template_delete(T);
+        return;
+    }
+    rc = database_start(module, f.session, dir);
+    for (i = 0; i < n && rc == PB_RC_OK; i++) {
+        user = pb_user_create(i + 1);
+        finger = pb_finger_create(PB_FINGER_POSITION_RIGHT_INDEX, user);
+        rc = module->insert_template(f.session, T, finger);
+        pb_finger_delete(finger);
+        pb_user_delete(user);
+    }
+    module->end_session(f.session);
+    pb_template_delete(T);
+
+    if (rc != PB_RC_OK) {
+        state.SkipWithError("database setup failed");
+    } else {
+        for (auto _ : state) {
+            count = 0;
+            if (module->start_session(f.session) != PB_RC_OK
+                || module->get_finger_iterator(f.session, &it) != PB_RC_OK) {
+                state.SkipWithError("opening the database failed");
+                module->end_session(f.session);
+                break;
+            }
+            while ((finger = (pb_finger_t*) pb_iterator_next(it)) != 0) {
+                if (module->get_template(f.session, finger, &got) == PB_RC_OK) {
+                    count++;
+                    pb_template_delete(got);
+                }
+                pb_finger_delete(finger);
+            }
+            pb_iterator_delete(it);
+            module->end_session(f.session);
+        }
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetLabel(std::string(name) + ", " + std::to_string(count) + " templates");
+    }
+    nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+BENCHMARK_CAPTURE(BM_bmf_database_open, multiple_file_database, &multiple_file_database, "multiple_file_database")
+    ->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_bmf_database_open, svf10_database, &svf10_database, "svf10_database")
+    ->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+/* Enrollment updates: each iteration stores a template for one of 64
+ * fingers in turn, replacing the one stored before, and returns once the
+ * database has it. svf10_database syncs every record to disk, and
+ * compacts in the background as the replaced ones pile up. */
+static void BM_bmf_database_insert(benchmark::State& state, const pb_databaseI* module, const char* name)
+{
+    char dir[] = "/tmp/svf10_bench_XXXXXX";
+    bmf_fixture f;
+    pb_template_t* T = 0;
+    pb_finger_t* fingers[64];
+    pb_user_t* user;
+    int i = 0;
+
+    if (!f.algorithm || !f.image || !mkdtemp(dir)
+        || pb_algorithm_extract_template(f.algorithm, f.image, 0, &T) != PB_RC_OK) {
+        state.SkipWithError("BMF setup failed");
+        pb_template_delete(T);
+        return;
+    }
+    for (i = 0; i < (int) ARRAY_SIZE(fingers); i++) {
+        user = pb_user_create(i + 1);
+        fingers[i] = pb_finger_create(PB_FINGER_POSITION_RIGHT_INDEX, user);
+        pb_user_delete(user);
+    }
+    if (database_start(module, f.session, dir) != PB_RC_OK) {
+        state.SkipWithError("database setup failed");
+    } else {
+        i = 0;
+        for (auto _ : state) {
+            if (module->insert_template(f.session, T, fingers[i++ % ARRAY_SIZE(fingers)]) != PB_RC_OK) {
+                state.SkipWithError("insert_template failed");
+                break;
+            }
+        }
+        module->end_session(f.session);
+        state.SetLabel(name);
+    }
+    for (i = 0; i < (int) ARRAY_SIZE(fingers); i++)
+        pb_finger_delete(fingers[i]);
+    pb_template_delete(T);
+    nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+BENCHMARK_CAPTURE(BM_bmf_database_insert, multiple_file_database, &multiple_file_database, "multiple_file_database")
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_bmf_database_insert, svf10_database, &svf10_database, "svf10_database")
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/* Enrollment updates reaching an identifier through svf10_identifier_sync:
+ * each iteration inserts, replaces or deletes the templates of 8 of 64
+ * fingers, three acquisitions each, and waits for
+ * svf10_identifier_sync_flush(). Afterwards the identifier must hold
+ * exactly the acquisitions the database does. */
+static void BM_bmf_identifier_sync(benchmark::State& state)
+{
+    enum { USERS = 64, ACQUISITIONS = 3, BATCH = 8, FINGERS = USERS * ACQUISITIONS };
+    char dir[] = "/tmp/svf10_bench_XXXXXX";
+    bmf_fixture f;
+    pb_identifier_t* identifier = svf10_identifier.create(f.session, 1);
+    svf10_identifier_sync_t* sync = 0;
+    pb_template_t* T = 0;
+    pb_finger_t* fingers[FINGERS];
+    pb_finger_t* identified[ACQUISITIONS + 1];
+    bool stored[FINGERS] = { false };
+    pb_user_t* user;
+    unsigned step = 0;
+    uint32_t acquisition;
+    int i, k, expected, found, mismatches = 0;
+    pb_rc_t rc;
+
+    if (!identifier || !f.algorithm || !f.image || !mkdtemp(dir)
+        || pb_algorithm_extract_template(f.algorithm, f.image, 0, &T) != PB_RC_OK) {
+        state.SkipWithError("BMF setup failed");
+        pb_template_delete(T);
+        pb_identifier_delete(identifier);
+        return;
+    }
+    svf10_identifier_set_algorithm(identifier, f.algorithm);
+    for (i = 0; i < FINGERS; i++) {
+        user = pb_user_create(i / ACQUISITIONS + 1);
+        fingers[i] = pb_finger_create_acquisition(PB_FINGER_POSITION_RIGHT_INDEX, user,
+                                                  i % ACQUISITIONS + 1);
+        pb_user_delete(user);
+    }
+    if (database_start(&svf10_database, f.session, dir) != PB_RC_OK
+        || !(sync = svf10_identifier_sync_create(f.session, &svf10_database,
+                                                 identifier, &svf10_identifier))) {
+        state.SkipWithError("database setup failed");
+    } else {
+        for (auto _ : state) {
+            rc = PB_RC_OK;
+            /* A stride of 7 reaches every finger, the acquisitions of a
+             * user out of order; every third visit to a stored finger
+             * deletes it. */
+            for (k = 0; k < BATCH && rc == PB_RC_OK; k++, step++) {
+                i = (int) (step * 7 % FINGERS);
+                if (stored[i] && step % 3 == 0) {
+                    rc = svf10_database.delete_template(f.session, fingers[i]);
+                    stored[i] = false;
+                } else {
+                    rc = svf10_database.insert_template(f.session, T, fingers[i]);
+                    stored[i] = true;
+                }
+            }
+            if (rc == PB_RC_OK)
+                rc = svf10_identifier_sync_flush(sync);
+            if (rc != PB_RC_OK) {
+                state.SkipWithError("updating the database failed");
+                break;
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * BATCH);
+
+        /* The fingers of each user in the identifier against the database. */
+        for (int u = 0; u < USERS; u++) {
+            rc = pb_identifier_identify_template_rank(identifier, T, fingers[u * ACQUISITIONS],
+                                                      ACQUISITIONS + 1, identified, 0, 0, 0);
+            expected = found = 0;
+            for (k = 0; k < ACQUISITIONS; k++)
+                expected += stored[u * ACQUISITIONS + k];
+            for (k = 0; k <= ACQUISITIONS; k++) {
+                if (rc != PB_RC_OK || !identified[k])
+                    continue;
+                acquisition = pb_finger_get_acquisition(identified[k]);
+                if (acquisition >= 1 && acquisition <= ACQUISITIONS
+                    && stored[u * ACQUISITIONS + acquisition - 1])
+                    found++;
+                else
+                    mismatches++;
+                pb_finger_delete(identified[k]);
+            }
+            if (rc != PB_RC_OK || found != expected)
+                mismatches++;
+        }
+        if (mismatches)
+            state.SkipWithError("identifier out of step with the database");
+    }
+    svf10_identifier_sync_delete(sync);
+    svf10_database.end_session(f.session);
+    for (i = 0; i < FINGERS; i++)
+        pb_finger_delete(fingers[i]);
+    pb_template_delete(T);
+    pb_identifier_delete(identifier);
+    nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+BENCHMARK(BM_bmf_identifier_sync)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/* svf10_crc32 must agree with BMF's own. */
+static void BM_bmf_crc32(benchmark::State& state)
+{
+    uint32_t crc = 0;
+
+    init_input();
+    if (svf10_crc32(0, frame, sizeof(frame)) != pb_crc32(frame, sizeof(frame))) {
+        state.SkipWithError("svf10_crc32 does not match pb_crc32");
+        return;
+    }
+    for (auto _ : state) {
+        crc = pb_crc32(frame, sizeof(frame));
+        benchmark::DoNotOptimize(crc);
+    }
+    state.SetBytesProcessed(state.iterations() * sizeof(frame));
+    state.SetLabel("pb_crc32");
+}
+
+BENCHMARK(BM_bmf_crc32);
+
+/* Opening an evaluation database index of state.range(0) items and
+ * iterating it: pb_fpdb parsing index.txt against mapping the index
+ * svf10_fpdb_convert() made of it. The label gives the bytes each item
+ * takes. */
+static void BM_bmf_fpdb(benchmark::State& state, bool binary)
+{
+    char dir[] = "/tmp/svf10_bench_XXXXXX";
+    std::string text, bin;
+    pb_fpdb_t* fpdb = 0;
+    svf10_fpdb_t* db;
+    pb_fpdb_iter_t iter;
+    svf10_fpdb_iter_t it;
+    struct stat st;
+    FILE* f;
+    int n = (int) state.range(0);
+    size_t count = 0, bytes = 0;
+
+    if (!mkdtemp(dir)) {
+        state.SkipWithError("mkdtemp failed");
+        return;
+    }
+    text = std::string(dir) + "/index.txt";
+    bin = std::string(dir) + "/index.bin";
+    f = fopen(text.c_str(), "w");
+    if (f) {
+        fprintf(f, "## name=svf10_bench\n## resolution=500\n");
+        for (int i = 0; i < n; i++)
+            fprintf(f, "%d\t%d\t0\t%d\t%04d/%08d_%02d_%d.png\n",
+                    i / 50 + 1, i / 5 % 10, i % 5, i / 50 + 1, i / 50 + 1, i / 5 % 10, i % 5);
+        fclose(f);
+        fpdb = pb_fpdb_read(text.c_str());
+    }
+    if (!fpdb || svf10_fpdb_convert(fpdb, bin.c_str()) != PB_RC_OK || stat(bin.c_str(), &st) != 0) {
+        state.SkipWithError("index setup failed");
+        pb_fpdb_free(fpdb);
+        nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+        return;
+    }
+    bytes = binary ? (size_t) st.st_size : n * sizeof(pb_fpdb_item_t) + fpdb->num_attrs * sizeof(pb_fpdb_attr_t);
+    pb_fpdb_free(fpdb);
+
+    for (auto _ : state) {
+        count = 0;
+        if (binary) {
+            db = svf10_fpdb_open(bin.c_str());
+            for (const svf10_fpdb_item_t* item = svf10_fpdb_iter_init(db, &it); item;
+                 item = svf10_fpdb_iter_next(&it))
+                count += strlen(svf10_fpdb_filename(db, item)) != 0;
+            svf10_fpdb_close(db);
+        } else {
+            fpdb = pb_fpdb_read(text.c_str());
+            for (pb_fpdb_item_t* item = fpdb ? pb_fpdb_iter_init(fpdb, &iter) : 0; item;
+                 item = pb_fpdb_iter_next(&iter))
+                count += strlen(item->filename) != 0;
+            pb_fpdb_free(fpdb);
+        }
+        if (count != (size_t) n) {
+            state.SkipWithError("wrong number of items");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetLabel(std::string(binary ? "svf10_fpdb, " : "pb_fpdb, ")
+                   + std::to_string(bytes / (n ? n : 1)) + " bytes/item");
+    nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+BENCHMARK_CAPTURE(BM_bmf_fpdb, pb_fpdb, false)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_bmf_fpdb, svf10_fpdb, true)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_bmf_quality(benchmark::State& state, const pb_qualityI* module, const char* name)
+{
+    bmf_fixture f;
+    pb_quality_t* quality;
+
+    if (!f.image) {
+        state.SkipWithError("BMF setup failed");
+        return;
+    }
+    for (auto _ : state) {
+        quality = 0;
+        if (module->compute_quality(f.session, f.image, &quality) != PB_RC_OK) {
+            state.SkipWithError("compute_quality failed");
+            break;
+        }
+        benchmark::DoNotOptimize(quality);
+        pb_quality_delete(quality);
+    }
+    state.SetLabel(std::string(name) + ", quality " + std::to_string(pb_image_get_quality(f.image)) +
+                   ", " + std::to_string(pb_image_get_fingerprint_area(f.image)) + " mm2");
+}
+
+BENCHMARK_CAPTURE(BM_bmf_quality, pb_quality, &pb_quality, "pb_quality")->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_bmf_quality, pb_quality_speedmem, &pb_quality_speedmem, "pb_quality_speedmem")->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_bmf_quality, svf10_quality, &svf10_quality, "svf10_quality")->Unit(benchmark::kMicrosecond);
+
+/* Stability between two captures of the same finger with fresh noise; the
+ * setup also checks that a finger moved by one pixel is not stable. */
+static void BM_bmf_finger_stable(benchmark::State& state, const pb_qualityI* module, const char* name)
+{
+    static uint8_t raw[SVF10_FRAME_SIZE];
+    static uint8_t pixels[SVF10_IMAGE_SIZE];
+    pb_session_t* session = pb_session_create();
+    pb_image_t* images[3];
+    int stable[2] = { 0, 1 };
+    int i, j;
+
+    for (i = 0; i < 3; i++) {
+        make_frame(raw, 40 + (i == 2), 52, i + 1);
+        for (j = 0; j < SVF10_IMAGE_HEIGHT; j++)
+            memcpy(pixels + j * SVF10_IMAGE_WIDTH,
+                   SVF10_FRAME_PIXELS(raw) + j * SVF10_FRAME_STRIDE, SVF10_IMAGE_WIDTH);
+        images[i] = pb_image_create(SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                    BENCH_RESOLUTION, BENCH_RESOLUTION,
+                                    pixels, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN);
+    }
+    if (module->finger_stable(session, images[0], images[1], &stable[0]) != PB_RC_OK
+        || module->finger_stable(session, images[0], images[2], &stable[1]) != PB_RC_OK
+        || !stable[0] || stable[1]) {
+        state.SkipWithError("finger_stable misjudged the test images");
+    } else {
+        for (auto _ : state) {
+            module->finger_stable(session, images[0], images[1], &stable[0]);
+            benchmark::DoNotOptimize(stable[0]);
+        }
+    }
+    for (i = 0; i < 3; i++)
+        pb_image_delete(images[i]);
+    pb_session_delete(session);
+    state.SetLabel(name);
+}
+
+BENCHMARK_CAPTURE(BM_bmf_finger_stable, pb_quality, &pb_quality, "pb_quality")->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_bmf_finger_stable, svf10_quality, &svf10_quality, "svf10_quality")->Unit(benchmark::kMicrosecond);
+
+/* Streaming through the SVF10 reader from the simulated sensor; one
+ * iteration is one image delivered to the callback, the last of which
+ * cancels the capture. */
+struct reader_run {
+    benchmark::State* state;
+    pb_reader_t* reader;
+};
+
+static pb_rc_t reader_callback(pb_reader_captureI_event_t event_, pb_image_t* image, void* context)
+{
+    reader_run* run = (reader_run*) context;
+
+    if (event_ != PB_READER_IMAGE_CAPTURED || !image)
+        return PB_RC_FATAL;
+    benchmark::DoNotOptimize(pb_image_get_pixels(image));
+    pb_image_delete(image);
+    if (!run->state->KeepRunning())
+        pb_reader_capture_cancel(run->reader);
+    return PB_RC_OK;
+}
+
+static void BM_bmf_reader(benchmark::State& state)
+{
+    static uint8_t frames[SIM_FRAMES * SVF10_FRAME_SIZE];
+    Svf10Simulator sim;
+    Svf10Device device;
+    pb_session_t* session = pb_session_create();
+    pb_reader_t* reader = 0;
+    uint16_t n = 1;
+    const char* error;
+    pb_rc_t rc;
+
+    error = sim_open(device, sim, frames);
+    svf10_sensor_set_device(&device, 0, 0);
+    if (!error && (svf10_sensor.start_session(session, 0, 0) != PB_RC_OK
+                   || svf10_sensor.list_readers(session, &reader, &n) != PB_RC_OK || n != 1
+                   || pb_reader_capture_start(reader, 0) != PB_RC_OK))
+        error = "SVF10 reader setup failed";
+    if (error) {
+        state.SkipWithError(error);
+    } else {
+        reader_run run = { &state, reader };
+        rc = pb_reader_capture_image(reader, reader_callback, &run, 0);
+        if (rc != PB_RC_OK)
+            state.SkipWithError("pb_reader_capture_image failed");
+        pb_reader_capture_stop(reader);
+    }
+    pb_reader_delete(reader);
+    svf10_sensor.end_session(session);
+    svf10_sensor_set_device(0, 0, 0);
+    pb_session_delete(session);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_bmf_reader)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+#endif /* SVF10_BENCH_BMF */
+
+BENCHMARK_MAIN();
@@ -1,6 +1,6 @@
 #include <stdint.h>
 
-extern uint8_t bitmap_header_data[10296] = {
+static const uint8_t bitmap_header_data[10296] = {
         0x42, 0x4D, 0x38, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x04, 0x00, 0x00, 0x28, 0x00,
         0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x01, 0x00, 0x08, 0x00, 0x00, 0x00,
         0x00, 0x00, 0x02, 0x24, 0x00, 0x00, 0x40, 0x01, 0x00, 0x00, 0x40, 0x01, 0x00, 0x00, 0x00, 0x00,
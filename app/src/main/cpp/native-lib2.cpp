@@ -4,8 +4,16 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
+#include <pthread.h>
 #include <android/bitmap.h>
-#include "bitmap.h"
+#include "svf10_filter.h"
+#include "svf10_pipeline.h"
+#include "svf10_unpack.h"
+#include "svf10_device.h"
+#include "svf10_capture.h"
+#include "svf10_convert.h"
+#include "svf10_context.h"
+#include "svf10_jni.h"
 #include <math.h>
 //#include "pb_algorithm.h"
 #include <android/log.h>
@@ -30,6 +38,10 @@
 #include "pb_returncodes.h"
 #include "pbpng.h"
 */
+#include "pb_image_capture.h"
+#include "svf10_quality.h"
+#include "svf10_sensor.h"
+#include "svf10_algorithm.h"
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 
 #define SVF_DLY2X_OSC        svf10_resister_frame[0]
@@ -105,45 +117,55 @@ uint16_t svf10_x_pixel = 96;
 uint16_t svf10_y_pixel = 96;
 uint16_t svf10_receive_count = 9412;
 uint16_t svf10_header_count = 10296;
-uint8_t svf10_origine_buffer[9412];
 //uint8_t svf10_origine_buffer[2048];
 
-static const char *device = "/dev/spidev1.0";
-static uint8_t mode;
 static uint8_t bits = 8;
 static uint32_t speed = 100000;
 static uint16_t delay;
-static uint8_t order;
 
 /* Private variables ---------------------------------------------------------*/
-uint8_t svf10_chip_id[8];
-uint8_t svf10_status_buffer[8];
-uint16_t origine_image_count = 4;
-uint16_t recon_image_count = 1078;
-
 uint8_t uart_receive_frame[18];
-uint8_t svf10_resister_frame[15];
 uint8_t receive_end_flag = 0;
 uint8_t chip_id_buffer[6];
 uint8_t test_buffer[2];
 
 /* variables for Histogram Function ------------------------------------------*/
 
-uint8_t image_data[96][96];
-double result_data[96][96];
-double histogram[256];
-double histogram1[256], histogram2[256];
-double temp, temp2, temp3, temp4;
-uint8_t INDEX;
-
-double average;
 int16_t         N_Capture_Frame;
 
 uint16_t display_threshold = 300;
+
+/* Warm algorithms, created in JNI_OnLoad. A thread takes one for the
+ * length of an enrollment or verification. */
+static svf10_algorithm_pool_t* algorithm_pool;
+
+extern "C"
+JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM* vm, void* reserved)
+{
+    JNIEnv* env;
+
+    if (vm->GetEnv((void**) &env, JNI_VERSION_1_6) != JNI_OK)
+        return JNI_ERR;
+    if (svf10_jni_load(env) < 0)
+        return JNI_ERR;
+    svf10_sensor_set_device(&svf10_device, &fp_capture, &svf10_lock);
+
+    algorithm_pool = svf10_algorithm_pool_create(&hybrid_square_xs_algorithm,
+                                                 SVF10_ALGORITHM_INSTANCES);
+    if (!algorithm_pool)
+        __android_log_print(ANDROID_LOG_ERROR, "ShinJAE", "algorithm pool creation failed");
+
+    return JNI_VERSION_1_6;
+}
+
 static bool flag = true;
 #define MAX_FINGERS 5
+/* Time pb_capture_image waits for an acceptable image, in ms. */
+#define CAPTURE_TIMEOUT_MS 10000
 static struct {
-    pb_algorithm_t* algorithm;
+    pb_session_t*   session;
+    pb_reader_t*    reader;
     pb_far_t        ver_far;
     int             nenrolled;
     int             enrolled_ids[MAX_FINGERS];
@@ -197,9 +219,42 @@ static const pb_mte_guiI UiFeedbackHandler = {
     &ui_display_quality,
     &ui_display_progress
 };
+/* Opens the BMF session and the SVF10 reader on first use. SpiOpen must
+ * have opened the sensor. */
+static pb_reader_t* capture_reader(void)
+{
+    uint16_t n = 1;
+
+    if (Global.reader)
+        return Global.reader;
+    if (!Global.session)
+        Global.session = pb_session_create();
+    if (!Global.session
+        || svf10_sensor.start_session(Global.session, 0, 0) != PB_RC_OK
+        || svf10_sensor.list_readers(Global.session, &Global.reader, &n) != PB_RC_OK
+        || n == 0) {
+        Global.reader = 0;
+        return 0;
+    }
+    return Global.reader;
+}
+
 static pb_image_t* capture_image(int ix, int enroll) // params only for demo code
 {
-    return pb_image_create(192, 192, 508, 508, 0, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN);
+    pb_image_t* image = 0;
+    pb_reader_t* reader = capture_reader();
+    pb_rc_t rc;
+
+    if (!reader)
+        return 0;
+    rc = pb_capture_image(Global.session, reader, PB_FINGER_ANONYMOUS, &svf10_quality, 0,
+                          1, CAPTURE_TIMEOUT_MS, &pb_image_capture_default_config, &image);
+    if (rc != PB_RC_OK) {
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "pb_capture_image failed, rc=%d", rc);
+        pb_image_delete(image);
+        return 0;
+    }
+    return image;
 }
 extern "C"
 JNIEXPORT int JNICALL
@@ -223,6 +278,7 @@ Java_com_senvis_finger_senvisdemo_SenvisService_test(
 */
 
 
+    pb_algorithm_t* algorithm;
     pb_multitemplate_enroll_t* mte = 0;
     pb_template_t* enrolled_template = 0;
     int i, num_accepted;
@@ -231,13 +287,19 @@ Java_com_senvis_finger_senvisdemo_SenvisService_test(
     uint8_t coverage = 0;
     int max_samples;
 
-    mte = pb_multitemplate_enroll_create_algorithm(Global.algorithm,
+    if (!algorithm_pool) return 1;
+    algorithm = svf10_algorithm_pool_get(algorithm_pool);
+
+    mte = pb_multitemplate_enroll_create_algorithm(algorithm,
                                                    PB_FINGER_ANONYMOUS,
                                                    &UiFeedbackHandler,
                                                    0);
-    if (!mte) return 1;
+    if (!mte) {
+        svf10_algorithm_pool_put(algorithm_pool, algorithm);
+        return 1;
+    }
 
-    max_samples = pb_algorithm_get_config(Global.algorithm)->max_nbr_of_enrollment_templates;
+    max_samples = pb_algorithm_get_config(algorithm)->max_nbr_of_enrollment_templates;
 
     for (i = num_accepted = 0; num_accepted < max_samples; i++) {
         pb_image_t* image;
@@ -259,7 +321,7 @@ Java_com_senvis_finger_senvisdemo_SenvisService_test(
             }
         }
     }
-    res = pb_multitemplate_enroll_finalize_template_algorithm (Global.algorithm, mte, &enrolled_template);
+    res = pb_multitemplate_enroll_finalize_template_algorithm (algorithm, mte, &enrolled_template);
     if(res != PB_RC_OK) {
         goto errexit;
     }
@@ -278,6 +340,7 @@ Java_com_senvis_finger_senvisdemo_SenvisService_test(
     errexit:
     pb_multitemplate_enroll_delete(mte);
     pb_template_delete(enrolled_template);
+    svf10_algorithm_pool_put(algorithm_pool, algorithm);
     return 0;
 }
 JNIEXPORT int JNICALL
@@ -335,802 +398,62 @@ static int transfer(int fd)
 
 uint8_t ConvertLSBtoMSB(uint8_t input)
 {
-    uint8_t ret = input;
-
-    ret = (ret & 0xF0) >> 4 | (ret & 0x0F) << 4;
-    ret = (ret & 0xCC) >> 2 | (ret & 0x33) << 2;
-    ret = (ret & 0xAA) >> 1 | (ret & 0x55) << 1;
-
-    return ret;
-}
-
-std::string SVF10_Chip_ID_Read(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x00,0x10,0x00};
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-//    HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-//    HAL_SPI_Receive(&hspi1,svf10_chip_id,8,10);
-
-    int ret;
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    struct spi_ioc_transfer tr[2] = {{
-                                         .tx_buf = (unsigned long) spi_tx_buffer,
-                                         .rx_buf = (unsigned long) rx,
-                                         .len = ARRAY_SIZE(spi_tx_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     }, {
-                                         .tx_buf = NULL,
-                                         .rx_buf = (unsigned long) svf10_chip_id,
-                                         .len = ARRAY_SIZE(svf10_chip_id),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     }};
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(2), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    for(int i = ARRAY_SIZE(svf10_chip_id); i > 0; i--) {
-        svf10_chip_id[i] = (svf10_chip_id[i] >> 1) | (svf10_chip_id[i - 1] & 0x01) << 7;
-        svf10_chip_id[i] = ConvertLSBtoMSB(svf10_chip_id[i]);
-    }
-    svf10_chip_id[0] = svf10_chip_id[0] >> 1;
-    svf10_chip_id[0] = ConvertLSBtoMSB(svf10_chip_id[0]);
-
-    for (ret = 0; ret < ARRAY_SIZE(svf10_chip_id); ret++)
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X,[%c] ", svf10_chip_id[ret], svf10_chip_id[ret]);
-    return (char *)"Chip_ID_READ_SUCCESS\n";
-}
-
-std::string SVF10_Sreg_Set(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x00,0x00,0x00};
-
-    spi_tx_buffer[0] = (SVF_SL_TIME << 7) | (SVF_NAVI << 6) | (SVF_SCK_UT << 5) | ((SVF_SLV_STU*2) <<2);
-    spi_tx_buffer[1] = 0x70 | (SVF_ISOL << 2) | (SVF_SL_TIME >> 1);
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-
-    test_buffer[0] = spi_tx_buffer[0];
-    test_buffer[1] = spi_tx_buffer[1];
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)spi_tx_buffer,
-        .rx_buf = (unsigned long)rx,
-        .len = ARRAY_SIZE(spi_tx_buffer),
-        .delay_usecs = delay,
-        .speed_hz = speed,
-        .bits_per_word = bits,
-    };
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    return (char *)"SVF10_Sreg_Set_SUCCESS\n";
-}
-
-std::string SVF10_Sreg_Read_Creg_Set(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x00,0x00,0x00};
-
-    spi_tx_buffer[0] = (SVF_DYL2X << 7) | (SVF_PERIOD << 2);
-    spi_tx_buffer[1] = 0x60 | (SVF_DLY2X_OSC << 3) | (SVF_S_GAIN << 1) | SVF_ADC_RSEL ;
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-    //HAL_SPI_Receive(&hspi1,svf10_status_buffer,5,10);
-
-    test_buffer[0] = spi_tx_buffer[0];
-    test_buffer[1] = spi_tx_buffer[1];
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr[2] = {{
-                                         .tx_buf = (unsigned long) spi_tx_buffer,
-                                         .rx_buf = (unsigned long) rx,
-                                         .len = ARRAY_SIZE(spi_tx_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     },{
-                                         .tx_buf = NULL,
-                                         .rx_buf = (unsigned long) svf10_status_buffer,
-                                         .len = ARRAY_SIZE(svf10_status_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     }};
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(2), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    for(int i = ARRAY_SIZE(svf10_status_buffer); i > 0; i--) {
-        svf10_status_buffer[i] = (svf10_status_buffer[i] >> 1) | (svf10_status_buffer[i - 1] & 0x01) << 7;
-        svf10_status_buffer[i] = ConvertLSBtoMSB(svf10_status_buffer[i]);
-    }
-    svf10_status_buffer[0] = svf10_status_buffer[0] >> 1;
-    svf10_status_buffer[0] = ConvertLSBtoMSB(svf10_status_buffer[0]);
-
-    //for (ret = 0; ret < ARRAY_SIZE(svf10_status_buffer); ret++)
-    //    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X,[%c] ", svf10_status_buffer[ret], svf10_status_buffer[ret]);
-
-    return (char *)"SVF10_Sreg_Read_Creg_Set_SUCCESS\n";
-}
-
-std::string SVF10_Memory_Read_Mode5(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x00,0x3e,0x00};
-
-    spi_tx_buffer[0] = (SVF_MULTIPLYING << 2);
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-    //HAL_SPI_Receive(&hspi1,svf10_origine_buffer,svf10_receive_count,500);
-
-    test_buffer[0] = spi_tx_buffer[0];
-    test_buffer[1] = spi_tx_buffer[1];
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr[2] = {{
-                                         .tx_buf = (unsigned long) spi_tx_buffer,
-                                         .rx_buf = (unsigned long) rx,
-                                         .len = ARRAY_SIZE(spi_tx_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     },{
-                                         .tx_buf = NULL,
-                                         .rx_buf = (unsigned long) svf10_origine_buffer,
-                                         .len = ARRAY_SIZE(svf10_origine_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     }};
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(2), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    for(int i = ARRAY_SIZE(svf10_origine_buffer); i > 0; i--) {
-        svf10_origine_buffer[i] = (svf10_origine_buffer[i] >> 1) | (svf10_origine_buffer[i - 1] & 0x01) << 7;
-        svf10_origine_buffer[i] = ConvertLSBtoMSB(svf10_origine_buffer[i]);
-    }
-    svf10_origine_buffer[0] = svf10_origine_buffer[0] >> 1;
-    svf10_origine_buffer[0] = ConvertLSBtoMSB(svf10_origine_buffer[0]);
-
-    //for (ret = 0; ret < ARRAY_SIZE(svf10_origine_buffer); ret++)
-    //    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X,[%c] ", svf10_origine_buffer[ret], svf10_origine_buffer[ret]);
-    return (char *)"SVF10_Memory_Read_Mode5_SUCCESS\n";
-}
-
-std::string SVF10_Capture_Offset(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x00,0x00,0x00};
-    spi_tx_buffer[0] = (SVF_DYL2X << 7) | (SVF_CLK_SEL << 5) | (SVF_PERIOD << 2);
-    spi_tx_buffer[1] = (SVF_DLY2X_OSC << 3) | (SVF_S_GAIN << 1) | SVF_ADC_RSEL ;
-
-    uint8_t spi_test_buffer[]={0x00};
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-    spi_test_buffer[0] = spi_tx_buffer[0];
-    test_buffer[0] = spi_tx_buffer[1];
-    test_buffer[1] = spi_tx_buffer[2];
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr[2] = {{
-                                         .tx_buf = (unsigned long)spi_test_buffer,
-                                         .rx_buf = (unsigned long)rx,
-                                         .len = ARRAY_SIZE(spi_test_buffer),
-                                         .delay_usecs = 1000,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     },{
-                                         .tx_buf = (unsigned long)test_buffer,
-                                         .rx_buf = (unsigned long)rx,
-                                         .len = ARRAY_SIZE(test_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     }};
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(2), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    return (char *)"SVF10_Capture_Offset_SUCCESS\n";
-}
-
-std::string SVF10_Status_write(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x20,0x76,0x00};
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)spi_tx_buffer,
-        .rx_buf = (unsigned long)rx,
-        .len = ARRAY_SIZE(spi_tx_buffer),
-        .delay_usecs = delay,
-        .speed_hz = speed,
-        .bits_per_word = bits,
-    };
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-/*
-    for (ret = 0; ret < ARRAY_SIZE(rx); ret++) {
-        if (!(ret % 6))
-            __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "");
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X ", rx[ret]);
-    }
-    */
-    return (char *)"SVF10_Status_write_SUCCESS\n";
-}
-
-std::string SVF10_Status_read(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x10,0x6a,0x00};
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-    //HAL_SPI_Receive(&hspi1,svf10_status_buffer,5,10);
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr[2] = {{
-                                         .tx_buf = (unsigned long) spi_tx_buffer,
-                                         .rx_buf = (unsigned long) rx,
-                                         .len = ARRAY_SIZE(spi_tx_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     },{
-                                         .tx_buf = NULL,
-                                         .rx_buf = (unsigned long) svf10_status_buffer,
-                                         .len = ARRAY_SIZE(svf10_status_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     }};
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(2), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    for(int i = ARRAY_SIZE(svf10_status_buffer); i > 0; i--) {
-        svf10_status_buffer[i] = (svf10_status_buffer[i] >> 1) | (svf10_status_buffer[i - 1] & 0x01) << 7;
-        svf10_status_buffer[i] = ConvertLSBtoMSB(svf10_status_buffer[i]);
-    }
-    svf10_status_buffer[0] = svf10_status_buffer[0] >> 1;
-    svf10_status_buffer[0] = ConvertLSBtoMSB(svf10_status_buffer[0]);
-
-    for (ret = 0; ret < ARRAY_SIZE(svf10_status_buffer); ret++)
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X,[%c] ", svf10_status_buffer[ret], svf10_status_buffer[ret]);
-    return (char *)"SVF10_Status_read_SUCCESS\n";
+    return svf10_bit_reverse[input];
 }
 
-std::string SVF10_Sleep_Mode(int fd)
+void SVF10_Send_Image(svf10_context_t* ctx)
 {
-    uint8_t spi_tx_buffer[]={0x00,0x51,0x00};
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)spi_tx_buffer,
-        .rx_buf = (unsigned long)rx,
-        .len = ARRAY_SIZE(spi_tx_buffer),
-        .delay_usecs = delay,
-        .speed_hz = speed,
-        .bits_per_word = bits,
-    };
+    svf10_context_write_bmp(ctx);
 
-    ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    return (char *)"SVF10_Sleep_Mode_SUCCESS\n";
+    //HAL_UART_Transmit(&huart4,ctx->bmp,svf10_header_count,2000);
 }
 
-std::string SVF10_Sleep_Sens(int fd)
+void SVF10_Send_Image_mark(svf10_context_t* ctx)
 {
-    uint8_t spi_tx_buffer[]={0x00,0x00,0x00};
-
-    spi_tx_buffer[0] = (SVF_ADC_REF << 2);
-    spi_tx_buffer[1] = 0x40 | (SVF_PERIOD << 2) | (SVF_ADC_REF >> 6);
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-
-    test_buffer[0] = spi_tx_buffer[0];
-    test_buffer[1] = spi_tx_buffer[1];
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)spi_tx_buffer,
-        .rx_buf = (unsigned long)rx,
-        .len = ARRAY_SIZE(spi_tx_buffer),
-        .delay_usecs = delay,
-        .speed_hz = speed,
-        .bits_per_word = bits,
-    };
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    return (char *)"SVF10_Sleep_Sens_SUCCESS\n";
-}
-
-std::string SVF10_Memory_Read_Mode0(int fd)
-{
-    uint8_t spi_tx_buffer[]={0x00,0x30,0x00};
-
-    spi_tx_buffer[0] = (SVF_MULTIPLYING << 2);
-    for (int i = 0; i < 2; i++)
-        spi_tx_buffer[i] = ConvertLSBtoMSB(spi_tx_buffer[i]);
-
-    //HAL_SPI_Transmit(&hspi1,spi_tx_buffer,3,10);
-    //HAL_SPI_Receive(&hspi1,svf10_origine_buffer,svf10_receive_count,500);
-
-    test_buffer[0] = spi_tx_buffer[0];
-    test_buffer[1] = spi_tx_buffer[1];
-
-    uint8_t rx[ARRAY_SIZE(spi_tx_buffer)] = {0, };
-    int ret;
-    struct spi_ioc_transfer tr[2] = {{
-                                         .tx_buf = (unsigned long) spi_tx_buffer,
-                                         .rx_buf = (unsigned long) rx,
-                                         .len = ARRAY_SIZE(spi_tx_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     },{
-                                         .tx_buf = NULL,
-                                         .rx_buf = (unsigned long) svf10_origine_buffer,
-                                         .len = ARRAY_SIZE(svf10_origine_buffer),
-                                         .delay_usecs = delay,
-                                         .speed_hz = speed,
-                                         .bits_per_word = bits,
-                                     } };
-
-    ret = ioctl(fd, SPI_IOC_MESSAGE(2), &tr);
-    if (ret < 1)
-        return (char *)"Error ioctl";
-
-    //for(int i = ARRAY_SIZE(svf10_origine_buffer); i > 0; i--) {
-    for(int i = 0; i < ARRAY_SIZE(svf10_origine_buffer); i++) {
-        //svf10_origine_buffer[i] = (svf10_origine_buffer[i] >> 1) | (svf10_origine_buffer[i - 1] & 0x01) << 7;
-        svf10_origine_buffer[i] = 255 - ConvertLSBtoMSB(svf10_origine_buffer[i]);
-    }
-    //svf10_origine_buffer[0] = svf10_origine_buffer[0] >> 1;
-    //svf10_origine_buffer[0] = ConvertLSBtoMSB(svf10_origine_buffer[0]);
-
-    //for (ret = 0; ret < ARRAY_SIZE(svf10_origine_buffer); ret++)
-    for (ret = 0; ret < 16; ret++)
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X,[%c] ", svf10_origine_buffer[ret], svf10_origine_buffer[ret]);
-
-    return (char *)"SVF10_Memory_Read_Mode0SUCCESS\n";
-}
-
-std::string SVF10_Send_Image(int fd)
-{
-    origine_image_count = 4;
-    recon_image_count = 1078;
-
-    for(uint16_t i=0; i< svf10_y_pixel; i++)
-    {
-        for(uint16_t j = 0; j< svf10_x_pixel ; j++)
-        {
-            bitmap_header_data[recon_image_count] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-            recon_image_count++;
-        }
-        origine_image_count +=2;
-    }
-
-    //HAL_UART_Transmit(&huart4,bitmap_header_data,svf10_header_count,2000);
-}
-
-void SVF10_Send_Image_mark(void)
-{
-    origine_image_count = 4;
-    recon_image_count = 1078;
-
-    for(uint16_t i=0; i< svf10_y_pixel; i++)
-    {
-        for(uint16_t j = 0; j< svf10_x_pixel ; j++)
-        {
-            bitmap_header_data[recon_image_count] = 255 - bitmap_header_data[recon_image_count] ;
-            origine_image_count++;
-            recon_image_count++;
-        }
-        origine_image_count +=2;
-    }
+    svf10_context_invert_bmp(ctx);
 
     //Save Image File
-    //HAL_UART_Transmit(&huart4,bitmap_header_data,svf10_header_count,2000);
+    //HAL_UART_Transmit(&huart4,ctx->bmp,svf10_header_count,2000);
 }
 
-void image_quality(void)
+void image_quality(svf10_context_t* ctx)
 {
-    origine_image_count = 4;
-    for(uint16_t i=0; i<96; i++)
-    {
-        for(uint16_t j=0; j<96; j++)
-        {
-            image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-        }
-        origine_image_count +=2;
-    }
-
-    temp=0.0;
-    for(uint16_t i=0; i<96; i++)
-    {
-        for(uint16_t j=0; j<96; j++)
-        {
-            temp=temp+image_data[i][j];
-        }
-    }
-
-    temp = temp / 96.0 / 96.0;
-
-    temp2 = 0.0;
-    for(uint16_t i=0; i<96; i++)
-    {
-        for(uint16_t j=0; j<96; j++)
-        {
-            temp2=temp2+(image_data[i][j]-temp)*(image_data[i][j]-temp);
-        }
-    }
-    temp2 = temp2 / 96.0 / 96.0;
+    svf10_context_quality(ctx, SVF_DISPLAY_THRESHOLD);
 }
 
-void moving_aver_by2(void)
+void moving_aver_by2(svf10_context_t* ctx)
 {
-
-    int16_t i_pre, j_pre;
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            result_data[i][j] = 0;
-        }
-    }
-
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        i_pre = i - 1;
-        if (i_pre < 0)
-            i_pre = 0;
-        for (uint16_t j = 0; j<96; j++)
-        {
-            j_pre = j - 1;
-            if (j_pre < 0)
-                j_pre = 0;
-            result_data[i][j] = 1.0 / 4.0 *(image_data[i_pre][j_pre] + image_data[i_pre][j] +
-                image_data[i][j_pre] + image_data[i][j]);
-        }
-    }
-
-
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            svf10_origine_buffer[origine_image_count] = (uint8_t)result_data[i][j];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
-
+    svf10_filter_box2(SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE,
+                      SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE);
 }
 
-void moving_aver_by3(void)
+void moving_aver_by3(svf10_context_t* ctx)
 {
-
-    int16_t i_pre, j_pre, i_post, j_post;
-    origine_image_count = 4;
-    for(uint16_t i=0; i<96; i++)
-    {
-        for(uint16_t j=0; j<96; j++)
-        {
-            image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-        }
-        origine_image_count +=2;
-    }
-
-    for(uint16_t i=0; i<96; i++)
-    {
-        for(uint16_t j=0; j<96; j++)
-        {
-            result_data[i][j] = 0;
-        }
-    }
-
-
-    for(uint16_t i=0; i<96; i++)
-    {
-        i_pre = i - 1;
-        if (i_pre < 0)
-            i_pre = 0;
-        i_post = i + 1;
-        if (i_post > 95)
-            i_post = 95;
-        for(uint16_t j=0; j<96; j++)
-        {
-            j_pre = j - 1;
-            if (j_pre < 0)
-                j_pre = 0;
-            j_post = j + 1;
-            if (j_post > 95)
-                j_post = 95;
-            result_data[i][j] = 1.0/9.0 *(image_data[i_pre][j_pre] + image_data[i_pre][j] + image_data[i_pre][j_post] +
-                image_data[i][j_pre] + image_data[i][j] + image_data[i][j_post] +
-                image_data[i_post][j_pre] + image_data[i_post][j] + image_data[i_post][j_post]);
-        }
-    }
-
-
-    origine_image_count = 4;
-    for(uint16_t i=0; i<96; i++)
-    {
-        for(uint16_t j=0; j<96; j++)
-        {
-            svf10_origine_buffer[origine_image_count]= (uint8_t) result_data[i][j];
-            origine_image_count++;
-        }
-        origine_image_count +=2;
-    }
-
+    svf10_filter_box3(SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE,
+                      SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE);
 }
 
-void moving_aver_by4(void)
+void moving_aver_by4(svf10_context_t* ctx)
 {
-
-    int16_t i_pre2, i_pre, j_pre2, j_pre, i_post, j_post;
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            result_data[i][j] = 0;
-        }
-    }
-
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        i_pre2 = i - 2;
-        if (i_pre2 < 0)
-            i_pre2 = 0;
-        i_pre = i - 1;
-        if (i_pre < 0)
-            i_pre = 0;
-        i_post = i + 1;
-        if (i_post > 95)
-            i_post = 95;
-
-        for (uint16_t j = 0; j<96; j++)
-        {
-            j_pre2 = j - 2;
-            if (j_pre2 < 0)
-                j_pre2 = 0;
-            j_pre = j - 1;
-            if (j_pre < 0)
-                j_pre = 0;
-            j_post = j + 1;
-            if (j_post > 95)
-                j_post = 95;
-
-            result_data[i][j] = 1.0 / 16.0 *(image_data[i_pre2][j_pre2] + image_data[i_pre2][j_pre] + image_data[i_pre2][j] + image_data[i_pre2][j_post] +
-                image_data[i_pre][j_pre2] + image_data[i_pre][j_pre] + image_data[i_pre][j] + image_data[i_pre][j_post] +
-                image_data[i][j_pre2] + image_data[i][j_pre] + image_data[i][j] + image_data[i][j_post] +
-                image_data[i_post][j_pre2] + image_data[i_post][j_pre] + image_data[i_post][j] + image_data[i_post][j_post]);
-
-        }
-    }
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            svf10_origine_buffer[origine_image_count] = (uint8_t) result_data[i][j];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
-
+    svf10_filter_box4(SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE,
+                      SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE);
 }
 
-void hist_eq(void)
+void hist_eq(svf10_context_t* ctx)
 {
-    uint8_t gray;
-
-    for (uint16_t i = 0; i < 256; i++)
-        histogram[i] = 0;
-
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            gray = image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-            histogram[gray] = histogram[gray] + 1;
-        }
-        origine_image_count += 2;
-    }
-
-    for (uint16_t i = 0; i < 256; i++)
-        histogram[i] = histogram[i] / 96.0 / 96.0 * 255.0;
-
-    for (uint16_t i = 1; i < 256; i++)
-        histogram[i] = histogram[i - 1] + histogram[i];
-
-    for (uint16_t i = 1; i < 256; i++)
-        histogram[i] = (uint8_t) histogram[i];
-
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            svf10_origine_buffer[origine_image_count] = (uint8_t) histogram[(uint8_t) image_data[i][j]];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
+    svf10_filter_hist_eq(SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE,
+                         SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE);
 }
 
-void histo(void)
+void histo(svf10_context_t* ctx)
 {
-    uint8_t gray;
-
-    for (uint16_t i = 0; i < 256; i++)
-        histogram[i] = 0;
-
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            gray = image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-            histogram[gray] = histogram[gray] + 1;
-        }
-        origine_image_count += 2;
-    }
-
-    for (uint16_t i = 0; i < 256; i++)
-        histogram[i] = histogram[i] / 96.0 / 96.0;
-
-    for (uint16_t i = 1; i < 256; i++)
-        histogram[i] = histogram[i - 1] + histogram[i];
+    svf10_context_histogram(ctx);
 }
 
-void gaussian_filter_by3(void)
+void gaussian_filter_by3(svf10_context_t* ctx)
 {
-    float factor[3][3], sum = 0;
-    int16_t i_pre, j_pre, i_post, j_post;
-    origine_image_count = 4;
-
-    sum = 0;
-    for (uint16_t i = 0; i < 3; i++)
-    {
-        for (uint16_t j = 1; j < 3; j++)
-        {
-            factor[i][j] = exp(-((i - 1.0)*(i - 1.0) + (j - 1.0)*(j - 1.0)) / (2.0*2.0));
-            sum = sum + factor[i][j];
-        }
-
-    }
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            image_data[i][j] = svf10_origine_buffer[origine_image_count];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            result_data[i][j] = 0;
-        }
-    }
-
-
-    for (uint16_t i = 0; i<96; i++)
-    {
-        i_pre = i - 1;
-        if (i_pre < 0)
-            i_pre = 0;
-        i_post = i + 1;
-        if (i_post > 95)
-            i_post = 95;
-        for (uint16_t j = 0; j<96; j++)
-        {
-            j_pre = j - 1;
-            if (j_pre < 0)
-                j_pre = 0;
-            j_post = j + 1;
-            if (j_post > 95)
-                j_post = 95;
-            result_data[i][j] = 1.0 / sum *(factor[0][0]*image_data[i_pre][j_pre] + factor[0][1]*image_data[i_pre][j] + factor[0][2]*image_data[i_pre][j_post] +
-                factor[1][0]*image_data[i][j_pre] + factor[1][1]*image_data[i][j] + factor[1][2]*image_data[i][j_post] +
-                factor[2][0]*image_data[i_post][j_pre] + factor[2][1]*image_data[i_post][j] + factor[2][2]*image_data[i_post][j_post]);
-        }
-    }
-
-
-    origine_image_count = 4;
-    for (uint16_t i = 0; i<96; i++)
-    {
-        for (uint16_t j = 0; j<96; j++)
-        {
-            svf10_origine_buffer[origine_image_count] = (uint8_t)result_data[i][j];
-            origine_image_count++;
-        }
-        origine_image_count += 2;
-    }
-
+    svf10_filter_gaussian3(SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE,
+                           SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE);
 }
 
 extern "C"
@@ -1154,110 +477,11 @@ Java_com_senvis_finger_senvisdemo_SenvisService_SpiOpen(
     int r14
 ) {
 
-    int ret = 0;
-    int fd;
-    std::string hello;
-
-    fd = open(device, O_RDWR);
-    if (fd < 0) {
-        hello = "can't open device\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    // spi mode
-    ret = ioctl(fd, SPI_IOC_WR_MODE, &mode);
-    if (ret == -1) {
-        hello = "can't set spi mode \n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    ret = ioctl(fd, SPI_IOC_RD_MODE, &mode);
-    if (ret == -1) {
-        hello = "can't get spi mode\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    // bits per word
-    ret = ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits);
-    if (ret == -1) {
-        hello = "can't set bits per word\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    ret = ioctl(fd, SPI_IOC_RD_BITS_PER_WORD, &bits);
-    if (ret == -1) {
-        hello = "can't get bits per word\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    order = 0x00;
-    ret = ioctl(fd, SPI_IOC_WR_LSB_FIRST, &order);
-    if (ret == -1) {
-        hello = "SPI Write LSB failed\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    ret = ioctl(fd, SPI_IOC_RD_LSB_FIRST, &order);
-    if (ret == -1) {
-        hello = "SPI WRite LSB Failed\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    //max speed hz
-    ret = ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
-    if (ret == -1) {
-        hello = "can't set max speed hz\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    ret = ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed);
-    if (ret == -1) {
-        hello = "can't get max speed hz\n";
-        return env->NewStringUTF(hello.c_str());
-    }
-
-    chip_id_buffer[0] = 'S';
-    chip_id_buffer[1] = 'V';
-    chip_id_buffer[2] = 'F';
-    chip_id_buffer[3] = '1';
-    chip_id_buffer[4] = '0';
-    chip_id_buffer[5] = 'P';
-
-    SVF_DLY2X_OSC = (uint8_t)r1;
-    SVF_S_GAIN = (uint8_t)r2;
-    SVF_ADC_RSEL = (uint8_t)r3;
-    SVF_DYL2X = (uint8_t)r4;
-    SVF_CLK_SEL = (uint8_t)r5;
-    SVF_PERIOD = (uint8_t)r6;
-    SVF_ISOL = (uint8_t)r7;
-    SVF_SL_TIME = (uint8_t)r8;
-    SVF_NAVI = (uint8_t)r9;
-    SVF_SCK_UT = (uint8_t)r10;
-    SVF_SLV_STU = (uint8_t)r11;
-    SVF_MULTIPLYING = (uint8_t)r12;
-    SVF_ADC_REF = (uint8_t)r13;
-    SVF_GPB_REG = 0xf0;
-    SVF_DISPLAY_THRESHOLD = (uint8_t)r14;
-
-    //display_threshold = 300;   // value/100
-
-    hello = SVF10_Chip_ID_Read(fd);
-    usleep(1000*1);
-    hello += SVF10_Sreg_Set(fd);
-    usleep(1000*1);
-    hello += SVF10_Sreg_Read_Creg_Set(fd);
-    usleep(1000*1);
-    hello += SVF10_Memory_Read_Mode5(fd);
-    usleep(1000*1);
-    hello += SVF10_Sreg_Set(fd);
-    usleep(1000*1);
-    //for (int i=0; i < 10; i++) {
-    hello += SVF10_Capture_Offset(fd);
-    usleep(1000 * 1000);
-    //}
-    close(fd);
+    const int registers[SVF10_JNI_REGISTERS] = {
+        r1, r2, r3, r4, r5, r6, r7, r8, r9, r10, r11, r12, r13, r14
+    };
 
-    return env->NewStringUTF(hello.c_str());
+    return svf10_jni_spi_open(env, registers);
 }
 
 
@@ -1267,30 +491,35 @@ Java_com_senvis_finger_senvisdemo_SenvisService_FPgetTemp2(
     JNIEnv *env,
     jobject obj) {
 
-    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "Call FPgetTemp2 Success!");
-    int ret = 0;
-    int fd;
-    std::string hello;
+    return svf10_jni_get_temp();
+}
 
-    fd = open(device, O_RDWR);
-    if (fd < 0) {
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "can't open device");
-    }
+extern "C"
+JNIEXPORT int JNICALL
+Java_com_senvis_finger_senvisdemo_SenvisService_FPStartCapture(
+        JNIEnv *env,
+        jobject obj) {
 
-    hello = SVF10_Sreg_Set(fd);
-    usleep(1000*1);
-    hello += SVF10_Sreg_Read_Creg_Set(fd);
-    usleep(1000*1);
-//    hello += SVF10_Sreg_Set(fd);
-//    usleep(1000*1);
-    hello += SVF10_Sleep_Sens(fd);
-    usleep(1000*200);
-    hello += SVF10_Memory_Read_Mode0(fd);
-    moving_aver_by3();
-    image_quality();
+    return svf10_jni_start_capture();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_senvis_finger_senvisdemo_SenvisService_FPStopCapture(
+        JNIEnv *env,
+        jobject obj) {
+
+    svf10_jni_stop_capture();
+}
+
+extern "C"
+JNIEXPORT int JNICALL
+Java_com_senvis_finger_senvisdemo_SenvisService_FPGetFrame(
+        JNIEnv *env,
+        jobject obj,
+        jobject buffer) {
 
-    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "Return FPgetTemp2 Success!");
-    return (int)temp2*100;
+    return svf10_jni_get_frame(env, buffer);
 }
 
 extern "C"
@@ -1301,37 +530,29 @@ Java_com_senvis_finger_senvisdemo_SenvisService_FPLoop(
     jobject bitmap) {
 
     __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "Call FPLoop Success!");
-    int ret = 0;
-    int fd;
-    std::string hello;
-
-    fd = open(device, O_RDWR);
-    if (fd < 0) {
-        hello = "can't open device";
-        return env->NewStringUTF(hello.c_str());
-    }
+    svf10_context_t* ctx = svf10_thread_context();
+    const svf10_frame_t* frame;
+    const uint8_t* image;
+    jobject result;
 
-    hello = SVF10_Sreg_Set(fd);
-    usleep(1000*1);
-    hello += SVF10_Sreg_Read_Creg_Set(fd);
-    usleep(1000*1);
-//    hello += SVF10_Sreg_Set(fd);
-//    usleep(1000*1);
-    hello += SVF10_Sleep_Sens(fd);
-    usleep(1000*200);
-    hello += SVF10_Memory_Read_Mode0(fd);
+    if (!ctx)
+        return NULL;
+    image = svf10_next_image(ctx, &frame);
+    if (!image) {
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "can't read device");
+        return NULL;
+    }
 /*
     FILE* file = fopen("/sdcard/hello.txt","w+");
 
     if (file != NULL)
     {
-        for (ret = 0; ret < ARRAY_SIZE(svf10_origine_buffer); ret++)
-            fprintf(file, "%.2X", svf10_origine_buffer[ret]);
+        for (ret = 0; ret < ARRAY_SIZE(ctx->raw); ret++)
+            fprintf(file, "%.2X", ctx->raw[ret]);
         fflush(file);
         fclose(file);
     }
 */
-    image_quality();
 
 /*
     moving_aver_by3();
@@ -1437,80 +658,15 @@ Java_com_senvis_finger_senvisdemo_SenvisService_FPLoop(
     #endif
 #endif
      */
-    if (temp2 > SVF_DISPLAY_THRESHOLD) {
-        moving_aver_by4();
-        hist_eq();
-    }
-    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "temp = %f, Threshold = %d", temp2, SVF_DISPLAY_THRESHOLD);
-
-
-
-    AndroidBitmapInfo info;
-    if ((ret = AndroidBitmap_getInfo(env, bitmap, &info)) < 0)
-    {
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "AndroidBitmap_getInfo() failed ! error=%d", ret);
-        return NULL;
-    }
-    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "width:%d height:%d stride:%d", info.width, info.height, info.stride);
-    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888)
-    {
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "Bitmap format is not RGBA_8888!");
-        return NULL;
-    }
-
-    void* bitmapPixels;
-    if ((ret = AndroidBitmap_lockPixels(env, bitmap, &bitmapPixels)) < 0)
-    {
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "AndroidBitmap_lockPixels() 11 failed ! error=%d", ret);
-        return NULL;
-    }
-
-    jclass bitmapCls = env->GetObjectClass(bitmap);
-    jmethodID recycleFunction = env->GetMethodID(bitmapCls, "recycle", "()V");
-    if (recycleFunction == 0)
-    {
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "error recycling!");
-        return NULL;
-    }
-    env->CallVoidMethod(bitmap, recycleFunction);
-
-    AndroidBitmap_unlockPixels(env, bitmap);
-    //
-    //creating a new bitmap to put the pixels into it - using Bitmap Bitmap.createBitmap (int width, int height, Bitmap.Config config) :
-    //
-
-    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "creating new bitmap...");
-
-    jmethodID createBitmapFunction = env->GetStaticMethodID(bitmapCls, "createBitmap", "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
-    jstring configName = env->NewStringUTF("ARGB_8888");
-    jclass bitmapConfigClass = env->FindClass("android/graphics/Bitmap$Config");
-    jmethodID valueOfBitmapConfigFunction = env->GetStaticMethodID(bitmapConfigClass, "valueOf", "(Ljava/lang/String;)Landroid/graphics/Bitmap$Config;");
-    jobject bitmapConfig = env->CallStaticObjectMethod(bitmapConfigClass, valueOfBitmapConfigFunction, configName);
-    jobject newBitmap = env->CallStaticObjectMethod(bitmapCls, createBitmapFunction, info.height, info.width, bitmapConfig);
+    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "temp = %f, Threshold = %d", ctx->stats.variance, SVF_DISPLAY_THRESHOLD);
+    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "finger %s, %d blocks, %.1f mm2",
+                        ctx->coverage.present ? "present" : "absent",
+                        ctx->coverage.blocks, ctx->coverage.area_mm2);
 
 
-    //uint32_t* src = (uint32_t*) bitmapPixels;
-    if ((ret = AndroidBitmap_lockPixels(env, newBitmap, &bitmapPixels)) < 0)
-    {
-        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "AndroidBitmap_lockPixels() 22 failed ! error=%d", ret);
-        return NULL;
-    }
 
-    int whereToPut = 0;
-    int cnt = 4;
-    uint32_t* newBitmapPixels = (uint32_t*) bitmapPixels;
-    for (int y = 0; y < info.height; y++) {
-        for (int x = 0; x < info.width; x++) {
-            uint32_t pixel =
-                0xFF << 24 | (svf10_origine_buffer[cnt] << 16) |
-                    (svf10_origine_buffer[cnt] << 8) | svf10_origine_buffer[cnt];
-
-            newBitmapPixels[whereToPut++] = pixel;
-            cnt++;
-        }
-        cnt += 2;
-    }
-    AndroidBitmap_unlockPixels(env, newBitmap);
+    result = svf10_deliver_bitmap(env, bitmap, image);
+    svf10_release_frame(frame);
 
     //display_threshold = SVF_DISPLAY_THRESHOLD;
 /*
@@ -1549,9 +705,7 @@ Java_com_senvis_finger_senvisdemo_SenvisService_FPLoop(
     }
 */
 
-    close(fd);
-
-    return newBitmap;
+    return result;
 
     //return env->NewStringUTF(hello.c_str());
 }
@@ -0,0 +1,158 @@
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include "svf10_algorithm.h"
+#include "svf10_filter.h"
+#include "pb_session.h"
+#include "pb_image.h"
+#include "pb_template.h"
+#include "pb_verifierI.h"
+
+/* 500 dpi, the resolution the verification paths pass for SVF10 images. */
+#define WARM_RESOLUTION 500
+
+/* Ridge period of the warm-up image in pixels, about 0.45 mm at 500 dpi. */
+#define WARM_RIDGE_PERIOD 9.0
+
+typedef struct {
+    pb_session_t* session;
+    pb_algorithm_t* algorithm;
+    int taken;
+} instance_t;
+
+struct svf10_algorithm_pool_st {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int ninstances;
+    instance_t instances[1];
+};
+
+/* Concentric ridges around a point off the centre: no real finger, but
+ * ridge flow the extractor works through like a real one. */
+static void warm_image(uint8_t* pixels)
+{
+    const double cx = SVF10_IMAGE_WIDTH * 0.45, cy = SVF10_IMAGE_HEIGHT * 0.55;
+    double r;
+
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+            r = sqrt((i - cy) * (i - cy) + (j - cx) * (j - cx));
+            pixels[i * SVF10_IMAGE_WIDTH + j] =
+                (uint8_t) (128.0 + 100.0 * cos(2.0 * M_PI * r / WARM_RIDGE_PERIOD));
+        }
+}
+
+/* Runs one extraction and one verification, which builds the tables an
+ * algorithm otherwise builds on the first call from the application.
+ * The result is of no interest, only that the calls were made. */
+static void warm_up(pb_algorithm_t* algorithm, const pb_image_t* image)
+{
+    pb_template_t* T = 0;
+    pb_template_t* enrolled[1];
+    int decision;
+
+    if (pb_algorithm_extract_template(algorithm, image, 0, &T) != PB_RC_OK)
+        return;
+    enrolled[0] = T;
+    pb_algorithm_verify_templates(algorithm, enrolled, 1, T, PB_FAR_50000,
+                                  &decision, 0, 0, 0);
+    pb_template_delete(T);
+}
+
+svf10_algorithm_pool_t* svf10_algorithm_pool_create(const pb_algorithmI* algorithm,
+                                                    int ninstances)
+{
+    svf10_algorithm_pool_t* pool;
+    instance_t* in;
+    uint8_t* pixels;
+    pb_image_t* image = 0;
+
+    if (!algorithm || ninstances <= 0)
+        return 0;
+
+    pool = (svf10_algorithm_pool_t*) calloc(1, sizeof(*pool) + (ninstances - 1) * sizeof(instance_t));
+    if (!pool)
+        return 0;
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->cond, 0);
+
+    pixels = (uint8_t*) malloc(SVF10_IMAGE_SIZE);
+    if (pixels) {
+        warm_image(pixels);
+        image = pb_image_create(SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                WARM_RESOLUTION, WARM_RESOLUTION,
+                                pixels, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN);
+        free(pixels);
+    }
+
+    /* BMF allows one algorithm per session. */
+    for (; pool->ninstances < ninstances; pool->ninstances++) {
+        in = &pool->instances[pool->ninstances];
+        in->session = pb_session_create();
+        in->algorithm = in->session ? algorithm->create(in->session) : 0;
+        if (!in->algorithm) {
+            pb_session_delete(in->session);
+            break;
+        }
+        if (image)
+            warm_up(in->algorithm, image);
+    }
+    pb_image_delete(image);
+
+    if (pool->ninstances < ninstances) {
+        svf10_algorithm_pool_delete(pool);
+        return 0;
+    }
+    return pool;
+}
+
+void svf10_algorithm_pool_delete(svf10_algorithm_pool_t* pool)
+{
+    if (!pool)
+        return;
+    for (int i = 0; i < pool->ninstances; i++) {
+        pb_algorithm_delete(pool->instances[i].algorithm);
+        pb_session_delete(pool->instances[i].session);
+    }
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+pb_algorithm_t* svf10_algorithm_pool_get(svf10_algorithm_pool_t* pool)
+{
+    instance_t* in;
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        for (i = 0; i < pool->ninstances; i++)
+            if (!pool->instances[i].taken)
+                break;
+        if (i < pool->ninstances)
+            break;
+        pthread_cond_wait(&pool->cond, &pool->lock);
+    }
+    in = &pool->instances[i];
+    in->taken = 1;
+    pthread_mutex_unlock(&pool->lock);
+
+    return pb_algorithm_retain(in->algorithm);
+}
+
+void svf10_algorithm_pool_put(svf10_algorithm_pool_t* pool, pb_algorithm_t* algorithm)
+{
+    if (!algorithm)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->ninstances; i++)
+        if (pool->instances[i].algorithm == algorithm) {
+            pool->instances[i].taken = 0;
+            pthread_cond_signal(&pool->cond);
+            break;
+        }
+    pthread_mutex_unlock(&pool->lock);
+
+    pb_algorithm_delete(algorithm);
+}
@@ -0,0 +1,54 @@
+/*
+ * SVF10 algorithm pool.
+ *
+ * BMF allows one algorithm per session, and an algorithm builds most of
+ * its state on its first extraction and verification, which makes the
+ * first verify after start-up much slower than the rest. The pool creates
+ * its algorithms up front, each in a session of its own, and warms every
+ * one with an extraction and a verification of a synthetic SVF10 image.
+ * Threads take an algorithm for the time they use it and give it back;
+ * an algorithm is used by one thread at a time.
+ */
+
+#ifndef SVF10_ALGORITHM_H
+#define SVF10_ALGORITHM_H
+
+#include "pb_algorithmI.h"
+#include "pb_algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Algorithms of the native library's pool: one per thread that verifies
+  * or enrolls at the same time. */
+#define SVF10_ALGORITHM_INSTANCES   2
+
+typedef struct svf10_algorithm_pool_st svf10_algorithm_pool_t;
+
+/** Creates ninstances algorithms of the given kind and warms them up.
+  * Takes as long as the first verification would, so call it at load
+  * time.
+  *
+  * @return the pool, or 0 if an algorithm could not be created. */
+svf10_algorithm_pool_t* svf10_algorithm_pool_create(const pb_algorithmI* algorithm,
+                                                    int ninstances);
+
+/** Deletes the pool and its algorithms. Every algorithm taken must have
+  * been given back. */
+void svf10_algorithm_pool_delete(svf10_algorithm_pool_t* pool);
+
+/** Takes an algorithm, waiting until one is free. Thread safe.
+  *
+  * @return the algorithm, retained for the caller. */
+pb_algorithm_t* svf10_algorithm_pool_get(svf10_algorithm_pool_t* pool);
+
+/** Gives back an algorithm taken with svf10_algorithm_pool_get() and
+  * releases the caller's reference. Thread safe. */
+void svf10_algorithm_pool_put(svf10_algorithm_pool_t* pool, pb_algorithm_t* algorithm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_ALGORITHM_H */
@@ -0,0 +1,255 @@
+#include <unistd.h>
+#include <string.h>
+#include "svf10_capture.h"
+
+Svf10Capture::Svf10Capture(Svf10Device& device)
+    : device_(device),
+      pipeline_(0),
+      pool_(0),
+      running_(false),
+      stop_(false),
+      dropped_(0),
+      errors_(0),
+      sequence_(0),
+      slice_rows_(0),
+      slice_frame_(0),
+      slice_received_(0),
+      slice_exit_(false)
+{
+    pthread_mutex_init(&slice_lock_, 0);
+    pthread_cond_init(&slice_cond_, 0);
+}
+
+Svf10Capture::~Svf10Capture()
+{
+    stop();
+    ring_.release_images();
+    svf10_image_pool_delete(pool_);
+    pthread_cond_destroy(&slice_cond_);
+    pthread_mutex_destroy(&slice_lock_);
+}
+
+int Svf10Capture::start(const svf10_stage_t* stages, int nstages, double gate)
+{
+    if (running_)
+        return 0;
+    if (!device_.is_open())
+        return -1;
+    if (!pool_)
+        pool_ = svf10_image_pool_create(SVF10_CAPTURE_FRAMES + SVF10_CAPTURE_LOANED);
+    if (!pool_)
+        return -1;
+
+    pipeline_ = svf10_pipeline_create(stages, nstages);
+    if (!pipeline_)
+        return -1;
+    svf10_pipeline_set_gate(pipeline_, gate);
+
+    ring_.reset();
+    sequence_ = 0;
+    dropped_ = 0;
+    errors_ = 0;
+    stop_ = false;
+    if (pthread_create(&thread_, 0, thread_main, this) != 0) {
+        svf10_pipeline_delete(pipeline_);
+        pipeline_ = 0;
+        return -1;
+    }
+    running_ = true;
+    return 0;
+}
+
+void Svf10Capture::stop()
+{
+    if (!running_)
+        return;
+
+    stop_ = true;
+    pthread_join(thread_, 0);
+    running_ = false;
+    svf10_pipeline_delete(pipeline_);
+    pipeline_ = 0;
+}
+
+void* Svf10Capture::thread_main(void* arg)
+{
+    ((Svf10Capture*) arg)->run();
+    return 0;
+}
+
+void* Svf10Capture::process_main(void* arg)
+{
+    ((Svf10Capture*) arg)->process();
+    return 0;
+}
+
+/* Returns the slot to read the next frame into, with an image buffer, or 0
+ * if the ring is full or every image buffer is detached. */
+svf10_frame_t* Svf10Capture::begin_frame()
+{
+    svf10_frame_t* frame = ring_.begin_write();
+
+    if (frame && !frame->buffer) {
+        frame->buffer = svf10_image_pool_get(pool_);
+        if (!frame->buffer)
+            return 0;
+        frame->image = frame->buffer->pixels;
+    }
+    return frame;
+}
+
+/* Ends the pipeline run over frame and stores its results. */
+void Svf10Capture::finish_frame(svf10_frame_t* frame)
+{
+    const svf10_coverage_t* coverage;
+
+    frame->filtered = svf10_pipeline_finish(pipeline_, &frame->stats);
+    coverage = svf10_pipeline_coverage(pipeline_);
+    if (coverage)
+        frame->coverage = *coverage;
+    else
+        memset(&frame->coverage, 0, sizeof(frame->coverage));
+    frame->process_us = (uint32_t) ((svf10_monotonic_ns() - frame->timestamp_ns) / 1000);
+}
+
+void Svf10Capture::slice_post(int rows)
+{
+    pthread_mutex_lock(&slice_lock_);
+    slice_received_ = rows;
+    pthread_cond_broadcast(&slice_cond_);
+    pthread_mutex_unlock(&slice_lock_);
+}
+
+/* Reads frame in bursts of slice_rows_ rows, posting each to process(),
+ * and returns once process() is done with it. */
+int Svf10Capture::read_sliced(svf10_frame_t* frame)
+{
+    uint32_t pos = 0, end;
+    int rows = 0, ret;
+
+    pthread_mutex_lock(&slice_lock_);
+    slice_frame_ = frame;
+    slice_received_ = 0;
+    pthread_cond_broadcast(&slice_cond_);
+    pthread_mutex_unlock(&slice_lock_);
+
+    ret = device_.begin_stream_mode0();
+    while (ret == 0 && rows < SVF10_IMAGE_HEIGHT) {
+        end = rows + slice_rows_ < SVF10_IMAGE_HEIGHT
+            ? SVF10_FRAME_HEADER + (rows + slice_rows_) * SVF10_FRAME_STRIDE
+            : SVF10_FRAME_SIZE;
+        ret = device_.read_stream_mode0(frame->raw + pos, end - pos);
+        if (ret < 0)
+            break;
+        pos = end;
+        rows = end == SVF10_FRAME_SIZE ? SVF10_IMAGE_HEIGHT : rows + slice_rows_;
+        if (rows == SVF10_IMAGE_HEIGHT)
+            frame->timestamp_ns = svf10_monotonic_ns();
+        slice_post(rows);
+    }
+    /* Chip select is released however far the readout got. */
+    if (device_.end_stream_mode0() < 0)
+        ret = -1;
+    if (rows < SVF10_IMAGE_HEIGHT)
+        slice_post(-1);
+
+    pthread_mutex_lock(&slice_lock_);
+    while (slice_frame_)
+        pthread_cond_wait(&slice_cond_, &slice_lock_);
+    pthread_mutex_unlock(&slice_lock_);
+    return ret;
+}
+
+void Svf10Capture::process()
+{
+    svf10_frame_t* frame;
+    int fed, rows;
+
+    pthread_mutex_lock(&slice_lock_);
+    for (;;) {
+        while (!slice_frame_ && !slice_exit_)
+            pthread_cond_wait(&slice_cond_, &slice_lock_);
+        if (!slice_frame_)
+            break;
+
+        frame = slice_frame_;
+        fed = 0;
+        svf10_pipeline_begin(pipeline_, frame->raw, frame->image, SVF10_IMAGE_WIDTH);
+        while (fed < SVF10_IMAGE_HEIGHT) {
+            while (slice_received_ == fed)
+                pthread_cond_wait(&slice_cond_, &slice_lock_);
+            rows = slice_received_;
+            if (rows < 0)
+                break;
+            pthread_mutex_unlock(&slice_lock_);
+            svf10_pipeline_feed(pipeline_, rows);
+            fed = rows;
+            pthread_mutex_lock(&slice_lock_);
+        }
+        if (fed == SVF10_IMAGE_HEIGHT) {
+            pthread_mutex_unlock(&slice_lock_);
+            finish_frame(frame);
+            pthread_mutex_lock(&slice_lock_);
+        }
+        slice_frame_ = 0;
+        pthread_cond_broadcast(&slice_cond_);
+    }
+    pthread_mutex_unlock(&slice_lock_);
+}
+
+void Svf10Capture::run()
+{
+    svf10_frame_t* frame;
+    uint32_t ready_us;
+    bool sliced;
+    int ready, ret;
+
+    slice_exit_ = false;
+    sliced = slice_rows_ > 0 && pthread_create(&process_thread_, 0, process_main, this) == 0;
+
+    while (!stop_.load(std::memory_order_relaxed)) {
+        if (device_.arm_capture(0) < 0) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            usleep(SVF10_CAPTURE_TIMEOUT_US);
+            continue;
+        }
+        /* A failed poll falls back to the full exposure time. */
+        ready = device_.wait_ready(&svf10_capture_ready, SVF10_CAPTURE_TIMEOUT_US, 0, &ready_us);
+        if (ready < 0 && ready_us < SVF10_CAPTURE_TIMEOUT_US)
+            usleep(SVF10_CAPTURE_TIMEOUT_US - ready_us);
+
+        /* With the ring full, or every image buffer detached, the reader is
+         * behind; keep the sensor cadence but let the frame go. */
+        frame = begin_frame();
+        if (frame && sliced)
+            ret = read_sliced(frame);
+        else
+            ret = device_.read_frame_mode0(frame ? frame->raw : overflow_);
+        if (ret < 0) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        sequence_++;
+        if (!frame) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        frame->sequence = sequence_;
+        frame->ready_us = ready > 0 ? ready_us : 0;
+        if (!sliced) {
+            frame->timestamp_ns = svf10_monotonic_ns();
+            svf10_pipeline_begin(pipeline_, frame->raw, frame->image, SVF10_IMAGE_WIDTH);
+            finish_frame(frame);
+        }
+        ring_.commit_write();
+    }
+
+    if (sliced) {
+        pthread_mutex_lock(&slice_lock_);
+        slice_exit_ = true;
+        pthread_cond_broadcast(&slice_cond_);
+        pthread_mutex_unlock(&slice_lock_);
+        pthread_join(process_thread_, 0);
+    }
+}
@@ -0,0 +1,216 @@
+/*
+ * SVF10 background capture engine.
+ *
+ * A dedicated thread drives the sensor (arm, expose, read) and the
+ * preprocessing pipeline, and publishes every processed frame into a
+ * lock-free single-producer / single-consumer ring of preallocated frames.
+ * The JNI side only ever takes the newest published frame, so a frame is
+ * delivered as soon as the sensor has it instead of after a JNI round-trip
+ * and a fixed sleep.
+ *
+ * In sliced mode the frame is clocked out in bursts of rows, and a second
+ * thread pushes each burst through the pipeline while the next one is on
+ * the wire. Only the last burst and the sweeps after a HIST_EQ are left
+ * once the readout ends.
+ */
+
+#ifndef SVF10_CAPTURE_H
+#define SVF10_CAPTURE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include "svf10_device.h"
+#include "svf10_pipeline.h"
+#include "svf10_image_pool.h"
+
+/** Frames in the ring. One may be held by the consumer while it reads
+  * it, the rest let the capture thread run ahead of a slow reader. */
+#define SVF10_CAPTURE_FRAMES     4
+
+/** Rows per burst in sliced mode, see Svf10Capture::set_slice_rows(). */
+#define SVF10_CAPTURE_SLICE_ROWS 8
+
+/** Images consumers may hold detached from the ring, e.g. wrapped in
+  * pb_image_t objects BMF still references. */
+#define SVF10_CAPTURE_LOANED     4
+
+/** A captured frame. */
+typedef struct {
+    /** Counts captured frames from 1; a gap means frames were dropped. */
+    uint32_t sequence;
+    /** CLOCK_MONOTONIC time the frame was read, in nanoseconds. */
+    int64_t timestamp_ns;
+    /** Time from arming until the sensor reported the frame ready, in
+      * microseconds, or 0 if it never did and the read went ahead on the
+      * timeout. */
+    uint32_t ready_us;
+    /** Time from the end of the readout until the frame was processed, in
+      * microseconds: what sliced mode shortens. */
+    uint32_t process_us;
+    /** 1 if the pipeline stages were applied, 0 if the gate rejected the
+      * frame and image holds the unfiltered pixels. */
+    int filtered;
+    svf10_image_stats_t stats;
+    /** Block coverage if the pipeline has a BLOCKS stage, else zeroed. */
+    svf10_coverage_t coverage;
+    uint8_t raw[SVF10_FRAME_SIZE];
+    /** Pipeline output, packed 96x96: the pixels of buffer. */
+    uint8_t* image;
+    svf10_image_buffer_t* buffer;
+} svf10_frame_t;
+
+/** Lock-free SPSC ring of frames. head_ is only written by the producer and
+  * tail_ only by the consumer; the release/acquire pairs on them order the
+  * frame contents with respect to the hand-over. */
+class Svf10FrameRing {
+public:
+    Svf10FrameRing() : head_(0), tail_(0), frames_() {}
+
+    /** Producer: returns the slot to fill next, or 0 if the ring is full. */
+    svf10_frame_t* begin_write()
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == SVF10_CAPTURE_FRAMES)
+            return 0;
+        return &frames_[head % SVF10_CAPTURE_FRAMES];
+    }
+
+    /** Producer: publishes the slot returned by begin_write(). */
+    void commit_write()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Consumer: returns the newest published frame, releasing any older
+      * ones unread, or 0 if nothing was published since the last call.
+      * The frame stays valid until end_read(); calling this again first
+      * also releases it once a newer frame is there. */
+    const svf10_frame_t* begin_read_latest()
+    {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (head == tail_.load(std::memory_order_relaxed))
+            return 0;
+        tail_.store(head - 1, std::memory_order_release);
+        return &frames_[(head - 1) % SVF10_CAPTURE_FRAMES];
+    }
+
+    /** Consumer: releases the frame returned by begin_read_latest(). */
+    void end_read()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Consumer: takes the image buffer of the frame returned by
+      * begin_read_latest(), leaving the frame without one. The caller
+      * puts it back with svf10_image_pool_put() when done, which may be
+      * long after end_read(). */
+    svf10_image_buffer_t* detach_image(const svf10_frame_t* frame)
+    {
+        svf10_frame_t* slot = const_cast<svf10_frame_t*>(frame);
+        svf10_image_buffer_t* buffer = slot->buffer;
+
+        slot->buffer = 0;
+        slot->image = 0;
+        return buffer;
+    }
+
+    /** Puts back the image buffers of all frames. Only while no thread uses
+      * the ring. */
+    void release_images()
+    {
+        for (int i = 0; i < SVF10_CAPTURE_FRAMES; i++) {
+            svf10_image_pool_put(frames_[i].buffer);
+            frames_[i].buffer = 0;
+            frames_[i].image = 0;
+        }
+    }
+
+    /** Drops everything published. Only while no thread uses the ring. */
+    void reset()
+    {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    /* Kept on separate cache lines so producer and consumer do not
+     * invalidate each other's index on every frame. */
+    alignas(64) std::atomic<uint32_t> head_;
+    alignas(64) std::atomic<uint32_t> tail_;
+    svf10_frame_t frames_[SVF10_CAPTURE_FRAMES];
+};
+
+class Svf10Capture {
+public:
+    explicit Svf10Capture(Svf10Device& device);
+    ~Svf10Capture();
+
+    /** Starts the capture thread running the given pipeline stages on every
+      * frame, with a variance gate as in svf10_pipeline_set_gate(). The
+      * device must be open. While the thread runs it is the only user of
+      * the device.
+      *
+      * @return 0 if successful or already running, -1 otherwise. */
+    int start(const svf10_stage_t* stages, int nstages, double gate);
+
+    /** Stops the capture thread and waits for it to exit. */
+    void stop();
+
+    /** Reads frames in bursts of rows rows from the next start() on, with
+      * the pipeline's first sweep on a second thread as they arrive. 0,
+      * the default, reads each frame in one piece. */
+    void set_slice_rows(int rows) { slice_rows_ = rows; }
+
+    bool is_running() const { return running_; }
+
+    /** Consumer side, see Svf10FrameRing. A single thread at a time. */
+    const svf10_frame_t* begin_read_latest() { return ring_.begin_read_latest(); }
+    void end_read() { ring_.end_read(); }
+    svf10_image_buffer_t* detach_image(const svf10_frame_t* frame) { return ring_.detach_image(frame); }
+
+    /** Frames dropped because the ring was full or every image buffer was
+      * detached, and failed reads. */
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint32_t errors() const { return errors_.load(std::memory_order_relaxed); }
+
+private:
+    Svf10Capture(const Svf10Capture&);
+    Svf10Capture& operator=(const Svf10Capture&);
+
+    static void* thread_main(void* arg);
+    static void* process_main(void* arg);
+    void run();
+    svf10_frame_t* begin_frame();
+    int read_sliced(svf10_frame_t* frame);
+    void slice_post(int rows);
+    void finish_frame(svf10_frame_t* frame);
+    void process();
+
+    Svf10Device& device_;
+    svf10_pipeline_t* pipeline_;
+    svf10_image_pool_t* pool_;
+    pthread_t thread_;
+    bool running_;
+    std::atomic<bool> stop_;
+    std::atomic<uint32_t> dropped_;
+    std::atomic<uint32_t> errors_;
+    uint32_t sequence_;
+    int slice_rows_;
+
+    /* Sliced mode: run() hands the frame it reads to process() and posts
+     * how many of its rows arrived, -1 if the read failed; process() sets
+     * slice_frame_ back to 0 once the frame is processed. */
+    pthread_t process_thread_;
+    pthread_mutex_t slice_lock_;
+    pthread_cond_t slice_cond_;
+    svf10_frame_t* slice_frame_;
+    int slice_received_;
+    bool slice_exit_;
+
+    /* Receive buffer for frames the ring has no room for. */
+    uint8_t overflow_[SVF10_FRAME_SIZE];
+    Svf10FrameRing ring_;
+};
+
+#endif /* SVF10_CAPTURE_H */
@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <string.h>
+#include "svf10_context.h"
+#include "bitmap.h"
+
+svf10_context_t* svf10_context_create(void)
+{
+    svf10_context_t* ctx = (svf10_context_t*) calloc(1, sizeof(*ctx));
+
+    if (!ctx)
+        return 0;
+    memcpy(ctx->bmp, bitmap_header_data, sizeof(ctx->bmp));
+    return ctx;
+}
+
+void svf10_context_delete(svf10_context_t* ctx)
+{
+    if (!ctx)
+        return;
+    svf10_pipeline_delete(ctx->display);
+    svf10_pipeline_delete(ctx->quality);
+    free(ctx);
+}
+
+void svf10_context_quality(svf10_context_t* ctx, double min_variance)
+{
+    svf10_integral_build(&ctx->integral, SVF10_FRAME_PIXELS(ctx->raw), SVF10_FRAME_STRIDE);
+    svf10_integral_stats(&ctx->integral, 0, 0, SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH, &ctx->stats);
+    svf10_coverage(&ctx->integral, min_variance, SVF10_PRESENT_BLOCKS, &ctx->coverage);
+}
+
+void svf10_context_histogram(svf10_context_t* ctx)
+{
+    const uint8_t* row = SVF10_FRAME_PIXELS(ctx->raw);
+    uint32_t count[256];
+    uint32_t cdf = 0;
+    int i, j;
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < SVF10_IMAGE_HEIGHT; i++, row += SVF10_FRAME_STRIDE)
+        for (j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            count[row[j]]++;
+    for (i = 0; i < 256; i++) {
+        cdf += count[i];
+        ctx->histogram[i] = cdf / (double) SVF10_IMAGE_SIZE;
+    }
+}
+
+void svf10_context_write_bmp(svf10_context_t* ctx)
+{
+    const uint8_t* row = SVF10_FRAME_PIXELS(ctx->raw);
+    uint8_t* dst = ctx->bmp + SVF10_BMP_HEADER_SIZE;
+    int i;
+
+    for (i = 0; i < SVF10_IMAGE_HEIGHT; i++, row += SVF10_FRAME_STRIDE, dst += SVF10_IMAGE_WIDTH)
+        memcpy(dst, row, SVF10_IMAGE_WIDTH);
+}
+
+void svf10_context_invert_bmp(svf10_context_t* ctx)
+{
+    uint8_t* dst = ctx->bmp + SVF10_BMP_HEADER_SIZE;
+    int i;
+
+    for (i = 0; i < SVF10_IMAGE_SIZE; i++)
+        dst[i] = 255 - dst[i];
+}
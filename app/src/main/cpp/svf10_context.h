@@ -0,0 +1,77 @@
+/*
+ * SVF10 processing context.
+ *
+ * Holds every buffer a frame passes through between the SPI receive buffer
+ * and the application: the raw frame, the preprocessed image, its
+ * statistics and histogram, the BMP export and the pipelines that produce
+ * them. A context is used by one thread at a time; contexts share nothing,
+ * so several sensors or threads process frames in parallel without
+ * locking.
+ */
+
+#ifndef SVF10_CONTEXT_H
+#define SVF10_CONTEXT_H
+
+#include <stdint.h>
+#include "svf10_filter.h"
+#include "svf10_pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** 8-bit BMP export: file and info header plus the 256 entry grey palette,
+  * then the pixels. SVF10_BMP_SIZE is the file size the header records. */
+#define SVF10_BMP_HEADER_SIZE    1078
+#define SVF10_BMP_SIZE           10296
+
+typedef struct svf10_context_st {
+    /** Last frame read from the sensor (was svf10_origine_buffer). */
+    uint8_t raw[SVF10_FRAME_SIZE];
+    /** Preprocessed 96x96 image (svf10_image). */
+    uint8_t image[SVF10_IMAGE_SIZE];
+    /** Mean and variance of the last quality check or pipeline run
+      * (temp, temp2). */
+    svf10_image_stats_t stats;
+    /** Block coverage of the last quality check or pipeline run. */
+    svf10_coverage_t coverage;
+    /** Summed-area tables of the last quality check. */
+    svf10_integral_t integral;
+    /** Normalized cumulative histogram of raw (histogram). */
+    double histogram[256];
+    /** BMP file of raw (bitmap_header_data). */
+    uint8_t bmp[SVF10_BMP_SIZE];
+    /** Pipelines of the display (FPLoop) and quality (FPgetTemp2) paths,
+      * created on first use and deleted with the context. */
+    svf10_pipeline_t* display;
+    svf10_pipeline_t* quality;
+} svf10_context_t;
+
+/** Creates a context with zeroed buffers and the BMP header in place.
+  *
+  * @return the context, or 0 if out of memory. */
+svf10_context_t* svf10_context_create(void);
+
+/** Deletes a context and its pipelines. */
+void svf10_context_delete(svf10_context_t* ctx);
+
+/** Sets stats to the mean and variance of the raw frame's pixels
+  * (image_quality) and coverage to its blocks whose variance is above
+  * min_variance. */
+void svf10_context_quality(svf10_context_t* ctx, double min_variance);
+
+/** Computes the normalized cumulative histogram of the raw frame's
+  * pixels (histo). */
+void svf10_context_histogram(svf10_context_t* ctx);
+
+/** Copies the raw frame's pixels into the BMP export (SVF10_Send_Image). */
+void svf10_context_write_bmp(svf10_context_t* ctx);
+
+/** Inverts the pixels of the BMP export (SVF10_Send_Image_mark). */
+void svf10_context_invert_bmp(svf10_context_t* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_CONTEXT_H */
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "svf10_convert.h"
+#include "svf10_filter.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SVF10_CONVERT_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SVF10_CONVERT_SSE2
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* Scalar reference implementation                                           */
+/* ------------------------------------------------------------------------- */
+
+static void grey_to_rgba_tail(uint8_t* dst, const uint8_t* src, size_t i, size_t n)
+{
+    for (; i < n; i++) {
+        dst[4 * i + 0] = src[i];
+        dst[4 * i + 1] = src[i];
+        dst[4 * i + 2] = src[i];
+        dst[4 * i + 3] = 0xFF;
+    }
+}
+
+void svf10_convert_grey_to_rgba_ref(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    grey_to_rgba_tail(dst, src, 0, n);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Vector implementations                                                    */
+/* ------------------------------------------------------------------------- */
+
+#if defined(SVF10_CONVERT_NEON)
+
+void svf10_convert_grey_to_rgba(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    uint8x16x4_t rgba;
+    size_t i = 0;
+
+    rgba.val[3] = vdupq_n_u8(0xFF);
+    for (; i + 16 <= n; i += 16) {
+        rgba.val[0] = vld1q_u8(src + i);
+        rgba.val[1] = rgba.val[0];
+        rgba.val[2] = rgba.val[0];
+        /* vst4 interleaves the four registers into R, G, B, A. */
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+    grey_to_rgba_tail(dst, src, i, n);
+}
+
+#elif defined(SVF10_CONVERT_SSE2)
+
+void svf10_convert_grey_to_rgba(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    const __m128i alpha = _mm_set1_epi8((char) 0xFF);
+    __m128i g, gg, ga;
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        g = _mm_loadu_si128((const __m128i*) (src + i));
+        /* gg holds g,g pairs and ga holds g,0xFF pairs; interleaving the
+         * two as 16-bit words gives g,g,g,0xFF. */
+        gg = _mm_unpacklo_epi8(g, g);
+        ga = _mm_unpacklo_epi8(g, alpha);
+        _mm_storeu_si128((__m128i*) (dst + 4 * i), _mm_unpacklo_epi16(gg, ga));
+        _mm_storeu_si128((__m128i*) (dst + 4 * i + 16), _mm_unpackhi_epi16(gg, ga));
+        gg = _mm_unpackhi_epi8(g, g);
+        ga = _mm_unpackhi_epi8(g, alpha);
+        _mm_storeu_si128((__m128i*) (dst + 4 * i + 32), _mm_unpacklo_epi16(gg, ga));
+        _mm_storeu_si128((__m128i*) (dst + 4 * i + 48), _mm_unpackhi_epi16(gg, ga));
+    }
+    grey_to_rgba_tail(dst, src, i, n);
+}
+
+#else
+
+void svf10_convert_grey_to_rgba(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    grey_to_rgba_tail(dst, src, 0, n);
+}
+
+#endif
+
+void svf10_convert_image_to_rgba(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride)
+{
+    if (dst_stride == 4 * SVF10_IMAGE_WIDTH && src_stride == SVF10_IMAGE_WIDTH) {
+        svf10_convert_grey_to_rgba(dst, src, SVF10_IMAGE_SIZE);
+        return;
+    }
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        svf10_convert_grey_to_rgba(dst + i * dst_stride, src + i * src_stride, SVF10_IMAGE_WIDTH);
+}
+
+void svf10_convert_image_to_grey(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride)
+{
+    if (dst_stride == SVF10_IMAGE_WIDTH && src_stride == SVF10_IMAGE_WIDTH) {
+        memcpy(dst, src, SVF10_IMAGE_SIZE);
+        return;
+    }
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        memcpy(dst + i * dst_stride, src + i * src_stride, SVF10_IMAGE_WIDTH);
+}
+
+const char* svf10_convert_impl(void)
+{
+#if defined(SVF10_CONVERT_NEON)
+    return "neon";
+#elif defined(SVF10_CONVERT_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,40 @@
+/*
+ * SVF10 image format conversion for delivery to Java.
+ *
+ * The processed image is 8-bit grey. Android draws RGBA_8888 bitmaps, whose
+ * pixels are stored R, G, B, A in memory, so displaying it means expanding
+ * every grey byte to four. Consumers that only read the pixels should take
+ * the grey bytes directly (an ALPHA_8 bitmap or a direct ByteBuffer).
+ */
+
+#ifndef SVF10_CONVERT_H
+#define SVF10_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Expands n grey pixels to opaque RGBA_8888: dst[4i..4i+3] =
+  * { src[i], src[i], src[i], 0xFF }. */
+void svf10_convert_grey_to_rgba(uint8_t* dst, const uint8_t* src, size_t n);
+
+/** Writes a 96x96 grey image into an RGBA_8888 or 8-bit grey pixel buffer
+  * with the given row stride in bytes. */
+void svf10_convert_image_to_rgba(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride);
+void svf10_convert_image_to_grey(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride);
+
+/** Scalar reference implementation of svf10_convert_grey_to_rgba. */
+void svf10_convert_grey_to_rgba_ref(uint8_t* dst, const uint8_t* src, size_t n);
+
+/** Returns the name of the vector path compiled in: "neon", "sse2" or
+  * "scalar". */
+const char* svf10_convert_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_CONVERT_H */
@@ -0,0 +1,115 @@
+#include <string.h>
+#include <pthread.h>
+#include "svf10_crc32.h"
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#if !defined(__ARM_FEATURE_CRC32)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#define SVF10_CRC32_ARMV8
+#endif
+
+#define POLYNOMIAL 0xEDB88320u
+
+/* table[k][b] is the CRC of byte b followed by k zero bytes. */
+static uint32_t table[8][256];
+
+typedef uint32_t crc32_fn(uint32_t crc, const uint8_t* p, size_t n);
+
+static crc32_fn* crc32_impl;
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+static uint32_t crc32_bytes(uint32_t crc, const uint8_t* p, size_t n)
+{
+    while (n--)
+        crc = table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+/* Eight bytes per step from eight tables. Assumes a little-endian CPU. */
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t* p, size_t n)
+{
+    uint32_t a, b;
+
+    for (; n >= 8; n -= 8, p += 8) {
+        memcpy(&a, p, 4);
+        memcpy(&b, p + 4, 4);
+        a ^= crc;
+        crc = table[7][a & 0xFF] ^ table[6][(a >> 8) & 0xFF]
+            ^ table[5][(a >> 16) & 0xFF] ^ table[4][a >> 24]
+            ^ table[3][b & 0xFF] ^ table[2][(b >> 8) & 0xFF]
+            ^ table[1][(b >> 16) & 0xFF] ^ table[0][b >> 24];
+    }
+    return crc32_bytes(crc, p, n);
+}
+
+#if defined(SVF10_CRC32_ARMV8)
+
+#if !defined(__ARM_FEATURE_CRC32)
+__attribute__((target("crc")))
+#endif
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t* p, size_t n)
+{
+    uint64_t v;
+
+    for (; n && ((uintptr_t) p & 7); n--)
+        crc = __crc32b(crc, *p++);
+    for (; n >= 8; n -= 8, p += 8) {
+        memcpy(&v, p, 8);
+        crc = __crc32d(crc, v);
+    }
+    while (n--)
+        crc = __crc32b(crc, *p++);
+    return crc;
+}
+
+#endif
+
+static void init(void)
+{
+    uint32_t crc;
+    int i, j, k;
+
+    for (i = 0; i < 256; i++) {
+        crc = (uint32_t) i;
+        for (j = 0; j < 8; j++)
+            crc = crc & 1 ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+        table[0][i] = crc;
+    }
+    for (k = 1; k < 8; k++)
+        for (i = 0; i < 256; i++)
+            table[k][i] = table[0][table[k - 1][i] & 0xFF] ^ (table[k - 1][i] >> 8);
+
+    crc32_impl = crc32_slice8;
+#if defined(SVF10_CRC32_ARMV8)
+#if defined(__ARM_FEATURE_CRC32)
+    crc32_impl = crc32_armv8;
+#else
+    /* Optional before ARMv8.1; every Android arm64 device to date has it,
+     * but ask the kernel rather than assume. */
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        crc32_impl = crc32_armv8;
+#endif
+#endif
+}
+
+uint32_t svf10_crc32(uint32_t crc, const void* data, size_t n)
+{
+    pthread_once(&once, init);
+    return ~crc32_impl(~crc, (const uint8_t*) data, n);
+}
+
+uint32_t svf10_crc32_ref(uint32_t crc, const void* data, size_t n)
+{
+    pthread_once(&once, init);
+    return ~crc32_bytes(~crc, (const uint8_t*) data, n);
+}
+
+const char* svf10_crc32_impl(void)
+{
+    pthread_once(&once, init);
+    return crc32_impl == crc32_slice8 ? "slice8" : "armv8";
+}
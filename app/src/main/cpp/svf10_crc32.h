@@ -0,0 +1,35 @@
+/*
+ * CRC-32.
+ *
+ * The CRC-32 of zlib and PNG (reflected polynomial 0xEDB88320), the one
+ * pb_crc32 computes. ARMv8 cores that have the CRC32 extension compute
+ * it eight bytes per instruction; elsewhere it is table driven, eight
+ * bytes per step.
+ */
+
+#ifndef SVF10_CRC32_H
+#define SVF10_CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Continues crc, the CRC-32 of the bytes before data, over n more bytes.
+  * Start with 0: svf10_crc32(0, data, n) equals pb_crc32(data, n). */
+uint32_t svf10_crc32(uint32_t crc, const void* data, size_t n);
+
+/** Bytewise reference implementation of the above. */
+uint32_t svf10_crc32_ref(uint32_t crc, const void* data, size_t n);
+
+/** Returns the name of the implementation svf10_crc32 uses on this CPU:
+  * "armv8" or "slice8". */
+const char* svf10_crc32_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_CRC32_H */
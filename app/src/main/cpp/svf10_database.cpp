@@ -0,0 +1,909 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "svf10_database.h"
+#include "svf10_crc32.h"
+#include "pb_user.h"
+
+#define DB_MAGIC        "SVF10DB"
+#define DB_VERSION      2
+#define DB_DEFAULT_PATH "svf10.db"
+
+/* The file header takes the first page; records follow it. */
+#define HEADER_SIZE     4096
+#define RECORD_ALIGN    8
+
+#define RECORD_INSERT   1
+#define RECORD_DELETE   2
+
+#define MAX_LISTENERS   4
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+} file_header_t;
+
+/* A record is this header, then data_size bytes of template data, padded
+ * with zeros to RECORD_ALIGN. crc covers the rest of the header and the
+ * data; a record that fails it was cut short and ends the journal. A
+ * delete is a record of its own, without data. Records are never changed
+ * once written. */
+typedef struct {
+    uint32_t crc;
+    uint32_t size;
+    uint32_t user_id;
+    uint32_t acquisition;
+    uint16_t position;
+    uint16_t type;
+    uint16_t kind;
+    uint16_t reserved;
+    uint32_t data_size;
+} record_t;
+
+typedef struct {
+    uint32_t user_id;
+    uint32_t acquisition;
+    uint32_t position;
+} finger_key_t;
+
+typedef struct {
+    finger_key_t key;
+    /* Of the record, from the end of the file header. */
+    uint64_t offset;
+} index_entry_t;
+
+/* A mapping, shared by the session and every template handed out from it.
+ * Compaction replaces the session's mapping; templates keep the old one. */
+typedef struct {
+    uint8_t* base;
+    int refs;
+} mapping_t;
+
+typedef struct {
+    pb_databaseI_listener_fn_t* fn;
+    const void* context;
+} listener_t;
+
+static struct {
+    pthread_mutex_t lock;
+    char* path;
+    uint32_t compact_threshold;
+    pb_session_t* session;
+    int fd;
+    mapping_t* mapping;
+    size_t file_size;
+    /* Bytes of valid records after the header. */
+    uint64_t used;
+    /* Of those, bytes no longer in the index. */
+    uint64_t dead;
+    /* Sorted by key. */
+    index_entry_t* index;
+    int nindex;
+    int capacity;
+    listener_t listeners[MAX_LISTENERS];
+    int nlisteners;
+
+    pthread_t compactor;
+    pthread_cond_t compact;
+    /* Dead bytes above which the compactor runs; raised after a failed
+     * compaction so it is not retried on every write. */
+    uint64_t compact_at;
+    int compactor_running;
+    int stopping;
+} Db = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, -1, 0, 0, 0, 0, 0, 0, 0, {}, 0,
+         pthread_t(), PTHREAD_COND_INITIALIZER, 0, 0, 0 };
+
+static record_t* record_at(const mapping_t* mapping, uint64_t offset)
+{
+    return (record_t*) (mapping->base + HEADER_SIZE + offset);
+}
+
+static uint32_t record_crc(const record_t* r)
+{
+    return svf10_crc32(0, &r->size, sizeof(record_t) - sizeof(r->crc) + r->data_size);
+}
+
+static uint32_t record_size(uint32_t data_size)
+{
+    return (uint32_t) ((sizeof(record_t) + data_size + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN);
+}
+
+static uint64_t compact_threshold(void)
+{
+    return Db.compact_threshold ? Db.compact_threshold : SVF10_DATABASE_COMPACT_THRESHOLD;
+}
+
+static void mapping_release(void* object)
+{
+    mapping_t* mapping = (mapping_t*) object;
+
+    if (__sync_sub_and_fetch(&mapping->refs, 1) == 0) {
+        munmap(mapping->base, SVF10_DATABASE_MAX_SIZE);
+        free(mapping);
+    }
+}
+
+/* Maps the whole of SVF10_DATABASE_MAX_SIZE of fd; past the end of the
+ * file the reservation is address space only. */
+static mapping_t* mapping_create(int fd)
+{
+    mapping_t* mapping = (mapping_t*) calloc(1, sizeof(*mapping));
+    void* base;
+
+    if (!mapping)
+        return 0;
+    base = mmap(0, SVF10_DATABASE_MAX_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        free(mapping);
+        return 0;
+    }
+    mapping->base = (uint8_t*) base;
+    mapping->refs = 1;
+    return mapping;
+}
+
+/* Writes the pages holding [offset, offset + size) of the file to disk and
+ * waits for them. */
+static int sync_range(const mapping_t* mapping, uint64_t offset, uint64_t size)
+{
+    uint64_t page = (uint64_t) sysconf(_SC_PAGESIZE);
+    uint64_t start = offset / page * page;
+
+    return msync(mapping->base + start, offset + size - start, MS_SYNC);
+}
+
+static finger_key_t finger_key(const pb_finger_t* finger)
+{
+    finger_key_t key;
+
+    key.user_id = pb_finger_get_user_id(finger);
+    key.acquisition = pb_finger_get_acquisition(finger);
+    key.position = pb_finger_get_position(finger);
+    return key;
+}
+
+static finger_key_t record_key(const record_t* r)
+{
+    finger_key_t key;
+
+    key.user_id = r->user_id;
+    key.acquisition = r->acquisition;
+    key.position = r->position;
+    return key;
+}
+
+static int key_compare(const finger_key_t* a, const finger_key_t* b)
+{
+    if (a->user_id != b->user_id)
+        return a->user_id < b->user_id ? -1 : 1;
+    if (a->position != b->position)
+        return a->position < b->position ? -1 : 1;
+    if (a->acquisition != b->acquisition)
+        return a->acquisition < b->acquisition ? -1 : 1;
+    return 0;
+}
+
+/* Returns 1 if key is in the index, with *at its position, else 0 with *at
+ * where it would go. */
+static int index_find(const finger_key_t* key, int* at)
+{
+    int lo = 0, hi = Db.nindex, mid, c;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        c = key_compare(&Db.index[mid].key, key);
+        if (c == 0) {
+            *at = mid;
+            return 1;
+        }
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *at = lo;
+    return 0;
+}
+
+/* Points key at the record at offset. Returns 0 if out of memory. */
+static int index_put(const finger_key_t* key, uint64_t offset)
+{
+    index_entry_t* index;
+    int at, capacity;
+
+    if (index_find(key, &at)) {
+        Db.index[at].offset = offset;
+        return 1;
+    }
+    if (Db.nindex == Db.capacity) {
+        capacity = Db.capacity ? 2 * Db.capacity : 64;
+        index = (index_entry_t*) realloc(Db.index, capacity * sizeof(*index));
+        if (!index)
+            return 0;
+        Db.index = index;
+        Db.capacity = capacity;
+    }
+    memmove(&Db.index[at + 1], &Db.index[at], (Db.nindex - at) * sizeof(*Db.index));
+    Db.index[at].key = *key;
+    Db.index[at].offset = offset;
+    Db.nindex++;
+    return 1;
+}
+
+static void index_remove(int at)
+{
+    memmove(&Db.index[at], &Db.index[at + 1], (Db.nindex - at - 1) * sizeof(*Db.index));
+    Db.nindex--;
+}
+
+/* Applies the record at offset of the session's mapping to the index.
+ * Returns 0 if out of memory. */
+static int replay(uint64_t offset)
+{
+    const record_t* r = record_at(Db.mapping, offset);
+    finger_key_t key = record_key(r);
+    int at;
+
+    if (r->kind == RECORD_INSERT)
+        return index_put(&key, offset);
+    if (index_find(&key, &at))
+        index_remove(at);
+    return 1;
+}
+
+/* Bytes of the records the index points at. */
+static uint64_t live_size(void)
+{
+    uint64_t live = 0;
+
+    for (int i = 0; i < Db.nindex; i++)
+        live += record_at(Db.mapping, Db.index[i].offset)->size;
+    return live;
+}
+
+/* Replays the journal into the index, up to the first record that is cut
+ * short or fails its CRC. */
+static pb_rc_t recover(void)
+{
+    uint64_t offset = 0, end = Db.file_size - HEADER_SIZE;
+    const record_t* r;
+
+    while (offset + sizeof(record_t) <= end) {
+        r = record_at(Db.mapping, offset);
+        if (r->size < sizeof(record_t) || r->size % RECORD_ALIGN || r->size > end - offset
+            || r->data_size > r->size - sizeof(record_t)
+            || (r->kind != RECORD_INSERT && r->kind != RECORD_DELETE)
+            || r->crc != record_crc(r))
+            break;
+        if (!replay(offset))
+            return PB_RC_MEMORY_ALLOCATION_FAILED;
+        offset += r->size;
+    }
+    Db.used = offset;
+    Db.dead = offset - live_size();
+    return PB_RC_OK;
+}
+
+/* Grows the file to hold size bytes. */
+static pb_rc_t reserve(size_t size)
+{
+    size_t grown;
+
+    if (size <= Db.file_size)
+        return PB_RC_OK;
+    if (size > SVF10_DATABASE_MAX_SIZE)
+        return PB_RC_CAPACITY;
+    grown = (size + SVF10_DATABASE_GROW - 1) / SVF10_DATABASE_GROW * SVF10_DATABASE_GROW;
+    if (grown > SVF10_DATABASE_MAX_SIZE)
+        grown = SVF10_DATABASE_MAX_SIZE;
+    if (ftruncate(Db.fd, (off_t) grown) != 0)
+        return PB_RC_FILE_WRITE_FAILED;
+    Db.file_size = grown;
+    return PB_RC_OK;
+}
+
+static const char* db_path(void)
+{
+    return Db.path ? Db.path : DB_DEFAULT_PATH;
+}
+
+/* Makes a rename in the directory of path durable. */
+static void sync_directory(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    char* dir;
+    int fd;
+
+    dir = slash ? strndup(path, slash == path ? 1 : (size_t) (slash - path)) : strdup(".");
+    if (!dir)
+        return;
+    fd = open(dir, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+static void close_db(void)
+{
+    if (Db.mapping) {
+        mapping_release(Db.mapping);
+        Db.mapping = 0;
+    }
+    if (Db.fd >= 0)
+        close(Db.fd);
+    Db.fd = -1;
+    free(Db.index);
+    Db.index = 0;
+    Db.nindex = Db.capacity = 0;
+    Db.used = Db.dead = 0;
+}
+
+static pb_rc_t open_db(void)
+{
+    static const file_header_t empty = { { 0 }, 0, 0 };
+    struct stat st;
+    file_header_t* h;
+    pb_rc_t rc;
+
+    Db.fd = open(db_path(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (Db.fd < 0)
+        return PB_RC_FILE_OPEN_FAILED;
+    if (fstat(Db.fd, &st) != 0 || (size_t) st.st_size > SVF10_DATABASE_MAX_SIZE) {
+        close_db();
+        return PB_RC_FILE_READ_FAILED;
+    }
+    Db.file_size = (size_t) st.st_size;
+    Db.mapping = mapping_create(Db.fd);
+    if (!Db.mapping) {
+        close_db();
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    }
+
+    /* A new file, or one whose creation did not get as far as the
+     * header. */
+    h = (file_header_t*) Db.mapping->base;
+    if (Db.file_size < HEADER_SIZE || !memcmp(h, &empty, sizeof(empty))) {
+        rc = reserve(HEADER_SIZE);
+        if (rc != PB_RC_OK) {
+            close_db();
+            return rc;
+        }
+        memcpy(h->magic, DB_MAGIC, sizeof(h->magic));
+        h->version = DB_VERSION;
+        h->header_size = HEADER_SIZE;
+        sync_range(Db.mapping, 0, HEADER_SIZE);
+    }
+    if (memcmp(h->magic, DB_MAGIC, sizeof(h->magic)) || h->version != DB_VERSION
+        || h->header_size != HEADER_SIZE) {
+        close_db();
+        return PB_RC_WRONG_DATA_FORMAT;
+    }
+
+    rc = recover();
+    /* Whatever follows the journal is cut off, so that the next record
+     * written cannot end up in front of an older one that would pass its
+     * CRC. */
+    if (rc == PB_RC_OK && ftruncate(Db.fd, (off_t) (HEADER_SIZE + Db.used)) != 0)
+        rc = PB_RC_FILE_WRITE_FAILED;
+    if (rc != PB_RC_OK) {
+        close_db();
+        return rc;
+    }
+    Db.file_size = HEADER_SIZE + Db.used;
+    Db.compact_at = compact_threshold();
+    return PB_RC_OK;
+}
+
+/* Appends a record and waits until it is on disk. Called with the lock
+ * held; *offset is where it went. */
+static pb_rc_t append(const finger_key_t* key, int kind, pb_template_type_t type,
+                      const uint8_t* data, uint32_t data_size, uint64_t* offset)
+{
+    uint32_t size = record_size(data_size);
+    record_t* r;
+    pb_rc_t rc;
+
+    rc = reserve(HEADER_SIZE + Db.used + size);
+    if (rc != PB_RC_OK)
+        return rc;
+    r = record_at(Db.mapping, Db.used);
+    r->size = size;
+    r->user_id = key->user_id;
+    r->acquisition = key->acquisition;
+    r->position = (uint16_t) key->position;
+    r->type = (uint16_t) type;
+    r->kind = (uint16_t) kind;
+    r->reserved = 0;
+    r->data_size = data_size;
+    if (data_size)
+        memcpy(r + 1, data, data_size);
+    memset((uint8_t*) (r + 1) + data_size, 0, size - sizeof(record_t) - data_size);
+    r->crc = record_crc(r);
+    /* On failure the record is left past the end of the journal, to be
+     * written over. */
+    if (sync_range(Db.mapping, HEADER_SIZE + Db.used, size) != 0)
+        return PB_RC_FILE_WRITE_FAILED;
+    *offset = Db.used;
+    Db.used += size;
+    return PB_RC_OK;
+}
+
+static void wake_compactor(void)
+{
+    if (Db.dead > Db.compact_at)
+        pthread_cond_signal(&Db.compact);
+}
+
+/* Copies size bytes of records from the mapping at offset to the end of
+ * fd. */
+static int copy_out(int fd, const mapping_t* mapping, uint64_t offset, uint64_t size)
+{
+    const uint8_t* p = mapping->base + HEADER_SIZE + offset;
+    ssize_t n;
+
+    while (size) {
+        n = write(fd, p, size);
+        if (n <= 0)
+            return 0;
+        p += n;
+        size -= (uint64_t) n;
+    }
+    return 1;
+}
+
+/* Rewrites the file with only the records in the index. The records
+ * indexed when it starts are copied without the lock, as records never
+ * change once written. Those appended meanwhile are copied with the lock
+ * held, then the new file is renamed over the old one and the index
+ * rebuilt by replaying them. A crash at any point leaves either the old
+ * file or the new one. */
+static pb_rc_t compact(void)
+{
+    file_header_t h;
+    index_entry_t* index;
+    mapping_t* old;
+    mapping_t* mapping;
+    uint64_t end, offset, tail;
+    char* tmp;
+    int nindex, fd, i;
+    pb_rc_t rc = PB_RC_FILE_WRITE_FAILED;
+
+    tmp = (char*) malloc(strlen(db_path()) + 5);
+    if (!tmp)
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    sprintf(tmp, "%s.tmp", db_path());
+
+    pthread_mutex_lock(&Db.lock);
+    old = Db.mapping;
+    __sync_add_and_fetch(&old->refs, 1);
+    end = Db.used;
+    nindex = Db.nindex;
+    index = (index_entry_t*) malloc((nindex ? nindex : 1) * sizeof(*index));
+    if (index)
+        memcpy(index, Db.index, nindex * sizeof(*index));
+    pthread_mutex_unlock(&Db.lock);
+
+    fd = index ? open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600) : -1;
+    if (fd < 0) {
+        rc = index ? PB_RC_FILE_OPEN_FAILED : PB_RC_MEMORY_ALLOCATION_FAILED;
+        goto done;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DB_MAGIC, sizeof(h.magic));
+    h.version = DB_VERSION;
+    h.header_size = HEADER_SIZE;
+    if (write(fd, &h, sizeof(h)) != sizeof(h) || ftruncate(fd, HEADER_SIZE) != 0
+        || lseek(fd, HEADER_SIZE, SEEK_SET) != HEADER_SIZE)
+        goto done;
+    offset = 0;
+    for (i = 0; i < nindex; i++) {
+        uint32_t size = record_at(old, index[i].offset)->size;
+
+        if (!copy_out(fd, old, index[i].offset, size))
+            goto done;
+        index[i].offset = offset;
+        offset += size;
+    }
+    if (fdatasync(fd) != 0)
+        goto done;
+
+    pthread_mutex_lock(&Db.lock);
+    if (Db.stopping || Db.mapping != old) {
+        pthread_mutex_unlock(&Db.lock);
+        goto done;
+    }
+    tail = Db.used - end;
+    mapping = 0;
+    if (copy_out(fd, old, end, tail) && fdatasync(fd) == 0
+        && (mapping = mapping_create(fd)) != 0 && rename(tmp, db_path()) == 0) {
+        sync_directory(db_path());
+        close(Db.fd);
+        Db.fd = fd;
+        fd = -1;
+        mapping_release(Db.mapping);
+        Db.mapping = mapping;
+        free(Db.index);
+        Db.index = index;
+        Db.nindex = Db.capacity = nindex;
+        index = 0;
+        Db.file_size = HEADER_SIZE + offset + tail;
+        for (Db.used = offset; Db.used < offset + tail; Db.used += record_at(mapping, Db.used)->size)
+            if (!replay(Db.used))
+                break;
+        if (Db.used == offset + tail) {
+            Db.dead = Db.used - live_size();
+            rc = PB_RC_OK;
+        } else {
+            /* Out of memory part way, the index no longer matches the
+             * journal; start over from the file. */
+            free(Db.index);
+            Db.index = 0;
+            Db.nindex = Db.capacity = 0;
+            rc = recover();
+        }
+    } else if (mapping) {
+        mapping_release(mapping);
+    }
+    pthread_mutex_unlock(&Db.lock);
+
+done:
+    if (fd >= 0) {
+        close(fd);
+        unlink(tmp);
+    }
+    mapping_release(old);
+    free(index);
+    free(tmp);
+    return rc;
+}
+
+static void* compactor_main(void* arg)
+{
+    pb_rc_t rc;
+
+    (void) arg;
+    pthread_mutex_lock(&Db.lock);
+    while (!Db.stopping) {
+        if (Db.dead <= Db.compact_at) {
+            pthread_cond_wait(&Db.compact, &Db.lock);
+            continue;
+        }
+        pthread_mutex_unlock(&Db.lock);
+        rc = compact();
+        pthread_mutex_lock(&Db.lock);
+        Db.compact_at = rc == PB_RC_OK ? compact_threshold() : Db.dead + compact_threshold();
+    }
+    pthread_mutex_unlock(&Db.lock);
+    return 0;
+}
+
+/* A template referencing the data of the record at offset. Called with the
+ * lock held. */
+static pb_template_t* record_template(uint64_t offset)
+{
+    const record_t* r = record_at(Db.mapping, offset);
+    pb_template_t* T;
+
+    __sync_add_and_fetch(&Db.mapping->refs, 1);
+    T = pb_template_create_mre((pb_template_type_t) r->type, (const uint8_t*) (r + 1), r->data_size,
+                               0, mapping_release, Db.mapping);
+    if (!T)
+        mapping_release(Db.mapping);
+    return T;
+}
+
+/* Listeners run without the lock, so they may call back into the
+ * database. */
+static void notify(pb_session_t* session, pb_databaseI_event_t event_,
+                   const pb_template_t* T, const pb_finger_t* finger)
+{
+    listener_t listeners[MAX_LISTENERS];
+    int n;
+
+    pthread_mutex_lock(&Db.lock);
+    n = Db.nlisteners;
+    memcpy(listeners, Db.listeners, sizeof(listeners));
+    pthread_mutex_unlock(&Db.lock);
+    for (int i = 0; i < n; i++)
+        listeners[i].fn(session, event_, T, finger, listeners[i].context);
+}
+
+static pb_rc_t start_session(pb_session_t* session)
+{
+    pb_rc_t rc;
+
+    pthread_mutex_lock(&Db.lock);
+    if (Db.session) {
+        rc = PB_RC_NOT_SUPPORTED;
+    } else {
+        rc = open_db();
+        if (rc == PB_RC_OK) {
+            Db.session = session;
+            Db.stopping = 0;
+            /* Without the compactor the database still works, only the
+             * space of dead records is not given back. */
+            Db.compactor_running = pthread_create(&Db.compactor, 0, compactor_main, 0) == 0;
+            wake_compactor();
+        }
+    }
+    pthread_mutex_unlock(&Db.lock);
+    return rc;
+}
+
+static pb_rc_t end_session(pb_session_t* session)
+{
+    pthread_mutex_lock(&Db.lock);
+    if (Db.session != session) {
+        pthread_mutex_unlock(&Db.lock);
+        return PB_RC_OK;
+    }
+    Db.stopping = 1;
+    pthread_cond_signal(&Db.compact);
+    pthread_mutex_unlock(&Db.lock);
+    if (Db.compactor_running)
+        pthread_join(Db.compactor, 0);
+    Db.compactor_running = 0;
+
+    pthread_mutex_lock(&Db.lock);
+    close_db();
+    Db.session = 0;
+    pthread_mutex_unlock(&Db.lock);
+    return PB_RC_OK;
+}
+
+static pb_rc_t insert_template(pb_session_t* session,
+                               pb_template_t* template_,
+                               pb_finger_t* finger)
+{
+    const uint8_t* data;
+    uint32_t data_size;
+    uint64_t offset;
+    finger_key_t key;
+    int at;
+    pb_rc_t rc;
+
+    if (!template_ || !finger)
+        return PB_RC_INVALID_PARAMETER;
+    data = pb_template_get_data(template_);
+    data_size = pb_template_get_data_size(template_);
+    if (data_size && !data)
+        return PB_RC_INVALID_PARAMETER;
+    if (data_size > SVF10_DATABASE_MAX_SIZE)
+        return PB_RC_CAPACITY;
+    key = finger_key(finger);
+
+    pthread_mutex_lock(&Db.lock);
+    if (!Db.session || Db.session != session) {
+        pthread_mutex_unlock(&Db.lock);
+        return PB_RC_NOT_INITIALIZED;
+    }
+    rc = append(&key, RECORD_INSERT, pb_template_get_type(template_), data, data_size, &offset);
+    if (rc == PB_RC_OK) {
+        if (index_find(&key, &at))
+            Db.dead += record_at(Db.mapping, Db.index[at].offset)->size;
+        /* Out of memory, the record is still on disk and found on the
+         * next start. */
+        if (!index_put(&key, offset))
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+        wake_compactor();
+    }
+    pthread_mutex_unlock(&Db.lock);
+
+    if (rc == PB_RC_OK)
+        notify(session, PB_DATABASE_EVENT_TEMPLATE_INSERTED, template_, finger);
+    return rc;
+}
+
+static pb_rc_t get_template(pb_session_t* session,
+                            const pb_finger_t* finger,
+                            pb_template_t** template_)
+{
+    finger_key_t key;
+    int at;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!finger || !template_)
+        return PB_RC_INVALID_PARAMETER;
+    *template_ = 0;
+    key = finger_key(finger);
+
+    pthread_mutex_lock(&Db.lock);
+    if (!Db.session || Db.session != session) {
+        rc = PB_RC_NOT_INITIALIZED;
+    } else if (!index_find(&key, &at)) {
+        rc = PB_RC_NOT_FOUND;
+    } else {
+        *template_ = record_template(Db.index[at].offset);
+        if (!*template_)
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+    }
+    pthread_mutex_unlock(&Db.lock);
+    return rc;
+}
+
+static pb_rc_t delete_template(pb_session_t* session, const pb_finger_t* finger)
+{
+    pb_template_t* T = 0;
+    uint64_t offset;
+    finger_key_t key;
+    int at;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!finger)
+        return PB_RC_INVALID_PARAMETER;
+    key = finger_key(finger);
+
+    pthread_mutex_lock(&Db.lock);
+    if (!Db.session || Db.session != session) {
+        rc = PB_RC_NOT_INITIALIZED;
+    } else if (!index_find(&key, &at)) {
+        rc = PB_RC_NOT_FOUND;
+    } else {
+        /* For the listeners. */
+        T = record_template(Db.index[at].offset);
+        rc = append(&key, RECORD_DELETE, PB_TEMPLATE_UNKNOWN, 0, 0, &offset);
+        if (rc == PB_RC_OK) {
+            Db.dead += record_at(Db.mapping, Db.index[at].offset)->size
+                     + record_at(Db.mapping, offset)->size;
+            index_remove(at);
+            wake_compactor();
+        }
+    }
+    pthread_mutex_unlock(&Db.lock);
+
+    if (rc == PB_RC_OK)
+        notify(session, PB_DATABASE_EVENT_TEMPLATE_DELETED, T, finger);
+    pb_template_delete(T);
+    return rc;
+}
+
+typedef struct {
+    finger_key_t* keys;
+    int n;
+    int next;
+} finger_iterator_t;
+
+static void* finger_iterator_next(void* context)
+{
+    finger_iterator_t* it = (finger_iterator_t*) context;
+    pb_finger_t* finger;
+    pb_user_t* user;
+    finger_key_t* key;
+
+    if (it->next >= it->n)
+        return 0;
+    key = &it->keys[it->next++];
+    user = pb_user_create(key->user_id);
+    if (!user)
+        return 0;
+    finger = pb_finger_create_acquisition((pb_finger_position_t) key->position, user, key->acquisition);
+    pb_user_delete(user);
+    return finger;
+}
+
+static void finger_iterator_delete(void* context)
+{
+    finger_iterator_t* it = (finger_iterator_t*) context;
+
+    free(it->keys);
+    free(it);
+}
+
+/* The iterator walks a copy of the index taken here, so inserts and
+ * deletes while iterating are safe, if not seen. */
+static pb_rc_t get_finger_iterator(pb_session_t* session, pb_iterator_t** finger_iterator)
+{
+    finger_iterator_t* it;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!finger_iterator)
+        return PB_RC_INVALID_PARAMETER;
+    *finger_iterator = 0;
+    it = (finger_iterator_t*) calloc(1, sizeof(*it));
+    if (!it)
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+
+    pthread_mutex_lock(&Db.lock);
+    if (!Db.session || Db.session != session) {
+        rc = PB_RC_NOT_INITIALIZED;
+    } else if (Db.nindex) {
+        it->keys = (finger_key_t*) malloc(Db.nindex * sizeof(*it->keys));
+        if (it->keys) {
+            for (int i = 0; i < Db.nindex; i++)
+                it->keys[i] = Db.index[i].key;
+            it->n = Db.nindex;
+        } else {
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+        }
+    }
+    pthread_mutex_unlock(&Db.lock);
+
+    if (rc == PB_RC_OK) {
+        *finger_iterator = pb_iterator_create(it, finger_iterator_next, finger_iterator_delete);
+        if (!*finger_iterator)
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+    }
+    if (rc != PB_RC_OK)
+        finger_iterator_delete(it);
+    return rc;
+}
+
+static pb_rc_t register_listener(pb_session_t* session,
+                                 pb_databaseI_listener_fn_t* listener,
+                                 const void* context)
+{
+    pb_rc_t rc = PB_RC_OK;
+
+    (void) session;
+    if (!listener)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&Db.lock);
+    if (Db.nlisteners < MAX_LISTENERS) {
+        Db.listeners[Db.nlisteners].fn = listener;
+        Db.listeners[Db.nlisteners].context = context;
+        Db.nlisteners++;
+    } else {
+        rc = PB_RC_CAPACITY;
+    }
+    pthread_mutex_unlock(&Db.lock);
+    return rc;
+}
+
+static pb_rc_t unregister_listener(pb_session_t* session, pb_databaseI_listener_fn_t* listener)
+{
+    int kept = 0;
+
+    (void) session;
+    pthread_mutex_lock(&Db.lock);
+    for (int i = 0; i < Db.nlisteners; i++)
+        if (Db.listeners[i].fn != listener)
+            Db.listeners[kept++] = Db.listeners[i];
+    Db.nlisteners = kept;
+    pthread_mutex_unlock(&Db.lock);
+    return PB_RC_OK;
+}
+
+pbif_const pb_databaseI svf10_database = {
+    start_session,
+    end_session,
+    insert_template,
+    get_template,
+    delete_template,
+    get_finger_iterator,
+    register_listener,
+    unregister_listener
+};
+
+pb_rc_t svf10_database_init(pb_session_t* session, const svf10_database_conf_t* conf)
+{
+    char* path = 0;
+    pb_rc_t rc = PB_RC_OK;
+
+    (void) session;
+    if (!conf)
+        return PB_RC_INVALID_PARAMETER;
+    if (conf->db_path) {
+        path = strdup(conf->db_path);
+        if (!path)
+            return PB_RC_MEMORY_ALLOCATION_FAILED;
+    }
+    pthread_mutex_lock(&Db.lock);
+    if (Db.session) {
+        rc = PB_RC_NOT_SUPPORTED;
+        free(path);
+    } else {
+        free(Db.path);
+        Db.path = path;
+        Db.compact_threshold = conf->compact_threshold;
+    }
+    pthread_mutex_unlock(&Db.lock);
+    return rc;
+}
@@ -0,0 +1,69 @@
+/*
+ * SVF10 template database.
+ *
+ * A pb_databaseI that keeps every template in one file, mapped into memory
+ * for the length of the session. Opening it is one open() and one mmap()
+ * whatever the number of templates, and one pass over the records checks
+ * them and builds the finger index.
+ * get_template hands out templates that reference the mapping instead of
+ * copies, and the mapping stays until the last of them is deleted, even
+ * past end_session.
+ *
+ * The file is a header page followed by a journal of records, each a
+ * small header, the finger it belongs to and the template data, checked
+ * by a CRC-32 (svf10_crc32.h). Records are only ever appended: an insert
+ * appends the template, a delete appends a record saying so. Either
+ * returns once its record is on disk, one sequential write. Starting a
+ * session replays the journal up to the last record that is whole, so a
+ * write cut short by a crash or power loss loses that write only.
+ *
+ * Replaced and deleted templates stay in the file as dead space until a
+ * background thread compacts it: once the dead space passes the
+ * configured threshold, it writes the live records to a new file and
+ * renames that over the old one. Writes carry on while it runs.
+ *
+ * Like multiple_file_database, there is one database per process and at
+ * most one session at a time.
+ */
+
+#ifndef SVF10_DATABASE_H
+#define SVF10_DATABASE_H
+
+#include "pb_databaseI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The SVF10 database. */
+extern pbif_const pb_databaseI svf10_database;
+
+/** Largest database file. The whole of it is reserved as address space
+  * when the session starts, so the mapping never moves as the file grows
+  * and templates handed out stay valid. */
+#define SVF10_DATABASE_MAX_SIZE     (16u << 20)
+
+/** The file grows by this much at a time. */
+#define SVF10_DATABASE_GROW         (64u << 10)
+
+/** Default dead space, in bytes, that makes the file compacted. */
+#define SVF10_DATABASE_COMPACT_THRESHOLD (256u << 10)
+
+typedef struct {
+    /** Path of the database file, created if missing. Default
+      * "svf10.db" in the working directory. */
+    const char* db_path;
+    /** Dead space, in bytes, above which the file is compacted, or 0 for
+      * SVF10_DATABASE_COMPACT_THRESHOLD. */
+    uint32_t compact_threshold;
+} svf10_database_conf_t;
+
+/** Optionally configures the database; call before start_session(). The
+  * path is copied. */
+pb_rc_t svf10_database_init(pb_session_t* session, const svf10_database_conf_t* conf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_DATABASE_H */
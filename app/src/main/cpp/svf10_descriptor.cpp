@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "svf10_descriptor.h"
+
+/* Mean squared gradient per pixel below which a block is taken to show no
+ * ridges; the sensor noise floor stays well under it. */
+#define MIN_BLOCK_ENERGY 64.0
+
+int svf10_descriptor_compute(const uint8_t* pixels, int rows, int cols, int stride,
+                             svf10_descriptor_t* descriptor)
+{
+    const int b = SVF10_DESCRIPTOR_BLOCK;
+    const int n = b * b;
+    double hist[SVF10_DESCRIPTOR_BINS] = { 0.0 };
+    double weight = 0.0, energy = 0.0, variance = 0.0;
+    double gxx, gxy, gsum, sum, sum_sq, s;
+    const uint8_t* p;
+    int gx, gy, bin, largest = 0;
+    uint32_t total = 0;
+
+    memset(descriptor, 0, sizeof(*descriptor));
+
+    /* Blocks stay one pixel clear of the border for the central
+     * differences. */
+    for (int top = 1; top + b <= rows - 1; top += b) {
+        for (int left = 1; left + b <= cols - 1; left += b) {
+            gxx = gxy = gsum = sum = sum_sq = 0.0;
+            for (int i = top; i < top + b; i++) {
+                p = pixels + i * stride;
+                for (int j = left; j < left + b; j++) {
+                    gx = p[j + 1] - p[j - 1];
+                    gy = p[j + stride] - p[j - stride];
+                    gxx += gx * gx - gy * gy;
+                    gxy += 2 * gx * gy;
+                    gsum += gx * gx + gy * gy;
+                    sum += p[j];
+                    sum_sq += p[j] * p[j];
+                }
+            }
+            if (gsum < MIN_BLOCK_ENERGY * n)
+                continue;
+
+            /* The doubled gradient angle, turned by 180 degrees to the
+             * doubled ridge angle, in [0, 360). Its length grows with both
+             * contrast and how well the block agrees on one orientation. */
+            bin = (int) ((atan2(gxy, gxx) + M_PI) * SVF10_DESCRIPTOR_BINS / (2.0 * M_PI));
+            if (bin >= SVF10_DESCRIPTOR_BINS)
+                bin = 0;
+            hist[bin] += sqrt(gxx * gxx + gxy * gxy);
+            weight += sqrt(gxx * gxx + gxy * gxy);
+
+            energy += gsum;
+            variance += sum_sq - sum * sum / n;
+        }
+    }
+    if (weight <= 0.0 || variance <= 0.0)
+        return 0;
+
+    for (int k = 0; k < SVF10_DESCRIPTOR_BINS; k++) {
+        descriptor->orientation[k] = (uint16_t) (65535.0 * hist[k] / weight + 0.5);
+        total += descriptor->orientation[k];
+        if (descriptor->orientation[k] > descriptor->orientation[largest])
+            largest = k;
+    }
+    /* Rounding goes to the largest bin, so every histogram sums to 65535. */
+    descriptor->orientation[largest] += (uint16_t) (65535 - total);
+
+    /* For ridges of period P across the gradient, the central differences
+     * of a pixel have about 4 sin^2(2 pi / P) times the pixel variance as
+     * their mean square. */
+    s = sqrt(energy / (4.0 * variance));
+    if (s > 1.0)
+        s = 1.0;
+    descriptor->period = (uint16_t) (16.0 * 2.0 * M_PI / asin(s) + 0.5);
+    return 1;
+}
+
+uint32_t svf10_descriptor_distance(const svf10_descriptor_t* a, const svf10_descriptor_t* b)
+{
+    uint32_t best = UINT32_MAX, d;
+    int shift, k, period;
+
+    for (shift = -SVF10_DESCRIPTOR_MAX_SHIFT; shift <= SVF10_DESCRIPTOR_MAX_SHIFT; shift++) {
+        d = 0;
+        for (k = 0; k < SVF10_DESCRIPTOR_BINS; k++)
+            d += abs(a->orientation[k] -
+                     b->orientation[(k + shift + SVF10_DESCRIPTOR_BINS) % SVF10_DESCRIPTOR_BINS]);
+        if (d < best)
+            best = d;
+    }
+    period = abs(a->period - b->period);
+    return best + (uint32_t) period * SVF10_DESCRIPTOR_PERIOD_WEIGHT / 16;
+}
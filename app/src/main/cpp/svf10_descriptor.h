@@ -0,0 +1,58 @@
+/*
+ * SVF10 fingerprint descriptors.
+ *
+ * A few bytes that summarize the ridge flow of an image: a histogram of
+ * local ridge orientations, weighted by how clearly each block shows its
+ * orientation, and the mean ridge period. Two images of the same finger
+ * give histograms that differ by a rotation and periods that agree, so
+ * the distance between descriptors ranks a gallery well enough to pick
+ * the few templates worth a full match, at well under a microsecond per
+ * gallery entry.
+ */
+
+#ifndef SVF10_DESCRIPTOR_H
+#define SVF10_DESCRIPTOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Orientation bins over [0, 180) degrees, 11.25 degrees each. */
+#define SVF10_DESCRIPTOR_BINS        16
+
+/** Rotation the distance allows for, in bins either way: 45 degrees. */
+#define SVF10_DESCRIPTOR_MAX_SHIFT   4
+
+/** Side of the blocks orientations are measured in, in pixels. */
+#define SVF10_DESCRIPTOR_BLOCK       8
+
+/** Distance added per pixel of ridge period difference, in histogram
+  * units (a histogram sums to 65535). */
+#define SVF10_DESCRIPTOR_PERIOD_WEIGHT 8192
+
+typedef struct {
+    /** Orientation histogram, summing to 65535, or all 0 if the image
+      * shows no ridges. */
+    uint16_t orientation[SVF10_DESCRIPTOR_BINS];
+    /** Mean ridge period in 1/16 pixels. */
+    uint16_t period;
+} svf10_descriptor_t;
+
+/** Computes the descriptor of an 8-bit image of rows x cols pixels.
+  *
+  * @return 1, or 0 if the image is too small or shows no ridges. */
+int svf10_descriptor_compute(const uint8_t* pixels, int rows, int cols, int stride,
+                             svf10_descriptor_t* descriptor);
+
+/** Distance between two descriptors: the L1 distance of the histograms at
+  * the best rotation within SVF10_DESCRIPTOR_MAX_SHIFT, plus the period
+  * difference. 0 for equal descriptors; smaller is more alike. */
+uint32_t svf10_descriptor_distance(const svf10_descriptor_t* a, const svf10_descriptor_t* b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_DESCRIPTOR_H */
@@ -0,0 +1,342 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "svf10_device.h"
+#include "svf10_unpack.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+const svf10_ready_t svf10_capture_ready = {
+    0, SVF10_STATUS_STATE_MASK, SVF10_STATUS_STATE(3 /* SLV_SUT_MEM_R */), 0
+};
+
+const svf10_ready_t svf10_offset_ready = {
+    0, SVF10_STATUS_STATE_MASK, SVF10_STATUS_STATE(0 /* SLV_SUT_CAP_O */), 1
+};
+
+int64_t svf10_monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+Svf10Device::Svf10Device()
+    : transport_(0),
+      speed_hz_(0)
+{
+    memset(registers_, 0, sizeof(registers_));
+    memset(discard_, 0, sizeof(discard_));
+    build_commands();
+}
+
+Svf10Device::~Svf10Device()
+{
+    close();
+}
+
+int Svf10Device::open(const char* path, uint32_t speed_hz)
+{
+    if (transport_)
+        return 0;
+    if (spidev_.open(path, speed_hz) < 0)
+        return -1;
+    attach(&spidev_, speed_hz);
+    return 0;
+}
+
+void Svf10Device::attach(Svf10Transport* transport, uint32_t speed_hz)
+{
+    if (transport_ && transport_ != transport)
+        close();
+    transport_ = transport;
+    speed_hz_ = speed_hz;
+    /* The transfers carry speed_hz, rebuild them. */
+    build_commands();
+}
+
+void Svf10Device::close()
+{
+    spidev_.close();
+    transport_ = 0;
+}
+
+void Svf10Device::set_registers(const uint8_t* registers)
+{
+    memcpy(registers_, registers, sizeof(registers_));
+    build_commands();
+}
+
+static void set_command(uint8_t* cmd, int b0, int b1)
+{
+    cmd[0] = svf10_bit_reverse[(uint8_t) b0];
+    cmd[1] = svf10_bit_reverse[(uint8_t) b1];
+    cmd[2] = 0x00;
+}
+
+void Svf10Device::build_commands()
+{
+    const uint8_t* r = registers_;
+
+    set_command(cmd_chip_id_, 0x00, 0x10);
+    set_command(cmd_status_read_, 0x10, 0x6a);
+    set_command(cmd_status_write_, 0x20, 0x76);
+    set_command(cmd_sleep_mode_, 0x00, 0x51);
+    set_command(cmd_sreg_set_,
+                (r[SVF10_REG_SL_TIME] << 7) | (r[SVF10_REG_NAVI] << 6) |
+                (r[SVF10_REG_SCK_UT] << 5) | ((r[SVF10_REG_SLV_STU] * 2) << 2),
+                0x70 | (r[SVF10_REG_ISOL] << 2) | (r[SVF10_REG_SL_TIME] >> 1));
+    set_command(cmd_creg_set_,
+                (r[SVF10_REG_DYL2X] << 7) | (r[SVF10_REG_PERIOD] << 2),
+                0x60 | (r[SVF10_REG_DLY2X_OSC] << 3) | (r[SVF10_REG_S_GAIN] << 1) | r[SVF10_REG_ADC_RSEL]);
+    set_command(cmd_sleep_sens_,
+                r[SVF10_REG_ADC_REF] << 2,
+                0x40 | (r[SVF10_REG_PERIOD] << 2) | (r[SVF10_REG_ADC_REF] >> 6));
+    set_command(cmd_mode5_, r[SVF10_REG_MULTIPLYING] << 2, 0x3e);
+    set_command(cmd_mode0_, r[SVF10_REG_MULTIPLYING] << 2, 0x30);
+    set_command(cmd_offset_,
+                (r[SVF10_REG_DYL2X] << 7) | (r[SVF10_REG_CLK_SEL] << 5) | (r[SVF10_REG_PERIOD] << 2),
+                (r[SVF10_REG_DLY2X_OSC] << 3) | (r[SVF10_REG_S_GAIN] << 1) | r[SVF10_REG_ADC_RSEL]);
+
+    /* Arm: sensor register set, control register set + status read,
+     * sleep-sense. Chip select is released after each command. */
+    fill(&arm_msg_[0], cmd_sreg_set_, discard_, COMMAND_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&arm_msg_[1], cmd_creg_set_, discard_, COMMAND_SIZE, 0, false);
+    fill(&arm_msg_[2], 0, frame_rx_, SVF10_STATUS_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&arm_msg_[3], cmd_sleep_sens_, discard_, COMMAND_SIZE, 0, false);
+
+    fill(&mode0_msg_[0], cmd_mode0_, discard_, COMMAND_SIZE, 0, false);
+    fill(&mode0_msg_[1], 0, frame_rx_, SVF10_FRAME_SIZE, 0, false);
+}
+
+void Svf10Device::fill(struct spi_ioc_transfer* tr, const uint8_t* tx, uint8_t* rx,
+                       uint32_t len, uint16_t delay_us, bool cs_change)
+{
+    memset(tr, 0, sizeof(*tr));
+    tr->tx_buf = (unsigned long) tx;
+    tr->rx_buf = (unsigned long) rx;
+    tr->len = len;
+    tr->delay_usecs = delay_us;
+    tr->speed_hz = speed_hz_;
+    tr->bits_per_word = 8;
+    tr->cs_change = cs_change ? 1 : 0;
+}
+
+int Svf10Device::message(struct spi_ioc_transfer* tr, unsigned count)
+{
+    if (!transport_) {
+        errno = EBADF;
+        return -1;
+    }
+    return transport_->transfer(tr, count);
+}
+
+int Svf10Device::read_chip_id(uint8_t* chip_id)
+{
+    struct spi_ioc_transfer tr[2];
+
+    fill(&tr[0], cmd_chip_id_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[1], 0, frame_rx_, SVF10_CHIP_ID_SIZE, 0, false);
+    if (message(tr, ARRAY_SIZE(tr)) < 0)
+        return -1;
+    svf10_unpack_shifted(chip_id, frame_rx_, SVF10_CHIP_ID_SIZE);
+    return 0;
+}
+
+int Svf10Device::sreg_set()
+{
+    struct spi_ioc_transfer tr;
+
+    fill(&tr, cmd_sreg_set_, discard_, COMMAND_SIZE, 0, false);
+    return message(&tr, 1);
+}
+
+int Svf10Device::sreg_read_creg_set(uint8_t* status)
+{
+    struct spi_ioc_transfer tr[2];
+
+    fill(&tr[0], cmd_creg_set_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[1], 0, frame_rx_, SVF10_STATUS_SIZE, 0, false);
+    if (message(tr, ARRAY_SIZE(tr)) < 0)
+        return -1;
+    svf10_unpack_shifted(status, frame_rx_, SVF10_STATUS_SIZE);
+    return 0;
+}
+
+int Svf10Device::read_status(uint8_t* status)
+{
+    struct spi_ioc_transfer tr[2];
+
+    fill(&tr[0], cmd_status_read_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[1], 0, frame_rx_, SVF10_STATUS_SIZE, 0, false);
+    if (message(tr, ARRAY_SIZE(tr)) < 0)
+        return -1;
+    svf10_unpack_shifted(status, frame_rx_, SVF10_STATUS_SIZE);
+    return 0;
+}
+
+int Svf10Device::write_status()
+{
+    struct spi_ioc_transfer tr;
+
+    fill(&tr, cmd_status_write_, discard_, COMMAND_SIZE, 0, false);
+    return message(&tr, 1);
+}
+
+int Svf10Device::sleep_mode()
+{
+    struct spi_ioc_transfer tr;
+
+    fill(&tr, cmd_sleep_mode_, discard_, COMMAND_SIZE, 0, false);
+    return message(&tr, 1);
+}
+
+int Svf10Device::sleep_sens()
+{
+    struct spi_ioc_transfer tr;
+
+    fill(&tr, cmd_sleep_sens_, discard_, COMMAND_SIZE, 0, false);
+    return message(&tr, 1);
+}
+
+int Svf10Device::capture_offset()
+{
+    struct spi_ioc_transfer tr[2];
+
+    /* The first command byte is clocked out alone, 1 ms ahead of the rest. */
+    fill(&tr[0], cmd_offset_, discard_, 1, 1000, false);
+    fill(&tr[1], cmd_offset_ + 1, discard_, 2, 0, false);
+    return message(tr, ARRAY_SIZE(tr));
+}
+
+int Svf10Device::read_frame_mode5(uint8_t* frame)
+{
+    struct spi_ioc_transfer tr[2];
+
+    fill(&tr[0], cmd_mode5_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[1], 0, frame_rx_, SVF10_FRAME_SIZE, 0, false);
+    if (message(tr, ARRAY_SIZE(tr)) < 0)
+        return -1;
+    svf10_unpack_shifted(frame, frame_rx_, SVF10_FRAME_SIZE);
+    return 0;
+}
+
+int Svf10Device::read_frame_mode0(uint8_t* frame)
+{
+    if (message(mode0_msg_, ARRAY_SIZE(mode0_msg_)) < 0)
+        return -1;
+    svf10_unpack_inverted(frame, frame_rx_, SVF10_FRAME_SIZE);
+    return 0;
+}
+
+int Svf10Device::read_image_mode0(uint8_t* image)
+{
+    const uint8_t* row = SVF10_FRAME_PIXELS(frame_rx_);
+
+    if (message(mode0_msg_, ARRAY_SIZE(mode0_msg_)) < 0)
+        return -1;
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++, row += SVF10_FRAME_STRIDE)
+        svf10_unpack_inverted(image + i * SVF10_IMAGE_WIDTH, row, SVF10_IMAGE_WIDTH);
+    return 0;
+}
+
+int Svf10Device::begin_stream_mode0()
+{
+    struct spi_ioc_transfer tr;
+
+    fill(&tr, cmd_mode0_, discard_, COMMAND_SIZE, 0, true);
+    return message(&tr, 1);
+}
+
+int Svf10Device::read_stream_mode0(uint8_t* data, uint32_t len)
+{
+    struct spi_ioc_transfer tr;
+
+    fill(&tr, 0, data, len, 0, true);
+    if (message(&tr, 1) < 0)
+        return -1;
+    svf10_unpack_inverted(data, data, len);
+    return 0;
+}
+
+int Svf10Device::end_stream_mode0()
+{
+    struct spi_ioc_transfer tr;
+
+    /* An empty transfer, only to deselect the sensor. */
+    fill(&tr, 0, 0, 0, 0, false);
+    return message(&tr, 1);
+}
+
+int Svf10Device::initialize(uint8_t* chip_id, uint8_t* status, uint8_t* frame)
+{
+    uint8_t* chip_id_rx = reply_rx_;
+    uint8_t* status_rx = reply_rx_ + SVF10_CHIP_ID_SIZE;
+    struct spi_ioc_transfer tr[10];
+
+    fill(&tr[0], cmd_chip_id_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[1], 0, chip_id_rx, SVF10_CHIP_ID_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&tr[2], cmd_sreg_set_, discard_, COMMAND_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&tr[3], cmd_creg_set_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[4], 0, status_rx, SVF10_STATUS_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&tr[5], cmd_mode5_, discard_, COMMAND_SIZE, 0, false);
+    fill(&tr[6], 0, frame_rx_, SVF10_FRAME_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&tr[7], cmd_sreg_set_, discard_, COMMAND_SIZE, SVF10_COMMAND_GAP_US, true);
+    fill(&tr[8], cmd_offset_, discard_, 1, 1000, false);
+    fill(&tr[9], cmd_offset_ + 1, discard_, 2, 0, false);
+    if (message(tr, ARRAY_SIZE(tr)) < 0)
+        return -1;
+    if (chip_id)
+        svf10_unpack_shifted(chip_id, chip_id_rx, SVF10_CHIP_ID_SIZE);
+    if (status)
+        svf10_unpack_shifted(status, status_rx, SVF10_STATUS_SIZE);
+    if (frame)
+        svf10_unpack_shifted(frame, frame_rx_, SVF10_FRAME_SIZE);
+    return 0;
+}
+
+int Svf10Device::arm_capture(uint8_t* status)
+{
+    if (message(arm_msg_, ARRAY_SIZE(arm_msg_)) < 0)
+        return -1;
+    if (status)
+        svf10_unpack_shifted(status, frame_rx_, SVF10_STATUS_SIZE);
+    return 0;
+}
+
+int Svf10Device::wait_ready(const svf10_ready_t* ready, uint32_t timeout_us,
+                            uint8_t* status, uint32_t* waited_us)
+{
+    uint8_t st[SVF10_STATUS_SIZE];
+    const int64_t start = svf10_monotonic_ns();
+    uint32_t step = SVF10_POLL_MIN_US;
+    uint32_t elapsed;
+    int failed, ready_now;
+
+    for (;;) {
+        usleep(step);
+        failed = read_status(st) < 0;
+        elapsed = (uint32_t) ((svf10_monotonic_ns() - start) / 1000);
+        if (failed) {
+            if (waited_us)
+                *waited_us = elapsed;
+            return -1;
+        }
+        ready_now = ((st[ready->byte] & ready->mask) == ready->value) != (ready->negate != 0);
+        if (ready_now || elapsed >= timeout_us)
+            break;
+        step *= 2;
+        if (step > SVF10_POLL_MAX_US)
+            step = SVF10_POLL_MAX_US;
+        if (step > timeout_us - elapsed)
+            step = timeout_us - elapsed;
+    }
+
+    if (status)
+        memcpy(status, st, sizeof(st));
+    if (waited_us)
+        *waited_us = elapsed;
+    return ready_now;
+}
@@ -0,0 +1,190 @@
+/*
+ * SVF10 SPI device session.
+ *
+ * Svf10Device owns the spidev file descriptor for the lifetime of the native
+ * library. The device is opened and configured once, the command bytes are
+ * built once from the register frame, and every command sequence is sent as
+ * a pre-built spi_ioc_transfer array in a single SPI_IOC_MESSAGE ioctl.
+ * The messages go through a Svf10Transport, which is the spidev node unless
+ * another transport (e.g. the Svf10Simulator) is attached.
+ */
+
+#ifndef SVF10_DEVICE_H
+#define SVF10_DEVICE_H
+
+#include <stdint.h>
+#include <linux/spi/spidev.h>
+#include "svf10_filter.h"
+#include "svf10_transport.h"
+
+/** Indices into the register frame (svf10_resister_frame). */
+enum {
+    SVF10_REG_DLY2X_OSC = 0,
+    SVF10_REG_S_GAIN = 1,
+    SVF10_REG_ADC_RSEL = 2,
+    SVF10_REG_DYL2X = 3,
+    SVF10_REG_CLK_SEL = 4,
+    SVF10_REG_PERIOD = 5,
+    SVF10_REG_ISOL = 6,
+    SVF10_REG_SL_TIME = 7,
+    SVF10_REG_NAVI = 8,
+    SVF10_REG_SCK_UT = 9,
+    SVF10_REG_SLV_STU = 10,
+    SVF10_REG_MULTIPLYING = 11,
+    SVF10_REG_ADC_REF = 12,
+    SVF10_REG_DISPLAY_THRESHOLD = 13,
+    SVF10_REG_GPB = 15,
+    SVF10_REG_COUNT = 16
+};
+
+#define SVF10_CHIP_ID_SIZE       8
+#define SVF10_STATUS_SIZE        8
+
+/** Gap the sensor needs between two commands, in microseconds. */
+#define SVF10_COMMAND_GAP_US     1000
+
+/** Status polling backoff: the first poll comes after SVF10_POLL_MIN_US,
+  * each following one waits twice as long, up to SVF10_POLL_MAX_US. */
+#define SVF10_POLL_MIN_US        500
+#define SVF10_POLL_MAX_US        16000
+
+/** Upper bounds of the waits that used to be fixed sleeps, in
+  * microseconds. Polling gives up and proceeds after these. */
+#define SVF10_OFFSET_TIMEOUT_US  1000000
+#define SVF10_CAPTURE_TIMEOUT_US 200000
+
+/** A readiness condition on the status bytes: the sensor is ready when
+  * (status[byte] & mask) == value, or != value if negate is set. */
+typedef struct {
+    uint8_t byte;
+    uint8_t mask;
+    uint8_t value;
+    uint8_t negate;
+} svf10_ready_t;
+
+/** The sensor state field of the first status byte, in the position
+  * SLV_STU takes in the sensor register write. */
+#define SVF10_STATUS_STATE_MASK  0x18
+#define SVF10_STATUS_STATE(s)    ((s) << 3)
+
+/** Image capture finished, the frame can be read (state SLV_SUT_MEM_R). */
+extern const svf10_ready_t svf10_capture_ready;
+
+/** Offset capture finished (state no longer SLV_SUT_CAP_O). */
+extern const svf10_ready_t svf10_offset_ready;
+
+/** Returns CLOCK_MONOTONIC in nanoseconds. */
+int64_t svf10_monotonic_ns(void);
+
+class Svf10Device {
+public:
+    Svf10Device();
+    ~Svf10Device();
+
+    /** Opens and configures the spidev node (mode 0, 8 bits, MSB first).
+      * Does nothing if the device is already open.
+      *
+      * @return 0 if successful, or -1 with errno set. */
+    int open(const char* path, uint32_t speed_hz);
+
+    /** Sends all commands through transport instead of a spidev node. The
+      * device is closed first if it is open; the transport is not owned
+      * and must outlive the device or the next close(). */
+    void attach(Svf10Transport* transport, uint32_t speed_hz);
+
+    void close();
+    bool is_open() const { return transport_ != 0; }
+
+    /** Caches a copy of the register frame and rebuilds every command that
+      * depends on it. */
+    void set_registers(const uint8_t* registers);
+    const uint8_t* registers() const { return registers_; }
+
+    /** Command sequences. Each returns 0 if successful, or -1. */
+    int read_chip_id(uint8_t* chip_id);
+    int sreg_set();
+    int sreg_read_creg_set(uint8_t* status);
+    int read_status(uint8_t* status);
+    int write_status();
+    int sleep_mode();
+    int sleep_sens();
+    int capture_offset();
+
+    /** Reads a mode 5 frame (offset calibration) into frame. */
+    int read_frame_mode5(uint8_t* frame);
+
+    /** Reads a mode 0 frame (image) into frame. */
+    int read_frame_mode0(uint8_t* frame);
+
+    /** Reads a mode 0 frame and decodes only its pixels into a packed
+      * 96x96 image, the layout of pb_image_t and svf10_image_pool. */
+    int read_image_mode0(uint8_t* image);
+
+    /** Streams a mode 0 frame in pieces instead of one read.
+      * begin_stream_mode0() sends the read command and keeps chip select
+      * asserted, each read_stream_mode0() clocks out and decodes the next
+      * len bytes of the frame as read_frame_mode0() would return them, and
+      * end_stream_mode0() releases chip select, at any point of the frame.
+      * Nothing else may be sent to the device in between. */
+    int begin_stream_mode0();
+    int read_stream_mode0(uint8_t* data, uint32_t len);
+    int end_stream_mode0();
+
+    /** SpiOpen's power-up sequence: chip ID, sensor/control registers, a mode
+      * 5 read and the offset capture, with SVF10_COMMAND_GAP_US between
+      * commands, in one message. Any of the outputs may be 0. */
+    int initialize(uint8_t* chip_id, uint8_t* status, uint8_t* frame);
+
+    /** Arms an image capture: sensor register set, control register set
+      * (reading status) and sleep-sense, in one message. */
+    int arm_capture(uint8_t* status);
+
+    /** Polls the status with bounded exponential backoff until the ready
+      * condition holds or timeout_us has passed.
+      *
+      * @param[out] status receives the last status read, may be 0.
+      * @param[out] waited_us receives the time waited, may be 0.
+      *
+      * @return 1 if ready, 0 on timeout, -1 if a status read failed. */
+    int wait_ready(const svf10_ready_t* ready, uint32_t timeout_us,
+                   uint8_t* status, uint32_t* waited_us);
+
+private:
+    Svf10Device(const Svf10Device&);
+    Svf10Device& operator=(const Svf10Device&);
+
+    enum { COMMAND_SIZE = 3 };
+
+    void build_commands();
+    void fill(struct spi_ioc_transfer* tr, const uint8_t* tx, uint8_t* rx,
+              uint32_t len, uint16_t delay_us, bool cs_change);
+    int message(struct spi_ioc_transfer* tr, unsigned count);
+
+    Svf10SpidevTransport spidev_;
+    Svf10Transport* transport_;
+    uint32_t speed_hz_;
+    uint8_t registers_[SVF10_REG_COUNT];
+
+    /* Command bytes, already bit-reversed for the wire. */
+    uint8_t cmd_chip_id_[COMMAND_SIZE];
+    uint8_t cmd_sreg_set_[COMMAND_SIZE];
+    uint8_t cmd_creg_set_[COMMAND_SIZE];
+    uint8_t cmd_status_read_[COMMAND_SIZE];
+    uint8_t cmd_status_write_[COMMAND_SIZE];
+    uint8_t cmd_sleep_mode_[COMMAND_SIZE];
+    uint8_t cmd_sleep_sens_[COMMAND_SIZE];
+    uint8_t cmd_mode5_[COMMAND_SIZE];
+    uint8_t cmd_mode0_[COMMAND_SIZE];
+    uint8_t cmd_offset_[COMMAND_SIZE];
+
+    /* Receive buffer for the command phase, always discarded. */
+    uint8_t discard_[COMMAND_SIZE];
+    uint8_t reply_rx_[SVF10_CHIP_ID_SIZE + SVF10_STATUS_SIZE];
+    uint8_t frame_rx_[SVF10_FRAME_SIZE];
+
+    /* Pre-built messages. */
+    struct spi_ioc_transfer arm_msg_[4];
+    struct spi_ioc_transfer mode0_msg_[2];
+};
+
+#endif /* SVF10_DEVICE_H */
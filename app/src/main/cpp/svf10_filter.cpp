@@ -0,0 +1,465 @@
+#include <string.h>
+#include "svf10_filter.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SVF10_FILTER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SVF10_FILTER_SSE2
+#endif
+
+/* floor(s / 9) == (s * 7282) >> 16 for every 3x3 sum s in 0..9*255. */
+#define DIV9_MAGIC   7282
+
+/* Fixed-point gaussian weights, corner/edge/center, summing to 256. */
+#define GAUSS_CORNER 24
+#define GAUSS_EDGE   30
+#define GAUSS_CENTER 40
+
+static inline int clamp_index(int i)
+{
+    if (i < 0)
+        return 0;
+    if (i > SVF10_IMAGE_WIDTH - 1)
+        return SVF10_IMAGE_WIDTH - 1;
+    return i;
+}
+
+static inline const uint8_t* padded_pixel(const svf10_padded_image_t* padded, int i, int j)
+{
+    return padded->pixels + (i + SVF10_FILTER_PAD) * SVF10_FILTER_STRIDE + j + SVF10_FILTER_PAD;
+}
+
+void svf10_filter_pad_row(const uint8_t* src, uint8_t* row)
+{
+    memcpy(row + SVF10_FILTER_PAD, src, SVF10_IMAGE_WIDTH);
+    for (int k = 0; k < SVF10_FILTER_PAD; k++) {
+        row[k] = row[SVF10_FILTER_PAD];
+        row[SVF10_FILTER_PAD + SVF10_IMAGE_WIDTH + k] = row[SVF10_FILTER_PAD + SVF10_IMAGE_WIDTH - 1];
+    }
+}
+
+void svf10_filter_pad(const uint8_t* src, int src_stride,
+                      svf10_padded_image_t* padded)
+{
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        svf10_filter_pad_row(src + i * src_stride,
+                             padded->pixels + (i + SVF10_FILTER_PAD) * SVF10_FILTER_STRIDE);
+
+    for (int k = 0; k < SVF10_FILTER_PAD; k++) {
+        memcpy(padded->pixels + k * SVF10_FILTER_STRIDE,
+               padded->pixels + SVF10_FILTER_PAD * SVF10_FILTER_STRIDE,
+               SVF10_FILTER_STRIDE);
+        memcpy(padded->pixels + (SVF10_FILTER_PAD + SVF10_IMAGE_HEIGHT + k) * SVF10_FILTER_STRIDE,
+               padded->pixels + (SVF10_FILTER_PAD + SVF10_IMAGE_HEIGHT - 1) * SVF10_FILTER_STRIDE,
+               SVF10_FILTER_STRIDE);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Scalar reference implementations                                          */
+/* ------------------------------------------------------------------------- */
+
+/* Sum of the box (i+r0..i+r1, j+c0..j+c1) with clamped coordinates. */
+static inline unsigned box_sum_ref(const uint8_t* image, int i, int j,
+                                   int r0, int r1, int c0, int c1)
+{
+    unsigned sum = 0;
+
+    for (int di = r0; di <= r1; di++)
+        for (int dj = c0; dj <= c1; dj++)
+            sum += image[clamp_index(i + di) * SVF10_IMAGE_WIDTH + clamp_index(j + dj)];
+    return sum;
+}
+
+static void copy_dense(const uint8_t* src, int src_stride, uint8_t* image)
+{
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        memcpy(image + i * SVF10_IMAGE_WIDTH, src + i * src_stride, SVF10_IMAGE_WIDTH);
+}
+
+void svf10_filter_box2_ref(const uint8_t* src, int src_stride,
+                           uint8_t* dst, int dst_stride)
+{
+    uint8_t image[SVF10_IMAGE_SIZE];
+
+    copy_dense(src, src_stride, image);
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            dst[i * dst_stride + j] = (uint8_t) (box_sum_ref(image, i, j, -1, 0, -1, 0) / 4);
+}
+
+void svf10_filter_box3_ref(const uint8_t* src, int src_stride,
+                           uint8_t* dst, int dst_stride)
+{
+    uint8_t image[SVF10_IMAGE_SIZE];
+
+    copy_dense(src, src_stride, image);
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            dst[i * dst_stride + j] = (uint8_t) (box_sum_ref(image, i, j, -1, 1, -1, 1) / 9);
+}
+
+void svf10_filter_box4_ref(const uint8_t* src, int src_stride,
+                           uint8_t* dst, int dst_stride)
+{
+    uint8_t image[SVF10_IMAGE_SIZE];
+
+    copy_dense(src, src_stride, image);
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            dst[i * dst_stride + j] = (uint8_t) (box_sum_ref(image, i, j, -2, 1, -2, 1) / 16);
+}
+
+void svf10_filter_gaussian3_ref(const uint8_t* src, int src_stride,
+                                uint8_t* dst, int dst_stride)
+{
+    uint8_t image[SVF10_IMAGE_SIZE];
+    unsigned all, cross, center;
+
+    copy_dense(src, src_stride, image);
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++) {
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+            all = box_sum_ref(image, i, j, -1, 1, -1, 1);
+            center = box_sum_ref(image, i, j, 0, 0, 0, 0);
+            cross = box_sum_ref(image, i, j, -1, 1, 0, 0) + box_sum_ref(image, i, j, 0, 0, -1, 1) - 2 * center;
+            dst[i * dst_stride + j] = (uint8_t) ((GAUSS_CORNER * (all - cross - center) +
+                                                  GAUSS_EDGE * cross +
+                                                  GAUSS_CENTER * center) >> 8);
+        }
+    }
+}
+
+void svf10_filter_hist_eq_lut(const uint32_t* histogram, uint8_t* lut)
+{
+    uint32_t cdf = 0;
+
+    for (int v = 0; v < 256; v++) {
+        cdf += histogram[v];
+        lut[v] = (uint8_t) (cdf * 255 / SVF10_IMAGE_SIZE);
+    }
+}
+
+void svf10_filter_hist_eq_ref(const uint8_t* src, int src_stride,
+                              uint8_t* dst, int dst_stride)
+{
+    uint32_t histogram[256] = {0, };
+    uint8_t lut[256];
+
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            histogram[src[i * src_stride + j]]++;
+
+    svf10_filter_hist_eq_lut(histogram, lut);
+
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            dst[i * dst_stride + j] = lut[src[i * src_stride + j]];
+}
+
+/* ------------------------------------------------------------------------- */
+/* Vector implementations                                                    */
+/* ------------------------------------------------------------------------- */
+
+#if defined(SVF10_FILTER_NEON)
+
+typedef struct { uint16x8_t lo, hi; } acc16_t;
+
+static inline void acc_zero(acc16_t* acc)
+{
+    acc->lo = vdupq_n_u16(0);
+    acc->hi = vdupq_n_u16(0);
+}
+
+static inline void acc_add(acc16_t* acc, const uint8_t* p)
+{
+    uint8x16_t v = vld1q_u8(p);
+    acc->lo = vaddw_u8(acc->lo, vget_low_u8(v));
+    acc->hi = vaddw_u8(acc->hi, vget_high_u8(v));
+}
+
+static inline void acc_mul(acc16_t* acc, uint16_t k)
+{
+    acc->lo = vmulq_n_u16(acc->lo, k);
+    acc->hi = vmulq_n_u16(acc->hi, k);
+}
+
+static inline void acc_add_acc(acc16_t* acc, const acc16_t* other)
+{
+    acc->lo = vaddq_u16(acc->lo, other->lo);
+    acc->hi = vaddq_u16(acc->hi, other->hi);
+}
+
+static inline void store_shift(uint8_t* dst, const acc16_t* acc, int shift)
+{
+    uint16x8_t lo = vshlq_u16(acc->lo, vdupq_n_s16((int16_t) -shift));
+    uint16x8_t hi = vshlq_u16(acc->hi, vdupq_n_s16((int16_t) -shift));
+    vst1q_u8(dst, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+}
+
+static inline uint16x8_t div9_u16(uint16x8_t v)
+{
+    uint16x4_t k = vdup_n_u16(DIV9_MAGIC);
+    uint32x4_t lo = vmull_u16(vget_low_u16(v), k);
+    uint32x4_t hi = vmull_u16(vget_high_u16(v), k);
+    return vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+}
+
+static inline void store_div9(uint8_t* dst, const acc16_t* acc)
+{
+    vst1q_u8(dst, vcombine_u8(vmovn_u16(div9_u16(acc->lo)), vmovn_u16(div9_u16(acc->hi))));
+}
+
+#elif defined(SVF10_FILTER_SSE2)
+
+typedef struct { __m128i lo, hi; } acc16_t;
+
+static inline void acc_zero(acc16_t* acc)
+{
+    acc->lo = _mm_setzero_si128();
+    acc->hi = _mm_setzero_si128();
+}
+
+static inline void acc_add(acc16_t* acc, const uint8_t* p)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*) p);
+    __m128i zero = _mm_setzero_si128();
+    acc->lo = _mm_add_epi16(acc->lo, _mm_unpacklo_epi8(v, zero));
+    acc->hi = _mm_add_epi16(acc->hi, _mm_unpackhi_epi8(v, zero));
+}
+
+static inline void acc_mul(acc16_t* acc, uint16_t k)
+{
+    __m128i kk = _mm_set1_epi16((short) k);
+    acc->lo = _mm_mullo_epi16(acc->lo, kk);
+    acc->hi = _mm_mullo_epi16(acc->hi, kk);
+}
+
+static inline void acc_add_acc(acc16_t* acc, const acc16_t* other)
+{
+    acc->lo = _mm_add_epi16(acc->lo, other->lo);
+    acc->hi = _mm_add_epi16(acc->hi, other->hi);
+}
+
+static inline void store_shift(uint8_t* dst, const acc16_t* acc, int shift)
+{
+    __m128i count = _mm_cvtsi32_si128(shift);
+    __m128i lo = _mm_srl_epi16(acc->lo, count);
+    __m128i hi = _mm_srl_epi16(acc->hi, count);
+    _mm_storeu_si128((__m128i*) dst, _mm_packus_epi16(lo, hi));
+}
+
+static inline void store_div9(uint8_t* dst, const acc16_t* acc)
+{
+    __m128i k = _mm_set1_epi16((short) DIV9_MAGIC);
+    __m128i lo = _mm_mulhi_epu16(acc->lo, k);
+    __m128i hi = _mm_mulhi_epu16(acc->hi, k);
+    _mm_storeu_si128((__m128i*) dst, _mm_packus_epi16(lo, hi));
+}
+
+#endif
+
+#if defined(SVF10_FILTER_NEON) || defined(SVF10_FILTER_SSE2)
+
+/* Adds rows[0..nrows-1] at columns j+c0..j+c1 for 16 consecutive j. */
+static inline void acc_box(acc16_t* acc, const uint8_t* const* rows, int nrows,
+                           int j, int c0, int c1)
+{
+    for (int r = 0; r < nrows; r++)
+        for (int dj = c0; dj <= c1; dj++)
+            acc_add(acc, rows[r] + j + dj);
+}
+
+void svf10_filter_box2_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    acc16_t acc;
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 16) {
+        acc_zero(&acc);
+        acc_box(&acc, rows, 2, j, -1, 0);
+        store_shift(dst + j, &acc, 2);
+    }
+}
+
+void svf10_filter_box3_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    acc16_t acc;
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 16) {
+        acc_zero(&acc);
+        acc_box(&acc, rows, 3, j, -1, 1);
+        store_div9(dst + j, &acc);
+    }
+}
+
+void svf10_filter_box4_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    acc16_t acc;
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 16) {
+        acc_zero(&acc);
+        acc_box(&acc, rows, 4, j, -2, 1);
+        store_shift(dst + j, &acc, 4);
+    }
+}
+
+void svf10_filter_gaussian3_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    const uint8_t *a = rows[0], *b = rows[1], *c = rows[2];
+    acc16_t corner, edge, center;
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 16) {
+        acc_zero(&corner);
+        acc_add(&corner, a + j - 1);
+        acc_add(&corner, a + j + 1);
+        acc_add(&corner, c + j - 1);
+        acc_add(&corner, c + j + 1);
+        acc_zero(&edge);
+        acc_add(&edge, a + j);
+        acc_add(&edge, b + j - 1);
+        acc_add(&edge, b + j + 1);
+        acc_add(&edge, c + j);
+        acc_zero(&center);
+        acc_add(&center, b + j);
+
+        /* 24 * 1020 + 30 * 1020 + 40 * 255 = 65280, fits in 16 bits. */
+        acc_mul(&corner, GAUSS_CORNER);
+        acc_mul(&edge, GAUSS_EDGE);
+        acc_mul(&center, GAUSS_CENTER);
+        acc_add_acc(&corner, &edge);
+        acc_add_acc(&corner, &center);
+        store_shift(dst + j, &corner, 8);
+    }
+}
+
+#else
+
+void svf10_filter_box2_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    const uint8_t *a = rows[0], *b = rows[1];
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+        dst[j] = (uint8_t) ((a[j - 1] + a[j] + b[j - 1] + b[j]) >> 2);
+}
+
+void svf10_filter_box3_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    const uint8_t *a = rows[0], *b = rows[1], *c = rows[2];
+    unsigned sum;
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+        sum = a[j - 1] + a[j] + a[j + 1] +
+              b[j - 1] + b[j] + b[j + 1] +
+              c[j - 1] + c[j] + c[j + 1];
+        dst[j] = (uint8_t) ((sum * DIV9_MAGIC) >> 16);
+    }
+}
+
+void svf10_filter_box4_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    const uint8_t* p;
+    unsigned sum;
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+        sum = 0;
+        for (int r = 0; r < 4; r++) {
+            p = rows[r] + j;
+            sum += p[-2] + p[-1] + p[0] + p[1];
+        }
+        dst[j] = (uint8_t) (sum >> 4);
+    }
+}
+
+void svf10_filter_gaussian3_row(const uint8_t* const* rows, uint8_t* dst)
+{
+    const uint8_t *a = rows[0], *b = rows[1], *c = rows[2];
+
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+        dst[j] = (uint8_t) ((GAUSS_CORNER * (a[j - 1] + a[j + 1] + c[j - 1] + c[j + 1]) +
+                             GAUSS_EDGE * (a[j] + b[j - 1] + b[j + 1] + c[j]) +
+                             GAUSS_CENTER * b[j]) >> 8);
+}
+
+#endif
+
+/* Runs a row kernel over a whole image. above is the number of rows the
+ * kernel reads above the output row, nrows the total number it reads. */
+static void filter_image(const uint8_t* src, int src_stride,
+                         uint8_t* dst, int dst_stride,
+                         int above, int nrows, svf10_filter_row_fn_t* row_fn)
+{
+    svf10_padded_image_t padded;
+    const uint8_t* rows[SVF10_FILTER_MAX_ROWS];
+
+    svf10_filter_pad(src, src_stride, &padded);
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++) {
+        for (int r = 0; r < nrows; r++)
+            rows[r] = padded_pixel(&padded, i - above + r, 0);
+        row_fn(rows, dst + i * dst_stride);
+    }
+}
+
+void svf10_filter_box2(const uint8_t* src, int src_stride,
+                       uint8_t* dst, int dst_stride)
+{
+    filter_image(src, src_stride, dst, dst_stride, 1, 2, svf10_filter_box2_row);
+}
+
+void svf10_filter_box3(const uint8_t* src, int src_stride,
+                       uint8_t* dst, int dst_stride)
+{
+    filter_image(src, src_stride, dst, dst_stride, 1, 3, svf10_filter_box3_row);
+}
+
+void svf10_filter_box4(const uint8_t* src, int src_stride,
+                       uint8_t* dst, int dst_stride)
+{
+    filter_image(src, src_stride, dst, dst_stride, 2, 4, svf10_filter_box4_row);
+}
+
+void svf10_filter_gaussian3(const uint8_t* src, int src_stride,
+                            uint8_t* dst, int dst_stride)
+{
+    filter_image(src, src_stride, dst, dst_stride, 1, 3, svf10_filter_gaussian3_row);
+}
+
+void svf10_filter_hist_eq(const uint8_t* src, int src_stride,
+                          uint8_t* dst, int dst_stride)
+{
+    /* Four interleaved histograms break the store-to-load dependency on
+     * runs of equal pixels, which are the common case on this sensor. */
+    uint32_t histogram[4][256];
+    uint8_t lut[256];
+    const uint8_t* row;
+
+    memset(histogram, 0, sizeof(histogram));
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++) {
+        row = src + i * src_stride;
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 4) {
+            histogram[0][row[j]]++;
+            histogram[1][row[j + 1]]++;
+            histogram[2][row[j + 2]]++;
+            histogram[3][row[j + 3]]++;
+        }
+    }
+    for (int v = 0; v < 256; v++)
+        histogram[0][v] += histogram[1][v] + histogram[2][v] + histogram[3][v];
+
+    svf10_filter_hist_eq_lut(histogram[0], lut);
+
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            dst[i * dst_stride + j] = lut[src[i * src_stride + j]];
+}
+
+const char* svf10_filter_impl(void)
+{
+#if defined(SVF10_FILTER_NEON)
+    return "neon";
+#elif defined(SVF10_FILTER_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,123 @@
+/*
+ * SVF10 image filter library.
+ *
+ * Integer / fixed-point versions of the 96x96 preprocessing filters used by
+ * FPLoop and FPgetTemp2. Every filter reads and writes a 96x96 8-bit image
+ * through an arbitrary row stride, so they can run directly on the SPI
+ * receive buffer (SVF10_FRAME_PIXELS(buffer), SVF10_FRAME_STRIDE) without
+ * first copying it into a dense array.
+ */
+
+#ifndef SVF10_FILTER_H
+#define SVF10_FILTER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Geometry of the SVF10 image and of the raw SPI frame it arrives in. */
+#define SVF10_IMAGE_WIDTH        96
+#define SVF10_IMAGE_HEIGHT       96
+#define SVF10_IMAGE_SIZE         (SVF10_IMAGE_WIDTH * SVF10_IMAGE_HEIGHT)
+#define SVF10_FRAME_HEADER       4
+#define SVF10_FRAME_TRAILER      2
+#define SVF10_FRAME_STRIDE       (SVF10_IMAGE_WIDTH + SVF10_FRAME_TRAILER)
+#define SVF10_FRAME_SIZE         (SVF10_FRAME_HEADER + SVF10_IMAGE_HEIGHT * SVF10_FRAME_STRIDE)
+
+/** Returns a pointer to the first pixel of a raw SPI frame. */
+#define SVF10_FRAME_PIXELS(frame) ((frame) + SVF10_FRAME_HEADER)
+
+/** Border width of the padded working image. Large enough for the 4x4
+  * moving average, which looks two pixels up/left and one down/right. */
+#define SVF10_FILTER_PAD         2
+#define SVF10_FILTER_STRIDE      (SVF10_IMAGE_WIDTH + 2 * SVF10_FILTER_PAD)
+#define SVF10_FILTER_ROWS        (SVF10_IMAGE_HEIGHT + 2 * SVF10_FILTER_PAD)
+
+/** Padded working image. Border pixels replicate the nearest edge pixel,
+  * which is the same clamping the original double-precision filters did
+  * with a branch per pixel. */
+typedef struct {
+    uint8_t pixels[SVF10_FILTER_ROWS * SVF10_FILTER_STRIDE];
+} svf10_padded_image_t;
+
+/** Copies a 96x96 image into a padded working image and replicates the
+  * border. */
+void svf10_filter_pad(const uint8_t* src, int src_stride,
+                      svf10_padded_image_t* padded);
+
+/** Copies one 96-pixel row into a SVF10_FILTER_STRIDE row buffer and
+  * replicates its left and right edge pixels. */
+void svf10_filter_pad_row(const uint8_t* src, uint8_t* row);
+
+/** 2x2 moving average over (i-1..i, j-1..j). Source and destination may
+  * be the same buffer. */
+void svf10_filter_box2(const uint8_t* src, int src_stride,
+                       uint8_t* dst, int dst_stride);
+
+/** 3x3 moving average over (i-1..i+1, j-1..j+1). */
+void svf10_filter_box3(const uint8_t* src, int src_stride,
+                       uint8_t* dst, int dst_stride);
+
+/** 4x4 moving average over (i-2..i+1, j-2..j+1). */
+void svf10_filter_box4(const uint8_t* src, int src_stride,
+                       uint8_t* dst, int dst_stride);
+
+/** 3x3 gaussian (sigma^2 = 2) with 8-bit fixed-point weights
+  * 24/30/24, 30/40/30, 24/30/24 (sum 256). */
+void svf10_filter_gaussian3(const uint8_t* src, int src_stride,
+                            uint8_t* dst, int dst_stride);
+
+/** Histogram equalization. The lookup table is
+  * lut[v] = cdf(v) * 255 / 9216, computed in integers. */
+void svf10_filter_hist_eq(const uint8_t* src, int src_stride,
+                          uint8_t* dst, int dst_stride);
+
+/** Builds the histogram equalization lookup table from a 256-bin
+  * histogram of a 96x96 image. */
+void svf10_filter_hist_eq_lut(const uint32_t* histogram, uint8_t* lut);
+
+/** Row kernels. Each produces one 96-pixel output row from consecutive
+  * padded input rows, rows[0] being the topmost row the filter reads.
+  * Every row pointer addresses pixel 0 and must have SVF10_FILTER_PAD
+  * valid pixels on either side (see svf10_filter_pad_row()).
+  *
+  *   kernel       rows read
+  *   box2         i-1 .. i
+  *   box3         i-1 .. i+1
+  *   box4         i-2 .. i+1
+  *   gaussian3    i-1 .. i+1
+  */
+#define SVF10_FILTER_MAX_ROWS    4
+
+typedef void svf10_filter_row_fn_t(const uint8_t* const* rows, uint8_t* dst);
+
+svf10_filter_row_fn_t svf10_filter_box2_row;
+svf10_filter_row_fn_t svf10_filter_box3_row;
+svf10_filter_row_fn_t svf10_filter_box4_row;
+svf10_filter_row_fn_t svf10_filter_gaussian3_row;
+
+/** Scalar reference implementations. The functions above are required to
+  * produce bit-identical output on every platform; these are the
+  * definition of that output. */
+void svf10_filter_box2_ref(const uint8_t* src, int src_stride,
+                           uint8_t* dst, int dst_stride);
+void svf10_filter_box3_ref(const uint8_t* src, int src_stride,
+                           uint8_t* dst, int dst_stride);
+void svf10_filter_box4_ref(const uint8_t* src, int src_stride,
+                           uint8_t* dst, int dst_stride);
+void svf10_filter_gaussian3_ref(const uint8_t* src, int src_stride,
+                                uint8_t* dst, int dst_stride);
+void svf10_filter_hist_eq_ref(const uint8_t* src, int src_stride,
+                              uint8_t* dst, int dst_stride);
+
+/** Returns the name of the vector path compiled in: "neon", "sse2" or
+  * "scalar". */
+const char* svf10_filter_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_FILTER_H */
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "svf10_fpdb.h"
+
+#define FPDB_MAGIC      "SVF10FX"
+#define FPDB_VERSION    1
+
+/* The file is this header, a table of nattrs attr_t, a table of nitems
+ * svf10_fpdb_item_t and the string pool, pool_size bytes of
+ * NUL-terminated strings. Every part starts 8-byte aligned. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t item_size;
+    uint32_t nitems;
+    uint32_t nattrs;
+    uint32_t pool_size;
+    int32_t npersons;
+    int32_t nfingers;
+    int32_t ntrans;
+} header_t;
+
+/* Offsets of an attribute's name and value in the string pool. */
+typedef struct {
+    uint32_t name;
+    uint32_t value;
+} attr_t;
+
+struct svf10_fpdb_st {
+    uint8_t* base;
+    size_t length;
+    const header_t* h;
+    const attr_t* attrs;
+    const svf10_fpdb_item_t* items;
+    const char* pool;
+    /* Always ends with '/', unless empty for the working directory. */
+    char dbpath[1024];
+};
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} pool_t;
+
+/* Appends s to pool and sets *offset to where it starts. */
+static int pool_add(pool_t* pool, const char* s, uint32_t* offset)
+{
+    size_t n = strlen(s) + 1;
+    size_t capacity;
+    char* data;
+
+    if (pool->size + n > UINT32_MAX)
+        return 0;
+    if (pool->size + n > pool->capacity) {
+        capacity = pool->capacity ? 2 * pool->capacity : 1 << 16;
+        while (capacity < pool->size + n)
+            capacity *= 2;
+        data = (char*) realloc(pool->data, capacity);
+        if (!data)
+            return 0;
+        pool->data = data;
+        pool->capacity = capacity;
+    }
+    memcpy(pool->data + pool->size, s, n);
+    *offset = (uint32_t) pool->size;
+    pool->size += n;
+    return 1;
+}
+
+pb_rc_t svf10_fpdb_convert(pb_fpdb_t* fpdb, const char* path)
+{
+    static const char zeros[8] = { 0 };
+    pb_fpdb_iter_t iter;
+    pb_fpdb_item_t* item;
+    svf10_fpdb_item_t* items = 0;
+    attr_t* attrs = 0;
+    pool_t pool = { 0, 0, 0 };
+    header_t h;
+    FILE* f = 0;
+    char* tmp = 0;
+    int n = 0, i;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!fpdb || !path)
+        return PB_RC_INVALID_PARAMETER;
+    attrs = (attr_t*) calloc(fpdb->num_attrs ? fpdb->num_attrs : 1, sizeof(*attrs));
+    items = (svf10_fpdb_item_t*) calloc(fpdb->num_items ? fpdb->num_items : 1, sizeof(*items));
+    tmp = (char*) malloc(strlen(path) + 5);
+    if (!attrs || !items || !tmp) {
+        rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+        goto done;
+    }
+
+    for (i = 0; i < fpdb->num_attrs; i++) {
+        if (!pool_add(&pool, fpdb->attrs[i].name, &attrs[i].name)
+            || !pool_add(&pool, fpdb->attrs[i].value, &attrs[i].value)) {
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+            goto done;
+        }
+    }
+    /* In iteration order, so that reading the index is one pass. */
+    for (item = pb_fpdb_iter_init(fpdb, &iter); item && n < fpdb->num_items;
+         item = pb_fpdb_iter_next(&iter), n++) {
+        items[n].personId = item->personId;
+        items[n].fingerId = item->fingerId;
+        items[n].fingerType = item->fingerType;
+        items[n].transId = item->transId;
+        items[n].personOrdinal = item->personOrdinal;
+        items[n].fingerOrdinal = item->fingerOrdinal;
+        items[n].transOrdinal = item->transOrdinal;
+        items[n].fingerNumber = item->fingerNumber;
+        if (!pool_add(&pool, item->filename, &items[n].filename)) {
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+            goto done;
+        }
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FPDB_MAGIC, sizeof(h.magic));
+    h.version = FPDB_VERSION;
+    h.item_size = sizeof(svf10_fpdb_item_t);
+    h.nitems = (uint32_t) n;
+    h.nattrs = (uint32_t) fpdb->num_attrs;
+    h.pool_size = (uint32_t) pool.size;
+    h.npersons = fpdb->nPersons;
+    h.nfingers = fpdb->nFingers;
+    h.ntrans = fpdb->nTrans;
+
+    /* Written aside and renamed into place, so that a process that has
+     * the old index mapped keeps reading it whole. */
+    sprintf(tmp, "%s.tmp", path);
+    f = fopen(tmp, "wb");
+    if (!f) {
+        rc = PB_RC_FILE_OPEN_FAILED;
+        goto done;
+    }
+    if (fwrite(&h, sizeof(h), 1, f) != 1
+        || fwrite(attrs, sizeof(*attrs), h.nattrs, f) != h.nattrs
+        || fwrite(items, sizeof(*items), h.nitems, f) != h.nitems
+        || fwrite(pool.data, 1, pool.size, f) != pool.size
+        || fwrite(zeros, 1, (8 - pool.size % 8) % 8, f) != (8 - pool.size % 8) % 8)
+        rc = PB_RC_FILE_WRITE_FAILED;
+    if (fclose(f) != 0 && rc == PB_RC_OK)
+        rc = PB_RC_FILE_WRITE_FAILED;
+    if (rc == PB_RC_OK && rename(tmp, path) != 0)
+        rc = PB_RC_FILE_WRITE_FAILED;
+    if (rc != PB_RC_OK)
+        unlink(tmp);
+
+done:
+    free(pool.data);
+    free(items);
+    free(attrs);
+    free(tmp);
+    return rc;
+}
+
+/* Sets fpdb->dbpath as pb_fpdb would: the dbpath attribute if there is
+ * one, else the directory the index is in. */
+static int set_dbpath(svf10_fpdb_t* fpdb, const char* path)
+{
+    const char* dbpath = svf10_fpdb_getstr(fpdb, "dbpath", 0);
+    const char* slash;
+    size_t n;
+
+    if (dbpath) {
+        n = strlen(dbpath);
+        if (n + 2 > sizeof(fpdb->dbpath))
+            return 0;
+        memcpy(fpdb->dbpath, dbpath, n);
+        if (n && dbpath[n - 1] != '/')
+            fpdb->dbpath[n++] = '/';
+    } else {
+        slash = strrchr(path, '/');
+        n = slash ? (size_t) (slash - path) + 1 : 0;
+        if (n + 1 > sizeof(fpdb->dbpath))
+            return 0;
+        memcpy(fpdb->dbpath, path, n);
+    }
+    fpdb->dbpath[n] = 0;
+    return 1;
+}
+
+svf10_fpdb_t* svf10_fpdb_open(const char* path)
+{
+    svf10_fpdb_t* fpdb;
+    const header_t* h;
+    struct stat st;
+    uint64_t size;
+    void* base;
+    int fd;
+
+    if (!path)
+        return 0;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(*h)) {
+        close(fd);
+        return 0;
+    }
+    base = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+    /* Items and the filenames they point to are laid out in iteration
+     * order. */
+    madvise(base, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    h = (const header_t*) base;
+    size = sizeof(*h) + (uint64_t) h->nattrs * sizeof(attr_t)
+         + (uint64_t) h->nitems * sizeof(svf10_fpdb_item_t) + h->pool_size;
+    fpdb = (svf10_fpdb_t*) calloc(1, sizeof(*fpdb));
+    if (!fpdb || memcmp(h->magic, FPDB_MAGIC, sizeof(h->magic))
+        || h->version != FPDB_VERSION || h->item_size != sizeof(svf10_fpdb_item_t)
+        || h->nitems > INT32_MAX || size > (uint64_t) st.st_size
+        || (h->pool_size && ((const char*) base)[size - 1] != 0)) {
+        free(fpdb);
+        munmap(base, (size_t) st.st_size);
+        return 0;
+    }
+    fpdb->base = (uint8_t*) base;
+    fpdb->length = (size_t) st.st_size;
+    fpdb->h = h;
+    fpdb->attrs = (const attr_t*) (h + 1);
+    fpdb->items = (const svf10_fpdb_item_t*) (fpdb->attrs + h->nattrs);
+    fpdb->pool = (const char*) (fpdb->items + h->nitems);
+
+    /* With the pool NUL-terminated, a string at any offset within it is
+     * too. Item filenames are checked as they are read. */
+    for (uint32_t i = 0; i < h->nattrs; i++) {
+        if (fpdb->attrs[i].name >= h->pool_size || fpdb->attrs[i].value >= h->pool_size) {
+            svf10_fpdb_close(fpdb);
+            return 0;
+        }
+    }
+    if (!set_dbpath(fpdb, path)) {
+        svf10_fpdb_close(fpdb);
+        return 0;
+    }
+    return fpdb;
+}
+
+void svf10_fpdb_close(svf10_fpdb_t* fpdb)
+{
+    if (!fpdb)
+        return;
+    munmap(fpdb->base, fpdb->length);
+    free(fpdb);
+}
+
+const char* svf10_fpdb_getstr(const svf10_fpdb_t* fpdb, const char* name, const char* def)
+{
+    if (!fpdb || !name)
+        return def;
+    for (uint32_t i = 0; i < fpdb->h->nattrs; i++)
+        if (!strcmp(fpdb->pool + fpdb->attrs[i].name, name))
+            return fpdb->pool + fpdb->attrs[i].value;
+    return def;
+}
+
+int svf10_fpdb_getint(const svf10_fpdb_t* fpdb, const char* name, int def)
+{
+    const char* value = svf10_fpdb_getstr(fpdb, name, 0);
+    char* end;
+    long v;
+
+    if (!value)
+        return def;
+    v = strtol(value, &end, 10);
+    return end == value || *end ? def : (int) v;
+}
+
+int svf10_fpdb_numitems(const svf10_fpdb_t* fpdb)
+{
+    return fpdb ? (int) fpdb->h->nitems : 0;
+}
+
+int svf10_fpdb_numpersons(const svf10_fpdb_t* fpdb)
+{
+    return fpdb ? fpdb->h->npersons : 0;
+}
+
+int svf10_fpdb_numfingers(const svf10_fpdb_t* fpdb)
+{
+    return fpdb ? fpdb->h->nfingers : 0;
+}
+
+int svf10_fpdb_numtrans(const svf10_fpdb_t* fpdb)
+{
+    return fpdb ? fpdb->h->ntrans : 0;
+}
+
+const char* svf10_fpdb_filename(const svf10_fpdb_t* fpdb, const svf10_fpdb_item_t* item)
+{
+    return item->filename < fpdb->h->pool_size ? fpdb->pool + item->filename : "";
+}
+
+const svf10_fpdb_item_t* svf10_fpdb_iter_init(const svf10_fpdb_t* fpdb, svf10_fpdb_iter_t* iter)
+{
+    iter->fpdb = fpdb;
+    iter->current = 0;
+    return svf10_fpdb_iter_cur(iter);
+}
+
+const svf10_fpdb_item_t* svf10_fpdb_iter_cur(svf10_fpdb_iter_t* iter)
+{
+    if (!iter->fpdb || iter->current >= (int) iter->fpdb->h->nitems)
+        return 0;
+    return &iter->fpdb->items[iter->current];
+}
+
+const svf10_fpdb_item_t* svf10_fpdb_iter_next(svf10_fpdb_iter_t* iter)
+{
+    if (svf10_fpdb_iter_cur(iter))
+        iter->current++;
+    return svf10_fpdb_iter_cur(iter);
+}
+
+const svf10_fpdb_item_t* svf10_fpdb_iter_peak(svf10_fpdb_iter_t* iter)
+{
+    if (!iter->fpdb || iter->current + 1 >= (int) iter->fpdb->h->nitems)
+        return 0;
+    return &iter->fpdb->items[iter->current + 1];
+}
+
+const char* svf10_fpdb_iter_fullname(svf10_fpdb_iter_t* iter, char buf[512])
+{
+    const svf10_fpdb_item_t* item = svf10_fpdb_iter_cur(iter);
+    int n;
+
+    if (!item)
+        return 0;
+    n = snprintf(buf, 512, "%s%s", iter->fpdb->dbpath, svf10_fpdb_filename(iter->fpdb, item));
+    return n >= 0 && n < 512 ? buf : 0;
+}
+
+const char* svf10_fpdb_iter_basename(svf10_fpdb_iter_t* iter, int strip_suffix, char buf[512])
+{
+    const svf10_fpdb_item_t* item = svf10_fpdb_iter_cur(iter);
+    const char* name;
+    const char* slash;
+    char* dot;
+
+    if (!item)
+        return 0;
+    name = svf10_fpdb_filename(iter->fpdb, item);
+    slash = strrchr(name, '/');
+    snprintf(buf, 512, "%s", slash ? slash + 1 : name);
+    if (strip_suffix && (dot = strrchr(buf, '.')) != 0)
+        *dot = 0;
+    return buf;
+}
+
+char* svf10_fpdb_iter_read(svf10_fpdb_iter_t* iter, size_t* item_size)
+{
+    char name[512];
+    char* data = 0;
+    FILE* f;
+    long size;
+
+    if (!svf10_fpdb_iter_fullname(iter, name))
+        return 0;
+    f = fopen(name, "rb");
+    if (!f)
+        return 0;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        data = (char*) malloc(size ? (size_t) size : 1);
+        if (data && fread(data, 1, (size_t) size, f) != (size_t) size) {
+            free(data);
+            data = 0;
+        }
+        if (data && item_size)
+            *item_size = (size_t) size;
+    }
+    fclose(f);
+    return data;
+}
@@ -0,0 +1,127 @@
+/*
+ * SVF10 fingerprint database index.
+ *
+ * A binary form of the index that pb_fpdb reads from index.txt. pb_fpdb
+ * parses the text on every run and holds every item in a pb_fpdb_item_t
+ * with a 1024 byte filename inline, and every attribute in 576 bytes, so
+ * the index of a database of a million images takes over a gigabyte.
+ *
+ * svf10_fpdb_convert() writes the index pb_fpdb read to a file of
+ * fixed-width item records, already in iteration order, followed by a
+ * pool of the strings they refer to: 40 bytes per item plus its
+ * filename. svf10_fpdb_open() maps that file. Opening it parses nothing,
+ * and pages are read only as the items on them are iterated.
+ *
+ * The svf10_fpdb_iter_* functions behave like their pb_fpdb_iter_*
+ * namesakes, over svf10_fpdb_item_t instead of pb_fpdb_item_t.
+ *
+ *   fpdb = pb_fpdb_read("/data/fvc2002/index.txt");
+ *   svf10_fpdb_convert(fpdb, "/data/fvc2002/index.bin");
+ *   pb_fpdb_free(fpdb);
+ *   ...
+ *   db = svf10_fpdb_open("/data/fvc2002/index.bin");
+ *   for (item = svf10_fpdb_iter_init(db, &iter); item; item = svf10_fpdb_iter_next(&iter))
+ *       data = svf10_fpdb_iter_read(&iter, &size);
+ *   svf10_fpdb_close(db);
+ */
+
+#ifndef SVF10_FPDB_H
+#define SVF10_FPDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pb_fpdb.h"
+#include "pb_returncodes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct svf10_fpdb_st svf10_fpdb_t;
+
+/** An item as stored: the fields of pb_fpdb_item_t, with the filename
+  * in the string pool. */
+typedef struct {
+    int32_t personId;
+    int32_t fingerId;
+    int32_t fingerType;
+    int32_t transId;
+    int32_t personOrdinal;
+    int32_t fingerOrdinal;
+    int32_t transOrdinal;
+    int32_t fingerNumber;
+    /* Offset of the relative filename in the string pool; see
+     * svf10_fpdb_filename(). */
+    uint32_t filename;
+    uint32_t reserved;
+} svf10_fpdb_item_t;
+
+typedef struct {
+    const svf10_fpdb_t* fpdb;
+    int current;
+} svf10_fpdb_iter_t;
+
+/** Writes the index of fpdb, as read by pb_fpdb_read(), to path. Items
+  * are written in the order pb_fpdb_iter_init() gives them. The extra
+  * data of items is not written.
+  *
+  * @return PB_RC_OK, or PB_RC_FILE_OPEN_FAILED or PB_RC_FILE_WRITE_FAILED
+  *         if path could not be written. */
+pb_rc_t svf10_fpdb_convert(pb_fpdb_t* fpdb, const char* path);
+
+/** Maps an index written by svf10_fpdb_convert(). Like an index.txt, the
+  * file must be in the base directory of the database unless it has a
+  * dbpath attribute.
+  *
+  * @return the index, to be closed with svf10_fpdb_close(), or 0 if the
+  *         file could not be read or is not an index this build wrote. */
+svf10_fpdb_t* svf10_fpdb_open(const char* path);
+
+/** Unmaps the index. Items and strings got from it become invalid. */
+void svf10_fpdb_close(svf10_fpdb_t* fpdb);
+
+/** See pb_fpdb_getint(). */
+int svf10_fpdb_getint(const svf10_fpdb_t* fpdb, const char* name, int def);
+
+/** See pb_fpdb_getstr(). */
+const char* svf10_fpdb_getstr(const svf10_fpdb_t* fpdb, const char* name, const char* def);
+
+/** Returns the number of items in the index. */
+int svf10_fpdb_numitems(const svf10_fpdb_t* fpdb);
+
+/** Returns the nPersons, nFingers and nTrans of the pb_fpdb_t the index
+  * was converted from. */
+int svf10_fpdb_numpersons(const svf10_fpdb_t* fpdb);
+int svf10_fpdb_numfingers(const svf10_fpdb_t* fpdb);
+int svf10_fpdb_numtrans(const svf10_fpdb_t* fpdb);
+
+/** Returns the filename of item relative to the database directory. */
+const char* svf10_fpdb_filename(const svf10_fpdb_t* fpdb, const svf10_fpdb_item_t* item);
+
+/** See pb_fpdb_iter_init(). */
+const svf10_fpdb_item_t* svf10_fpdb_iter_init(const svf10_fpdb_t* fpdb, svf10_fpdb_iter_t* iter);
+
+/** See pb_fpdb_iter_cur(). */
+const svf10_fpdb_item_t* svf10_fpdb_iter_cur(svf10_fpdb_iter_t* iter);
+
+/** See pb_fpdb_iter_next(). */
+const svf10_fpdb_item_t* svf10_fpdb_iter_next(svf10_fpdb_iter_t* iter);
+
+/** See pb_fpdb_iter_peak(). */
+const svf10_fpdb_item_t* svf10_fpdb_iter_peak(svf10_fpdb_iter_t* iter);
+
+/** See pb_fpdb_iter_fullname(). Returns 0 if there is no current item
+  * or its full name does not fit in buf. */
+const char* svf10_fpdb_iter_fullname(svf10_fpdb_iter_t* iter, char buf[512]);
+
+/** See pb_fpdb_iter_basename(). */
+const char* svf10_fpdb_iter_basename(svf10_fpdb_iter_t* iter, int strip_suffix, char buf[512]);
+
+/** See pb_fpdb_iter_read(). */
+char* svf10_fpdb_iter_read(svf10_fpdb_iter_t* iter, size_t* item_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_FPDB_H */
@@ -0,0 +1,1012 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "svf10_identifier.h"
+#include "svf10_descriptor.h"
+#include "svf10_crc32.h"
+#include "pb_image.h"
+#include "pb_alignment.h"
+#include "pb_user.h"
+
+#define MAX_LISTENERS 4
+
+/* Most templates one pb_algorithm_verify_templates() call takes. */
+#define MAX_VERIFY 255
+
+/* Bins by finger position. */
+#define POSITIONS       (PB_FINGER_POSITION_LEFT_LITTLE + 1)
+
+typedef struct {
+    pb_template_t* T;
+    pb_finger_t* finger;
+    void* reference;
+    int described;
+    svf10_descriptor_t descriptor;
+    /* The snapshot the entry was loaded from, or 0. */
+    uint32_t snapshot;
+} entry_t;
+
+typedef struct {
+    int* entries;
+    int n;
+    int capacity;
+} bin_t;
+
+typedef struct {
+    pb_identifierI_listener_fn_t* fn;
+    const void* context;
+} listener_t;
+
+typedef struct {
+    /* Held by every call; the algorithm runs one match at a time. */
+    pthread_mutex_t lock;
+    pb_algorithm_t* algorithm;
+    svf10_identifier_config_t config;
+    entry_t* entries;
+    int nentries;
+    int capacity;
+    bin_t bins[POSITIONS];
+    listener_t listeners[MAX_LISTENERS];
+    int nlisteners;
+
+    /* Held by a whole save or load, so they run one at a time. */
+    pthread_mutex_t snapshot_lock;
+    /* The last snapshot loaded and the thread checking it, which
+     * broadcasts checked_cond when done. */
+    uint32_t snapshot;
+    pthread_t checker;
+    int checker_started;
+    int checked;
+    pb_rc_t snapshot_rc;
+    pthread_cond_t checked_cond;
+} context_t;
+
+typedef struct {
+    int index;
+    uint32_t distance;
+    uint16_t score;
+} candidate_t;
+
+static context_t* get_context(pb_identifier_t* identifier)
+{
+    return identifier ? (context_t*) pb_identifier_get_context(identifier) : 0;
+}
+
+static int describe(const pb_template_t* T, svf10_descriptor_t* descriptor)
+{
+    const pb_image_t* image = pb_template_get_image(T);
+    const uint8_t* pixels = image ? pb_image_get_pixels(image) : 0;
+
+    if (!pixels)
+        return 0;
+    return svf10_descriptor_compute(pixels, pb_image_get_rows(image), pb_image_get_cols(image),
+                                    pb_image_get_cols(image), descriptor);
+}
+
+static int entry_position(const entry_t* e)
+{
+    int position = pb_finger_get_position(e->finger);
+
+    return position >= 0 && position < POSITIONS ? position : PB_FINGER_POSITION_UNKNOWN;
+}
+
+static int bin_add(bin_t* bin, int index)
+{
+    int* entries;
+    int capacity;
+
+    if (bin->n == bin->capacity) {
+        capacity = bin->capacity ? 2 * bin->capacity : 16;
+        entries = (int*) realloc(bin->entries, capacity * sizeof(*entries));
+        if (!entries)
+            return 0;
+        bin->entries = entries;
+        bin->capacity = capacity;
+    }
+    bin->entries[bin->n++] = index;
+    return 1;
+}
+
+/* Refills the bins after entries moved. Cannot fail: no bin needs more
+ * room than it had. */
+static void rebin(context_t* ctx)
+{
+    const entry_t* e;
+
+    for (int p = 0; p < POSITIONS; p++)
+        ctx->bins[p].n = 0;
+    for (int i = 0; i < ctx->nentries; i++) {
+        e = &ctx->entries[i];
+        bin_add(&ctx->bins[entry_position(e)], i);
+    }
+}
+
+/* Whether a and b are one finger: the same user, position and
+ * acquisition, as svf10_database keys its records. pb_finger_get_id()
+ * leaves out the acquisition, so would take every acquisition of a
+ * finger for one. */
+static int same_finger(const pb_finger_t* a, const pb_finger_t* b)
+{
+    return pb_finger_get_user_id(a) == pb_finger_get_user_id(b)
+        && pb_finger_get_position(a) == pb_finger_get_position(b)
+        && pb_finger_get_acquisition(a) == pb_finger_get_acquisition(b);
+}
+
+static int in_filter(const pb_finger_t* finger, const pb_finger_t* filter)
+{
+    if (!filter)
+        return 1;
+    if (pb_finger_get_user_id(filter) && pb_finger_get_user_id(filter) != pb_finger_get_user_id(finger))
+        return 0;
+    if (pb_finger_get_position(filter) != PB_FINGER_POSITION_UNKNOWN
+        && pb_finger_get_position(filter) != pb_finger_get_position(finger))
+        return 0;
+    return 1;
+}
+
+static int by_score(const void* a, const void* b)
+{
+    const candidate_t* x = (const candidate_t*) a;
+    const candidate_t* y = (const candidate_t*) b;
+
+    if (x->score != y->score)
+        return x->score > y->score ? -1 : 1;
+    return x->index - y->index;
+}
+
+/* Fills c with the candidates for the probe: the ncandidates described
+ * entries with the closest descriptors, closest first, then every entry
+ * without a descriptor (all of them if the probe has none). A filter with
+ * a position takes only that position's bin. Sets *n to the number of
+ * candidates. Called with the lock held. */
+static void select_candidates(const context_t* ctx, const svf10_descriptor_t* probe,
+                              const pb_finger_t* filter, int ncandidates,
+                              candidate_t* c, int* n)
+{
+    const bin_t* bin;
+    candidate_t next;
+    const entry_t* e;
+    int position, nranked = 0, k, m;
+
+    position = filter ? pb_finger_get_position(filter) : PB_FINGER_POSITION_UNKNOWN;
+    if (position < 0 || position >= POSITIONS)
+        position = PB_FINGER_POSITION_UNKNOWN;
+
+    /* The ranked candidates, kept sorted by distance in c[0, nranked). */
+    for (int p = 0; probe && p < POSITIONS; p++) {
+        if (position != PB_FINGER_POSITION_UNKNOWN && p != position)
+            continue;
+        bin = &ctx->bins[p];
+        for (int b = 0; b < bin->n; b++) {
+            e = &ctx->entries[bin->entries[b]];
+            if (!e->described || !in_filter(e->finger, filter))
+                continue;
+            next.index = bin->entries[b];
+            next.distance = svf10_descriptor_distance(probe, &e->descriptor);
+            next.score = 0;
+            if (nranked == ncandidates
+                && (!nranked || next.distance >= c[nranked - 1].distance))
+                continue;
+            if (nranked < ncandidates)
+                nranked++;
+            for (k = nranked - 1; k > 0 && c[k - 1].distance > next.distance; k--)
+                c[k] = c[k - 1];
+            c[k] = next;
+        }
+    }
+    m = nranked;
+    for (int p = 0; p < POSITIONS; p++) {
+        if (position != PB_FINGER_POSITION_UNKNOWN && p != position)
+            continue;
+        bin = &ctx->bins[p];
+        for (int b = 0; b < bin->n; b++) {
+            e = &ctx->entries[bin->entries[b]];
+            if ((probe && e->described) || !in_filter(e->finger, filter))
+                continue;
+            c[m].index = bin->entries[b];
+            c[m].distance = UINT32_MAX;
+            c[m].score = 0;
+            m++;
+        }
+    }
+    *n = m;
+}
+
+/* Tells the listeners about the full matches of candidates c[first, n). */
+static void notify(pb_identifier_t* identifier, const context_t* ctx,
+                   const candidate_t* c, int first, int n)
+{
+    for (int k = first; k < n; k++)
+        for (int l = 0; l < ctx->nlisteners; l++)
+            ctx->listeners[l].fn(identifier, ctx->entries[c[k].index].finger, c[k].score,
+                                 (uint8_t) ((k + 1) * 100 / ctx->nentries),
+                                 ctx->listeners[l].context);
+}
+
+/* Full-matches probe T against candidates c[0, n) for their similarity
+ * scores and sorts them by falling score. Called with the lock held. */
+static pb_rc_t score_candidates(pb_identifier_t* identifier, context_t* ctx,
+                                const pb_template_t* T, candidate_t* c, int n)
+{
+    pb_rc_t rc;
+
+    for (int k = 0; k < n; k++) {
+        rc = pb_algorithm_get_similarity_score(ctx->algorithm, &ctx->entries[c[k].index].T, 1,
+                                               T, &c[k].score);
+        if (rc != PB_RC_OK)
+            return rc;
+    }
+    notify(identifier, ctx, c, 0, n);
+    qsort(c, n, sizeof(*c), by_score);
+    return PB_RC_OK;
+}
+
+/* Verifies probe T against candidates c[0, n), up to MAX_VERIFY of them
+ * per call, so that each is full-matched once. Sets *match to the
+ * index in c of the one accepted at far, or -1, and *alignment, if given,
+ * to its alignment. The verification gives no scores, so listeners are
+ * not called. Called with the lock held. */
+static pb_rc_t verify_candidates(context_t* ctx, const pb_template_t* T, pb_far_t far,
+                                 const candidate_t* c, int n,
+                                 int* match, pb_alignment_t** alignment)
+{
+    pb_template_t* templates[MAX_VERIFY];
+    int count, decision, index;
+    pb_rc_t rc;
+
+    *match = -1;
+    for (int k = 0; k < n; k += count) {
+        count = n - k < MAX_VERIFY ? n - k : MAX_VERIFY;
+        for (int i = 0; i < count; i++)
+            templates[i] = ctx->entries[c[k + i].index].T;
+        index = -1;
+        rc = pb_algorithm_verify_templates(ctx->algorithm, templates, (uint8_t) count, T, far,
+                                           &decision, alignment, &index, 0);
+        if (rc != PB_RC_OK)
+            return rc;
+        if (decision == PB_DECISION_MATCH && index >= 0 && index < count) {
+            *match = k + index;
+            return PB_RC_OK;
+        }
+        if (alignment) {
+            pb_alignment_delete(*alignment);
+            *alignment = 0;
+        }
+    }
+    return PB_RC_OK;
+}
+
+/* Takes the candidate array for probe T and fills it, with the filter
+ * finger. Called with the lock held. */
+static pb_rc_t begin_search(const context_t* ctx, const pb_template_t* T,
+                            const pb_finger_t* filter, candidate_t** c, int* n)
+{
+    svf10_descriptor_t probe;
+    int described;
+
+    *c = 0;
+    *n = 0;
+    if (!ctx->algorithm)
+        return PB_RC_NOT_INITIALIZED;
+    if (!ctx->nentries)
+        return PB_RC_OK;
+    *c = (candidate_t*) malloc(ctx->nentries * sizeof(**c));
+    if (!*c)
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    described = describe(T, &probe);
+    select_candidates(ctx, described ? &probe : 0, filter, ctx->config.candidates, *c, n);
+    return PB_RC_OK;
+}
+
+static void release_entry(entry_t* e)
+{
+    pb_template_delete(e->T);
+    pb_finger_delete(e->finger);
+}
+
+/* Removes the entries of the fingers in remove[] and adds the nadded
+ * entries of added, in one hold of the lock. Entries not added, on
+ * failure, are released. */
+static pb_rc_t commit(context_t* ctx, const pb_finger_t* remove[], int nremove,
+                      entry_t* added, int nadded)
+{
+    entry_t* entries;
+    entry_t* e;
+    int capacity, kept = 0, removed, i, j;
+    pb_rc_t rc = PB_RC_OK;
+
+    pthread_mutex_lock(&ctx->lock);
+    /* Room first, so that a failure leaves the gallery as it was. */
+    if (ctx->nentries + nadded > ctx->capacity) {
+        capacity = ctx->capacity ? ctx->capacity : 16;
+        while (capacity < ctx->nentries + nadded)
+            capacity *= 2;
+        entries = (entry_t*) realloc(ctx->entries, capacity * sizeof(*entries));
+        if (!entries) {
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+        } else {
+            ctx->entries = entries;
+            ctx->capacity = capacity;
+        }
+    }
+    if (rc == PB_RC_OK && nremove) {
+        for (i = 0; i < ctx->nentries; i++) {
+            removed = 0;
+            for (j = 0; j < nremove && !removed; j++)
+                removed = remove[j] && same_finger(remove[j], ctx->entries[i].finger);
+            if (removed)
+                release_entry(&ctx->entries[i]);
+            else
+                ctx->entries[kept++] = ctx->entries[i];
+        }
+        ctx->nentries = kept;
+        rebin(ctx);
+    }
+    for (i = 0; rc == PB_RC_OK && i < nadded; i++) {
+        e = &ctx->entries[ctx->nentries];
+        *e = added[i];
+        if (!bin_add(&ctx->bins[entry_position(e)], ctx->nentries)) {
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+            break;
+        }
+        ctx->nentries++;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    for (; i < nadded; i++)
+        release_entry(&added[i]);
+    return rc;
+}
+
+/* Removes the entries of the fingers in remove[] and adds templates[] as
+ * one change. The descriptors, the costly part of adding, are computed
+ * before taking the lock. */
+static pb_rc_t update(context_t* ctx,
+                      const pb_finger_t* remove[], uint16_t nbr_to_remove,
+                      pb_template_t* templates[], pb_finger_t* fingers[],
+                      void* references[], uint16_t nbr_to_add)
+{
+    entry_t* added = 0;
+    entry_t* e;
+    pb_rc_t rc;
+
+    if (nbr_to_add) {
+        added = (entry_t*) malloc(nbr_to_add * sizeof(*added));
+        if (!added)
+            return PB_RC_MEMORY_ALLOCATION_FAILED;
+        for (int i = 0; i < nbr_to_add; i++) {
+            e = &added[i];
+            e->T = pb_template_retain(templates[i]);
+            e->finger = pb_finger_retain(fingers[i]);
+            e->reference = references ? references[i] : 0;
+            e->described = describe(e->T, &e->descriptor);
+            e->snapshot = 0;
+        }
+    }
+    rc = commit(ctx, remove, nbr_to_remove, added, nbr_to_add);
+    free(added);
+    return rc;
+}
+
+static pb_rc_t add_templates(pb_identifier_t* identifier,
+                             pb_template_t* templates[],
+                             pb_finger_t* fingers[],
+                             void* references[],
+                             uint16_t nbr_of_fingers)
+{
+    context_t* ctx = get_context(identifier);
+
+    if (!ctx || (nbr_of_fingers && (!templates || !fingers)))
+        return PB_RC_INVALID_PARAMETER;
+    for (int i = 0; i < nbr_of_fingers; i++)
+        if (!templates[i] || !fingers[i])
+            return PB_RC_INVALID_PARAMETER;
+    return update(ctx, 0, 0, templates, fingers, references, nbr_of_fingers);
+}
+
+static pb_rc_t remove_templates(pb_identifier_t* identifier,
+                                const pb_finger_t* fingers[],
+                                uint16_t nbr_of_fingers)
+{
+    context_t* ctx = get_context(identifier);
+
+    if (!ctx || (nbr_of_fingers && !fingers))
+        return PB_RC_INVALID_PARAMETER;
+    return update(ctx, fingers, nbr_of_fingers, 0, 0, 0, 0);
+}
+
+static pb_rc_t remove_all_templates(pb_identifier_t* identifier)
+{
+    context_t* ctx = get_context(identifier);
+
+    if (!ctx)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->lock);
+    for (int i = 0; i < ctx->nentries; i++)
+        release_entry(&ctx->entries[i]);
+    ctx->nentries = 0;
+    rebin(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+    return PB_RC_OK;
+}
+
+static pb_rc_t identify_template(pb_identifier_t* identifier,
+                                 const pb_template_t* template_,
+                                 const pb_finger_t* finger,
+                                 pb_fpir_t false_positive_identification_rate,
+                                 pb_finger_t** identified_finger,
+                                 void** reference,
+                                 pb_alignment_t** alignment)
+{
+    context_t* ctx = get_context(identifier);
+    candidate_t* c;
+    entry_t* e;
+    pb_far_t far;
+    int n, match = -1;
+    pb_rc_t rc;
+
+    if (!ctx || !template_ || !identified_finger)
+        return PB_RC_INVALID_PARAMETER;
+    *identified_finger = 0;
+    if (reference)
+        *reference = 0;
+    if (alignment)
+        *alignment = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+    rc = begin_search(ctx, template_, finger, &c, &n);
+    /* The FAR is the one the FPIR asks for over the whole gallery, however
+     * few candidates are full-matched. */
+    far = pb_identifier_fpir_to_far(false_positive_identification_rate, ctx->nentries);
+    if (rc == PB_RC_OK)
+        rc = verify_candidates(ctx, template_, far, c, n, &match, alignment);
+    if (rc == PB_RC_OK && match >= 0) {
+        e = &ctx->entries[c[match].index];
+        *identified_finger = pb_finger_retain(e->finger);
+        if (reference)
+            *reference = e->reference;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    free(c);
+    return rc;
+}
+
+static pb_rc_t identify_template_rank(pb_identifier_t* identifier,
+                                      const pb_template_t* template_,
+                                      const pb_finger_t* finger,
+                                      uint8_t rank,
+                                      pb_finger_t* identified_fingers[],
+                                      uint16_t scores[],
+                                      void* references[],
+                                      pb_alignment_t* alignments[])
+{
+    context_t* ctx = get_context(identifier);
+    candidate_t* c;
+    entry_t* e;
+    int n;
+    pb_rc_t rc;
+
+    if (!ctx || !template_ || !identified_fingers)
+        return PB_RC_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&ctx->lock);
+    rc = begin_search(ctx, template_, finger, &c, &n);
+    if (rc == PB_RC_OK)
+        rc = score_candidates(identifier, ctx, template_, c, n);
+
+    /* Similarity scores come without an alignment. */
+    for (int k = 0; k < rank; k++) {
+        e = rc == PB_RC_OK && k < n ? &ctx->entries[c[k].index] : 0;
+        identified_fingers[k] = e ? pb_finger_retain(e->finger) : 0;
+        if (scores)
+            scores[k] = e ? c[k].score : 0;
+        if (references)
+            references[k] = e ? e->reference : 0;
+        if (alignments)
+            alignments[k] = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    free(c);
+    return rc;
+}
+
+static pb_rc_t register_listener(pb_identifier_t* identifier,
+                                 pb_identifierI_listener_fn_t* listener,
+                                 const void* context)
+{
+    context_t* ctx = get_context(identifier);
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!ctx || !listener)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->nlisteners < MAX_LISTENERS) {
+        ctx->listeners[ctx->nlisteners].fn = listener;
+        ctx->listeners[ctx->nlisteners].context = context;
+        ctx->nlisteners++;
+    } else {
+        rc = PB_RC_CAPACITY;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return rc;
+}
+
+static pb_rc_t unregister_listener(pb_identifier_t* identifier,
+                                   pb_identifierI_listener_fn_t* listener)
+{
+    context_t* ctx = get_context(identifier);
+    int kept = 0;
+
+    if (!ctx)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->lock);
+    for (int i = 0; i < ctx->nlisteners; i++)
+        if (ctx->listeners[i].fn != listener)
+            ctx->listeners[kept++] = ctx->listeners[i];
+    ctx->nlisteners = kept;
+    pthread_mutex_unlock(&ctx->lock);
+    return PB_RC_OK;
+}
+
+static const pb_identifier_functionsI functions = {
+    add_templates,
+    remove_templates,
+    remove_all_templates,
+    identify_template,
+    identify_template_rank,
+    register_listener,
+    unregister_listener
+};
+
+static void delete_context(void* context)
+{
+    context_t* ctx = (context_t*) context;
+
+    if (ctx->checker_started)
+        pthread_join(ctx->checker, 0);
+    for (int i = 0; i < ctx->nentries; i++)
+        release_entry(&ctx->entries[i]);
+    free(ctx->entries);
+    for (int p = 0; p < POSITIONS; p++)
+        free(ctx->bins[p].entries);
+    pb_algorithm_delete(ctx->algorithm);
+    pthread_cond_destroy(&ctx->checked_cond);
+    pthread_mutex_destroy(&ctx->snapshot_lock);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
+static pb_identifier_t* create(pb_session_t* session, uint8_t nbr_of_worker_threads)
+{
+    context_t* ctx;
+    pb_identifier_t* identifier;
+
+    ctx = (context_t*) calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return 0;
+    pthread_mutex_init(&ctx->lock, 0);
+    pthread_mutex_init(&ctx->snapshot_lock, 0);
+    pthread_cond_init(&ctx->checked_cond, 0);
+    ctx->checked = 1;
+    ctx->config = svf10_identifier_default_config;
+
+    identifier = pb_identifier_create(session, nbr_of_worker_threads, &functions,
+                                      ctx, delete_context);
+    if (!identifier)
+        delete_context(ctx);
+    return identifier;
+}
+
+pbif_const pb_identifierI svf10_identifier = {
+    create,
+    pb_identifier_delete
+};
+
+void svf10_identifier_set_config(pb_identifier_t* identifier,
+                                 const svf10_identifier_config_t* config)
+{
+    context_t* ctx = get_context(identifier);
+
+    if (!ctx || !config)
+        return;
+    pthread_mutex_lock(&ctx->lock);
+    ctx->config = *config;
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+pb_rc_t svf10_identifier_set_algorithm(pb_identifier_t* identifier,
+                                       pb_algorithm_t* algorithm)
+{
+    context_t* ctx = get_context(identifier);
+
+    if (!ctx || !algorithm)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->lock);
+    pb_algorithm_delete(ctx->algorithm);
+    ctx->algorithm = pb_algorithm_retain(algorithm);
+    pthread_mutex_unlock(&ctx->lock);
+    return PB_RC_OK;
+}
+
+pb_rc_t svf10_identifier_update(pb_identifier_t* identifier,
+                                const pb_finger_t* remove[],
+                                uint16_t nbr_to_remove,
+                                pb_template_t* templates[],
+                                pb_finger_t* fingers[],
+                                void* references[],
+                                uint16_t nbr_to_add)
+{
+    context_t* ctx = get_context(identifier);
+
+    if (!ctx || (nbr_to_remove && !remove) || (nbr_to_add && (!templates || !fingers)))
+        return PB_RC_INVALID_PARAMETER;
+    for (int i = 0; i < nbr_to_add; i++)
+        if (!templates[i] || !fingers[i])
+            return PB_RC_INVALID_PARAMETER;
+    return update(ctx, remove, nbr_to_remove, templates, fingers, references, nbr_to_add);
+}
+
+/* Snapshots -----------------------------------------------------------------*/
+
+#define SNAPSHOT_MAGIC      "SVF10ID"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_ALIGN      8
+
+/* The file is this header, a table of nentries snapshot_entry_t and the
+ * template data, each template at an offset into it aligned to
+ * SNAPSHOT_ALIGN. crc covers all that follows the header. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t nentries;
+    uint32_t crc;
+    uint64_t size;
+} snapshot_header_t;
+
+typedef struct {
+    uint64_t reference;
+    uint64_t data_offset;
+    uint32_t data_size;
+    uint32_t user_id;
+    uint32_t acquisition;
+    uint16_t position;
+    uint16_t type;
+    uint32_t described;
+    svf10_descriptor_t descriptor;
+} snapshot_entry_t;
+
+/* A loaded snapshot, mapped for as long as the check or a template loaded
+ * from it needs it. */
+typedef struct {
+    uint8_t* base;
+    size_t length;
+    int refs;
+} snapshot_t;
+
+typedef struct {
+    context_t* ctx;
+    snapshot_t* snapshot;
+    uint32_t generation;
+} check_t;
+
+static void snapshot_release(void* object)
+{
+    snapshot_t* snapshot = (snapshot_t*) object;
+
+    if (__sync_sub_and_fetch(&snapshot->refs, 1) == 0) {
+        munmap(snapshot->base, snapshot->length);
+        free(snapshot);
+    }
+}
+
+static size_t align_up(size_t n)
+{
+    return (n + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+static int write_all(int fd, const void* data, size_t n)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    ssize_t written;
+
+    while (n) {
+        written = write(fd, p, n);
+        if (written <= 0)
+            return 0;
+        p += written;
+        n -= (size_t) written;
+    }
+    return 1;
+}
+
+pb_rc_t svf10_identifier_save(pb_identifier_t* identifier, const char* path)
+{
+    static const uint8_t zeros[SNAPSHOT_ALIGN] = { 0 };
+    context_t* ctx = get_context(identifier);
+    snapshot_header_t h;
+    snapshot_entry_t* table = 0;
+    entry_t* entries = 0;
+    uint64_t offset = 0;
+    uint32_t crc, size;
+    char* tmp = 0;
+    int n = 0, fd = -1, i;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!ctx || !path)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->snapshot_lock);
+
+    /* The gallery as it is now; the file is written without holding up
+     * identification. */
+    pthread_mutex_lock(&ctx->lock);
+    n = ctx->nentries;
+    entries = (entry_t*) malloc((n ? n : 1) * sizeof(*entries));
+    if (entries) {
+        for (i = 0; i < n; i++) {
+            entries[i] = ctx->entries[i];
+            pb_template_retain(entries[i].T);
+            pb_finger_retain(entries[i].finger);
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    table = (snapshot_entry_t*) calloc(n ? n : 1, sizeof(*table));
+    tmp = (char*) malloc(strlen(path) + 5);
+    if (!entries || !table || !tmp) {
+        rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+        goto done;
+    }
+    for (i = 0; i < n; i++) {
+        table[i].reference = (uint64_t) (uintptr_t) entries[i].reference;
+        table[i].data_offset = offset;
+        table[i].data_size = pb_template_get_data_size(entries[i].T);
+        table[i].user_id = pb_finger_get_user_id(entries[i].finger);
+        table[i].acquisition = pb_finger_get_acquisition(entries[i].finger);
+        table[i].position = (uint16_t) pb_finger_get_position(entries[i].finger);
+        table[i].type = (uint16_t) pb_template_get_type(entries[i].T);
+        table[i].described = (uint32_t) entries[i].described;
+        table[i].descriptor = entries[i].descriptor;
+        offset += align_up(table[i].data_size);
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.entry_size = sizeof(snapshot_entry_t);
+    h.nentries = (uint32_t) n;
+    h.size = n * sizeof(*table) + offset;
+
+    sprintf(tmp, "%s.tmp", path);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        rc = PB_RC_FILE_OPEN_FAILED;
+        goto done;
+    }
+    rc = PB_RC_FILE_WRITE_FAILED;
+    crc = svf10_crc32(0, table, n * sizeof(*table));
+    if (!write_all(fd, &h, sizeof(h)) || !write_all(fd, table, n * sizeof(*table)))
+        goto done;
+    for (i = 0; i < n; i++) {
+        size = table[i].data_size;
+        crc = svf10_crc32(crc, pb_template_get_data(entries[i].T), size);
+        crc = svf10_crc32(crc, zeros, align_up(size) - size);
+        if (!write_all(fd, pb_template_get_data(entries[i].T), size)
+            || !write_all(fd, zeros, align_up(size) - size))
+            goto done;
+    }
+    h.crc = crc;
+    if (pwrite(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) || fdatasync(fd) != 0)
+        goto done;
+    close(fd);
+    fd = -1;
+    if (rename(tmp, path) == 0)
+        rc = PB_RC_OK;
+
+done:
+    if (fd >= 0)
+        close(fd);
+    if (rc != PB_RC_OK && tmp)
+        unlink(tmp);
+    for (i = 0; entries && i < n; i++)
+        release_entry(&entries[i]);
+    free(entries);
+    free(table);
+    free(tmp);
+    pthread_mutex_unlock(&ctx->snapshot_lock);
+    return rc;
+}
+
+/* Checks the CRC of a loaded snapshot and, if it fails, removes the
+ * entries loaded from it. */
+static void* check_main(void* arg)
+{
+    check_t* check = (check_t*) arg;
+    context_t* ctx = check->ctx;
+    const snapshot_header_t* h = (const snapshot_header_t*) check->snapshot->base;
+    int ok, kept = 0;
+
+    ok = svf10_crc32(0, h + 1, h->size) == h->crc;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (!ok) {
+        for (int i = 0; i < ctx->nentries; i++) {
+            if (ctx->entries[i].snapshot == check->generation)
+                release_entry(&ctx->entries[i]);
+            else
+                ctx->entries[kept++] = ctx->entries[i];
+        }
+        ctx->nentries = kept;
+        rebin(ctx);
+    }
+    ctx->snapshot_rc = ok ? PB_RC_OK : PB_RC_WRONG_DATA_FORMAT;
+    ctx->checked = 1;
+    pthread_cond_broadcast(&ctx->checked_cond);
+    pthread_mutex_unlock(&ctx->lock);
+
+    snapshot_release(check->snapshot);
+    free(check);
+    return 0;
+}
+
+/* Maps path and checks everything but the CRC: that the header is one
+ * this build writes and every template lies within the file. */
+static pb_rc_t snapshot_map(const char* path, snapshot_t** snapshot)
+{
+    const snapshot_header_t* h;
+    const snapshot_entry_t* table;
+    struct stat st;
+    uint64_t data_size;
+    void* base;
+    int fd;
+
+    *snapshot = 0;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return PB_RC_FILE_OPEN_FAILED;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(*h)) {
+        close(fd);
+        return PB_RC_WRONG_DATA_FORMAT;
+    }
+    base = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return PB_RC_FILE_READ_FAILED;
+
+    h = (const snapshot_header_t*) base;
+    table = (const snapshot_entry_t*) (h + 1);
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) || h->version != SNAPSHOT_VERSION
+        || h->entry_size != sizeof(snapshot_entry_t)
+        || h->size != (uint64_t) st.st_size - sizeof(*h)
+        || (uint64_t) h->nentries * sizeof(*table) > h->size) {
+        munmap(base, (size_t) st.st_size);
+        return PB_RC_WRONG_DATA_FORMAT;
+    }
+    data_size = h->size - (uint64_t) h->nentries * sizeof(*table);
+    for (uint32_t i = 0; i < h->nentries; i++) {
+        if (table[i].data_offset > data_size || table[i].data_size > data_size - table[i].data_offset) {
+            munmap(base, (size_t) st.st_size);
+            return PB_RC_WRONG_DATA_FORMAT;
+        }
+    }
+
+    *snapshot = (snapshot_t*) calloc(1, sizeof(**snapshot));
+    if (!*snapshot) {
+        munmap(base, (size_t) st.st_size);
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    }
+    (*snapshot)->base = (uint8_t*) base;
+    (*snapshot)->length = (size_t) st.st_size;
+    (*snapshot)->refs = 1;
+    return PB_RC_OK;
+}
+
+pb_rc_t svf10_identifier_load(pb_identifier_t* identifier, const char* path)
+{
+    context_t* ctx = get_context(identifier);
+    const snapshot_header_t* h;
+    const snapshot_entry_t* table;
+    const uint8_t* data;
+    snapshot_t* snapshot = 0;
+    entry_t* added = 0;
+    entry_t* e;
+    check_t* check = 0;
+    pb_user_t* user;
+    uint32_t generation;
+    int n = 0, i;
+    pb_rc_t rc;
+
+    if (!ctx || !path)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->snapshot_lock);
+    if (ctx->checker_started) {
+        pthread_join(ctx->checker, 0);
+        ctx->checker_started = 0;
+    }
+
+    rc = snapshot_map(path, &snapshot);
+    if (rc != PB_RC_OK)
+        goto done;
+    h = (const snapshot_header_t*) snapshot->base;
+    table = (const snapshot_entry_t*) (h + 1);
+    data = (const uint8_t*) (table + h->nentries);
+    generation = ++ctx->snapshot;
+
+    added = (entry_t*) malloc((h->nentries ? h->nentries : 1) * sizeof(*added));
+    check = (check_t*) malloc(sizeof(*check));
+    if (!added || !check) {
+        rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+        goto done;
+    }
+    for (n = 0; n < (int) h->nentries; n++) {
+        e = &added[n];
+        __sync_add_and_fetch(&snapshot->refs, 1);
+        e->T = pb_template_create_mre((pb_template_type_t) table[n].type,
+                                      data + table[n].data_offset, table[n].data_size,
+                                      0, snapshot_release, snapshot);
+        if (!e->T)
+            snapshot_release(snapshot);
+        user = pb_user_create(table[n].user_id);
+        e->finger = user ? pb_finger_create_acquisition((pb_finger_position_t) table[n].position,
+                                                        user, table[n].acquisition) : 0;
+        pb_user_delete(user);
+        if (!e->T || !e->finger) {
+            release_entry(e);
+            rc = PB_RC_MEMORY_ALLOCATION_FAILED;
+            goto done;
+        }
+        e->reference = (void*) (uintptr_t) table[n].reference;
+        e->described = (int) table[n].described;
+        e->descriptor = table[n].descriptor;
+        e->snapshot = generation;
+    }
+    rc = commit(ctx, 0, 0, added, n);
+    n = 0;
+    if (rc != PB_RC_OK)
+        goto done;
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->checked = 0;
+    pthread_mutex_unlock(&ctx->lock);
+    check->ctx = ctx;
+    check->snapshot = snapshot;
+    check->generation = generation;
+    if (pthread_create(&ctx->checker, 0, check_main, check) == 0)
+        ctx->checker_started = 1;
+    else
+        check_main(check);
+    snapshot = 0;
+    check = 0;
+
+done:
+    for (i = 0; i < n; i++)
+        release_entry(&added[i]);
+    free(added);
+    free(check);
+    if (snapshot)
+        snapshot_release(snapshot);
+    pthread_mutex_unlock(&ctx->snapshot_lock);
+    return rc;
+}
+
+pb_rc_t svf10_identifier_check_snapshot(pb_identifier_t* identifier)
+{
+    context_t* ctx = get_context(identifier);
+    pb_rc_t rc;
+
+    if (!ctx)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&ctx->lock);
+    while (!ctx->checked)
+        pthread_cond_wait(&ctx->checked_cond, &ctx->lock);
+    rc = ctx->snapshot_rc;
+    pthread_mutex_unlock(&ctx->lock);
+    return rc;
+}
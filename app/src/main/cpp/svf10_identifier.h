@@ -0,0 +1,106 @@
+/*
+ * SVF10 identifier.
+ *
+ * A pb_identifierI that keeps a descriptor (svf10_descriptor.h) of every
+ * template added, computed once in add_templates from the image the
+ * template carries. Identification ranks the gallery by descriptor
+ * distance to the probe and full-matches only the closest candidates, so
+ * the number of full matches per probe stays at the configured counts
+ * however large the gallery grows. Templates without an image (and every
+ * template, for a probe without one) cannot be ranked and are always
+ * full-matched.
+ *
+ * Templates are binned by finger position, so a finger filter with a
+ * position ranks only the templates of that position.
+ *
+ * identify_template verifies the candidates of a pass in one call, so
+ * each is full-matched once. That gives a decision but no scores, so it
+ * does not call the listeners. identify_template_rank gets the
+ * similarity score of each candidate and calls the listeners with it.
+ *
+ *   identifier = svf10_identifier.create(session, 0);
+ *   svf10_identifier_set_algorithm(identifier, algorithm);
+ *   pb_identifier_add_templates(identifier, templates, fingers, 0, n);
+ *   pb_identifier_identify_template(identifier, T, 0, PB_FPIR_1000,
+ *                                   &finger, 0, 0);
+ */
+
+#ifndef SVF10_IDENTIFIER_H
+#define SVF10_IDENTIFIER_H
+
+#include "pb_identifierI.h"
+#include "pb_algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The SVF10 identifier. Identification runs on the calling thread; the
+  * worker thread count given to create is not used. */
+extern pbif_const pb_identifierI svf10_identifier;
+
+/** Configuration of the identifier. */
+typedef struct svf10_identifier_config_st {
+    /** Ranked templates full-matched per probe at most, the closest
+      * first. More candidates find fingers whose descriptors came out far
+      * apart (poor or partial captures) at the cost of time. Default 16. */
+    uint16_t candidates;
+} svf10_identifier_config_t;
+
+static const svf10_identifier_config_t svf10_identifier_default_config = { 16 };
+
+/** Sets the configuration; the default is set on creation. */
+void svf10_identifier_set_config(pb_identifier_t* identifier,
+                                 const svf10_identifier_config_t* config);
+
+/** Sets the algorithm that full-matches the candidates, the one the
+  * templates were extracted with. Must be called before identifying. */
+pb_rc_t svf10_identifier_set_algorithm(pb_identifier_t* identifier,
+                                       pb_algorithm_t* algorithm);
+
+/** Removes the templates of the fingers in remove[], matched on user,
+  * position and acquisition, and adds templates[] for fingers[] as one
+  * change: an identification running alongside sees the gallery either
+  * before or after it, never a finger missing between its removal and
+  * its new template being added. Descriptors are computed before
+  * identification is held up, which is then only for as long as the
+  * bookkeeping takes. references may be 0. */
+pb_rc_t svf10_identifier_update(pb_identifier_t* identifier,
+                                const pb_finger_t* remove[],
+                                uint16_t nbr_to_remove,
+                                pb_template_t* templates[],
+                                pb_finger_t* fingers[],
+                                void* references[],
+                                uint16_t nbr_to_add);
+
+/** Saves the gallery to a snapshot file at path: every template's data,
+  * finger and reference and the descriptor computed for it. The file is
+  * written next to path and renamed over it when complete. A snapshot is
+  * a cache for this build on this device, not an exchange format, and
+  * references are saved as their values, so only references that are
+  * numbers rather than pointers survive a restart. */
+pb_rc_t svf10_identifier_save(pb_identifier_t* identifier, const char* path);
+
+/** Adds the gallery of a snapshot saved by svf10_identifier_save(). The
+  * file is mapped, not read: the templates point into the mapping and the
+  * descriptors are taken as saved, so identification can start as soon
+  * as this returns, however large the gallery. The layout is checked
+  * here; the CRC over the templates is checked on a background thread
+  * which, should it fail, removes every template the snapshot added.
+  *
+  * @return PB_RC_OK, PB_RC_WRONG_DATA_FORMAT if the file is not a
+  *         snapshot this build wrote, or another error reading it. */
+pb_rc_t svf10_identifier_load(pb_identifier_t* identifier, const char* path);
+
+/** Waits for the background check of the last snapshot loaded.
+  *
+  * @return PB_RC_OK if it passed or no snapshot was loaded, or
+  *         PB_RC_WRONG_DATA_FORMAT if the snapshot's templates were
+  *         removed. */
+pb_rc_t svf10_identifier_check_snapshot(pb_identifier_t* identifier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_IDENTIFIER_H */
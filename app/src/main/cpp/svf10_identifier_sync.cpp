@@ -0,0 +1,278 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "svf10_identifier_sync.h"
+#include "svf10_identifier.h"
+#include "pb_identifier.h"
+
+/* Most changes per identifier call, so that identification is not held
+ * up for long by a large batch. */
+#define MAX_CHANGES 256
+
+typedef struct {
+    pb_finger_t* finger;
+    /* The template to add, or 0 to remove the finger. */
+    pb_template_t* T;
+} change_t;
+
+struct svf10_identifier_sync_st {
+    pb_session_t* session;
+    const pb_databaseI* database;
+    pb_identifier_t* identifier;
+    /* The identifier is an svf10_identifier. */
+    int svf10;
+    pthread_t thread;
+    int started;
+
+    /* lock guards everything below. The listener queues changes and wakes
+     * the thread on work_cond; flush waits on done_cond. */
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    /* One change per finger. */
+    change_t* queue;
+    int nqueued;
+    int capacity;
+    /* Changes received, coalesced ones included, and of those the ones
+     * applied. */
+    uint32_t received;
+    uint32_t applied;
+    int exit;
+    pb_rc_t error;
+};
+
+static void release_change(change_t* c)
+{
+    pb_finger_delete(c->finger);
+    pb_template_delete(c->T);
+}
+
+/* Whether a and b are one finger: the same user, position and
+ * acquisition, as svf10_database keys its records. */
+static int same_finger(const pb_finger_t* a, const pb_finger_t* b)
+{
+    return pb_finger_get_user_id(a) == pb_finger_get_user_id(b)
+        && pb_finger_get_position(a) == pb_finger_get_position(b)
+        && pb_finger_get_acquisition(a) == pb_finger_get_acquisition(b);
+}
+
+/* Queues a change for finger, replacing the one already queued. With
+ * keep_queued a change already queued wins instead. Called with the lock
+ * held. */
+static pb_rc_t queue_change(svf10_identifier_sync_t* sync, const pb_finger_t* finger,
+                            const pb_template_t* T, int keep_queued)
+{
+    change_t* queue;
+    change_t* c = 0;
+    int capacity;
+
+    for (int i = 0; i < sync->nqueued && !c; i++)
+        if (same_finger(sync->queue[i].finger, finger))
+            c = &sync->queue[i];
+    if (c && keep_queued)
+        return PB_RC_OK;
+    if (c) {
+        pb_template_delete(c->T);
+    } else {
+        if (sync->nqueued == sync->capacity) {
+            capacity = sync->capacity ? 2 * sync->capacity : 16;
+            queue = (change_t*) realloc(sync->queue, capacity * sizeof(*queue));
+            if (!queue)
+                return PB_RC_MEMORY_ALLOCATION_FAILED;
+            sync->queue = queue;
+            sync->capacity = capacity;
+        }
+        c = &sync->queue[sync->nqueued++];
+        c->finger = pb_finger_retain((pb_finger_t*) finger);
+    }
+    c->T = T ? pb_template_retain((pb_template_t*) T) : 0;
+    return PB_RC_OK;
+}
+
+static void listener(pb_session_t* session, pb_databaseI_event_t event_,
+                     const pb_template_t* template_, const pb_finger_t* finger,
+                     const void* context)
+{
+    svf10_identifier_sync_t* sync = (svf10_identifier_sync_t*) context;
+    pb_rc_t rc;
+
+    (void) session;
+    if (!finger || (event_ == PB_DATABASE_EVENT_TEMPLATE_INSERTED && !template_))
+        return;
+    pthread_mutex_lock(&sync->lock);
+    rc = queue_change(sync, finger, event_ == PB_DATABASE_EVENT_TEMPLATE_INSERTED ? template_ : 0, 0);
+    if (rc != PB_RC_OK && sync->error == PB_RC_OK)
+        sync->error = rc;
+    sync->received++;
+    pthread_cond_signal(&sync->work_cond);
+    pthread_mutex_unlock(&sync->lock);
+}
+
+/* Applies n changes, one finger each: every finger is removed and those
+ * with a template added back with it. */
+static pb_rc_t apply(svf10_identifier_sync_t* sync, const change_t* changes, int n)
+{
+    const pb_finger_t* remove[MAX_CHANGES];
+    pb_template_t* templates[MAX_CHANGES];
+    pb_finger_t* fingers[MAX_CHANGES];
+    int nadd = 0;
+    pb_rc_t rc;
+
+    for (int i = 0; i < n; i++) {
+        remove[i] = changes[i].finger;
+        if (changes[i].T) {
+            templates[nadd] = changes[i].T;
+            fingers[nadd++] = changes[i].finger;
+        }
+    }
+    if (sync->svf10)
+        return svf10_identifier_update(sync->identifier, remove, (uint16_t) n,
+                                       templates, fingers, 0, (uint16_t) nadd);
+    rc = pb_identifier_remove_templates(sync->identifier, remove, (uint16_t) n);
+    if (rc == PB_RC_OK && nadd)
+        rc = pb_identifier_add_templates(sync->identifier, templates, fingers, 0, (uint16_t) nadd);
+    return rc;
+}
+
+static void* sync_main(void* arg)
+{
+    svf10_identifier_sync_t* sync = (svf10_identifier_sync_t*) arg;
+    change_t* batch;
+    uint32_t received;
+    pb_rc_t rc, error;
+    int n;
+
+    pthread_mutex_lock(&sync->lock);
+    for (;;) {
+        while (!sync->nqueued && !sync->exit)
+            pthread_cond_wait(&sync->work_cond, &sync->lock);
+        if (!sync->nqueued)
+            break;
+        /* Take the queue; changes from here on start a new one. */
+        batch = sync->queue;
+        n = sync->nqueued;
+        received = sync->received;
+        sync->queue = 0;
+        sync->nqueued = sync->capacity = 0;
+        pthread_mutex_unlock(&sync->lock);
+
+        error = PB_RC_OK;
+        for (int i = 0; i < n; i += MAX_CHANGES) {
+            rc = apply(sync, batch + i, n - i < MAX_CHANGES ? n - i : MAX_CHANGES);
+            if (rc != PB_RC_OK && error == PB_RC_OK)
+                error = rc;
+        }
+        for (int i = 0; i < n; i++)
+            release_change(&batch[i]);
+        free(batch);
+
+        pthread_mutex_lock(&sync->lock);
+        if (error != PB_RC_OK && sync->error == PB_RC_OK)
+            sync->error = error;
+        sync->applied = received;
+        pthread_cond_broadcast(&sync->done_cond);
+    }
+    pthread_mutex_unlock(&sync->lock);
+    return 0;
+}
+
+/* Queues every template in the database. Runs before the thread starts,
+ * so a change the listener queued meanwhile is still queued and, being
+ * the newer, wins. */
+static pb_rc_t load(svf10_identifier_sync_t* sync)
+{
+    pb_iterator_t* it = 0;
+    pb_template_t* T;
+    pb_finger_t* finger;
+    pb_rc_t rc;
+
+    rc = sync->database->get_finger_iterator(sync->session, &it);
+    while (rc == PB_RC_OK && (finger = (pb_finger_t*) pb_iterator_next(it)) != 0) {
+        T = 0;
+        rc = sync->database->get_template(sync->session, finger, &T);
+        if (rc == PB_RC_NOT_FOUND) {
+            /* Deleted since the iterator was made. */
+            rc = PB_RC_OK;
+        } else if (rc == PB_RC_OK) {
+            pthread_mutex_lock(&sync->lock);
+            rc = queue_change(sync, finger, T, 1);
+            sync->received++;
+            pthread_mutex_unlock(&sync->lock);
+        }
+        pb_template_delete(T);
+        pb_finger_delete(finger);
+    }
+    pb_iterator_delete(it);
+    return rc;
+}
+
+svf10_identifier_sync_t* svf10_identifier_sync_create(pb_session_t* session,
+                                                      const pb_databaseI* database,
+                                                      pb_identifier_t* identifier,
+                                                      const pb_identifierI* identifierI)
+{
+    svf10_identifier_sync_t* sync;
+
+    if (!database || !identifier)
+        return 0;
+    sync = (svf10_identifier_sync_t*) calloc(1, sizeof(*sync));
+    if (!sync)
+        return 0;
+    sync->session = session;
+    sync->database = database;
+    sync->identifier = pb_identifier_retain(identifier);
+    sync->svf10 = identifierI == &svf10_identifier;
+    pthread_mutex_init(&sync->lock, 0);
+    pthread_cond_init(&sync->work_cond, 0);
+    pthread_cond_init(&sync->done_cond, 0);
+
+    if (database->register_listener(session, listener, sync) != PB_RC_OK) {
+        svf10_identifier_sync_delete(sync);
+        return 0;
+    }
+    if (load(sync) != PB_RC_OK
+        || pthread_create(&sync->thread, 0, sync_main, sync) != 0) {
+        svf10_identifier_sync_delete(sync);
+        return 0;
+    }
+    sync->started = 1;
+    return sync;
+}
+
+void svf10_identifier_sync_delete(svf10_identifier_sync_t* sync)
+{
+    if (!sync)
+        return;
+    sync->database->unregister_listener(sync->session, listener);
+    if (sync->started) {
+        pthread_mutex_lock(&sync->lock);
+        sync->exit = 1;
+        pthread_cond_signal(&sync->work_cond);
+        pthread_mutex_unlock(&sync->lock);
+        pthread_join(sync->thread, 0);
+    }
+    for (int i = 0; i < sync->nqueued; i++)
+        release_change(&sync->queue[i]);
+    free(sync->queue);
+    pb_identifier_delete(sync->identifier);
+    pthread_cond_destroy(&sync->done_cond);
+    pthread_cond_destroy(&sync->work_cond);
+    pthread_mutex_destroy(&sync->lock);
+    free(sync);
+}
+
+pb_rc_t svf10_identifier_sync_flush(svf10_identifier_sync_t* sync)
+{
+    uint32_t received;
+    pb_rc_t rc;
+
+    if (!sync)
+        return PB_RC_INVALID_PARAMETER;
+    pthread_mutex_lock(&sync->lock);
+    received = sync->received;
+    while ((int32_t) (sync->applied - received) < 0)
+        pthread_cond_wait(&sync->done_cond, &sync->lock);
+    rc = sync->error;
+    sync->error = PB_RC_OK;
+    pthread_mutex_unlock(&sync->lock);
+    return rc;
+}
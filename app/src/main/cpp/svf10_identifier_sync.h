@@ -0,0 +1,66 @@
+/*
+ * SVF10 identifier synchronizer.
+ *
+ * Keeps an identifier's gallery in step with a database. The
+ * synchronizer fills the identifier with the templates in the database,
+ * then listens for the database's insert and delete events and applies
+ * them to the identifier on a thread of its own, so an enrollment does
+ * not wait for the identifier and the identifier is never rebuilt.
+ *
+ * Events that arrive while a batch is being applied are queued and
+ * coalesced by finger, a finger being a user, position and acquisition
+ * as the database keys it: of several changes to one finger only the
+ * last is applied. The next batch then goes to the identifier in one call to
+ * svf10_identifier_update() for svf10_identifier, which identification
+ * sees as a single change. Other identifiers get
+ * pb_identifier_remove_templates() followed by
+ * pb_identifier_add_templates(), between which a replaced finger is
+ * briefly missing.
+ *
+ *   sync = svf10_identifier_sync_create(session, &svf10_database,
+ *                                       identifier, &svf10_identifier);
+ *   ... enroll, identify ...
+ *   svf10_identifier_sync_delete(sync);
+ */
+
+#ifndef SVF10_IDENTIFIER_SYNC_H
+#define SVF10_IDENTIFIER_SYNC_H
+
+#include "pb_databaseI.h"
+#include "pb_identifierI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct svf10_identifier_sync_st svf10_identifier_sync_t;
+
+/** Starts synchronizing identifier, created from the module identifierI,
+  * with database, whose session must have started. The identifier should
+  * start empty. A database unregisters listeners by function only, so
+  * there can be one synchronizer per database.
+  *
+  * @return the synchronizer, or 0 if the database could not be read or
+  *         the thread not started. */
+svf10_identifier_sync_t* svf10_identifier_sync_create(pb_session_t* session,
+                                                      const pb_databaseI* database,
+                                                      pb_identifier_t* identifier,
+                                                      const pb_identifierI* identifierI);
+
+/** Stops listening, applies the changes still queued and deletes the
+  * synchronizer. Call before the database session ends, with no insert or
+  * delete running on the database. */
+void svf10_identifier_sync_delete(svf10_identifier_sync_t* sync);
+
+/** Waits until every database change made before the call is in the
+  * identifier.
+  *
+  * @return PB_RC_OK, or the first error applying a change since the last
+  *         call. A change that failed is not retried. */
+pb_rc_t svf10_identifier_sync_flush(svf10_identifier_sync_t* sync);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_IDENTIFIER_SYNC_H */
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "svf10_image_pool.h"
+
+#define POOL_ALIGN 64
+
+struct svf10_image_pool_st {
+    pthread_mutex_t lock;
+    svf10_image_buffer_t* free_list;
+    int nbuffers;
+    int available;
+    int deleted;
+    svf10_image_buffer_t* buffers;
+    void* memory;
+};
+
+static void pool_free(svf10_image_pool_t* pool)
+{
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->memory);
+    free(pool->buffers);
+    free(pool);
+}
+
+svf10_image_pool_t* svf10_image_pool_create(int nbuffers)
+{
+    svf10_image_pool_t* pool;
+    uint8_t* pixels;
+
+    if (nbuffers <= 0)
+        return 0;
+    pool = (svf10_image_pool_t*) calloc(1, sizeof(*pool));
+    if (!pool)
+        return 0;
+    pool->buffers = (svf10_image_buffer_t*) calloc(nbuffers, sizeof(*pool->buffers));
+    /* SVF10_IMAGE_SIZE is a multiple of POOL_ALIGN, so every buffer of the
+     * block is aligned. */
+    if (!pool->buffers || posix_memalign(&pool->memory, POOL_ALIGN, (size_t) nbuffers * SVF10_IMAGE_SIZE) != 0) {
+        free(pool->buffers);
+        free(pool);
+        return 0;
+    }
+    pthread_mutex_init(&pool->lock, 0);
+
+    pixels = (uint8_t*) pool->memory;
+    for (int i = nbuffers - 1; i >= 0; i--) {
+        pool->buffers[i].pixels = pixels + i * SVF10_IMAGE_SIZE;
+        pool->buffers[i].pool = pool;
+        pool->buffers[i].next = pool->free_list;
+        pool->free_list = &pool->buffers[i];
+    }
+    pool->nbuffers = nbuffers;
+    pool->available = nbuffers;
+    return pool;
+}
+
+void svf10_image_pool_delete(svf10_image_pool_t* pool)
+{
+    int idle;
+
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->deleted = 1;
+    idle = pool->available == pool->nbuffers;
+    pthread_mutex_unlock(&pool->lock);
+    if (idle)
+        pool_free(pool);
+}
+
+svf10_image_buffer_t* svf10_image_pool_get(svf10_image_pool_t* pool)
+{
+    svf10_image_buffer_t* buffer;
+
+    pthread_mutex_lock(&pool->lock);
+    buffer = pool->free_list;
+    if (buffer) {
+        pool->free_list = buffer->next;
+        pool->available--;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return buffer;
+}
+
+void svf10_image_pool_put(void* object)
+{
+    svf10_image_buffer_t* buffer = (svf10_image_buffer_t*) object;
+    svf10_image_pool_t* pool;
+    int release;
+
+    if (!buffer)
+        return;
+    pool = buffer->pool;
+    pthread_mutex_lock(&pool->lock);
+    buffer->next = pool->free_list;
+    pool->free_list = buffer;
+    pool->available++;
+    release = pool->deleted && pool->available == pool->nbuffers;
+    pthread_mutex_unlock(&pool->lock);
+    if (release)
+        pool_free(pool);
+}
+
+int svf10_image_pool_available(svf10_image_pool_t* pool)
+{
+    int available;
+
+    pthread_mutex_lock(&pool->lock);
+    available = pool->available;
+    pthread_mutex_unlock(&pool->lock);
+    return available;
+}
@@ -0,0 +1,57 @@
+/*
+ * SVF10 image buffer pool.
+ *
+ * A fixed set of packed 96x96 pixel buffers, the layout pb_image_t uses,
+ * allocated once. A buffer taken from the pool can be wrapped with
+ * pb_image_create_mre() passing svf10_image_pool_put and the buffer as
+ * mr_release and mr_release_obj; BMF then hands it back when it drops its
+ * last reference, so a frame reaches the extractor without a malloc or a
+ * copy of its pixels.
+ */
+
+#ifndef SVF10_IMAGE_POOL_H
+#define SVF10_IMAGE_POOL_H
+
+#include <stdint.h>
+#include "svf10_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct svf10_image_pool_st svf10_image_pool_t;
+
+/** A buffer of the pool. */
+typedef struct svf10_image_buffer_st {
+    /** SVF10_IMAGE_SIZE pixels, row after row, 64-byte aligned. */
+    uint8_t* pixels;
+    svf10_image_pool_t* pool;
+    struct svf10_image_buffer_st* next;
+} svf10_image_buffer_t;
+
+/** Creates a pool of nbuffers buffers.
+  *
+  * @return the pool, or 0 if out of memory. */
+svf10_image_pool_t* svf10_image_pool_create(int nbuffers);
+
+/** Deletes the pool. Buffers still taken stay valid; the memory is freed
+  * when the last of them is put back. */
+void svf10_image_pool_delete(svf10_image_pool_t* pool);
+
+/** Takes a buffer. Thread safe.
+  *
+  * @return the buffer, or 0 if all are taken. */
+svf10_image_buffer_t* svf10_image_pool_get(svf10_image_pool_t* pool);
+
+/** Puts a buffer back into its pool. Thread safe; the signature is that of
+  * pb_memref_release_fn_t. Putting back 0 has no effect. */
+void svf10_image_pool_put(void* buffer);
+
+/** Returns the number of buffers not taken. */
+int svf10_image_pool_available(svf10_image_pool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_IMAGE_POOL_H */
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+#include "svf10_imagemem.h"
+
+struct svf10_imagemem_st {
+    /* A frame in memory, or 0 when streaming from device. */
+    const uint8_t* frame;
+    Svf10Device* device;
+    /* Frame bytes clocked out so far, and the last chunk of them. */
+    uint32_t position;
+    uint32_t chunk_start;
+    uint32_t chunk_len;
+    bool streaming;
+    uint8_t chunk[SVF10_IMAGEMEM_CHUNK];
+};
+
+svf10_imagemem_t* svf10_imagemem_open_frame(const uint8_t* frame)
+{
+    svf10_imagemem_t* mem;
+
+    mem = (svf10_imagemem_t*) calloc(1, sizeof(*mem));
+    if (mem)
+        mem->frame = frame;
+    return mem;
+}
+
+svf10_imagemem_t* svf10_imagemem_open_device(Svf10Device* device)
+{
+    svf10_imagemem_t* mem;
+
+    mem = (svf10_imagemem_t*) calloc(1, sizeof(*mem));
+    if (!mem)
+        return 0;
+    mem->device = device;
+    if (device->begin_stream_mode0() < 0) {
+        /* The command may have been sent before the failure. The open
+         * fails either way, and a deselect that fails too leaves nothing
+         * more to undo, so its result is not checked. */
+        device->end_stream_mode0();
+        free(mem);
+        return 0;
+    }
+    mem->streaming = true;
+    return mem;
+}
+
+/* Makes the chunk hold frame byte at, reading forward as far as needed.
+ * Returns 0, or -1 if the byte went by already or a read failed. */
+static int stream_to(svf10_imagemem_t* mem, uint32_t at)
+{
+    uint32_t len;
+
+    if (at < mem->chunk_start)
+        return -1;
+    while (at >= mem->chunk_start + mem->chunk_len) {
+        len = SVF10_FRAME_SIZE - mem->position;
+        if (len > SVF10_IMAGEMEM_CHUNK)
+            len = SVF10_IMAGEMEM_CHUNK;
+        if (len == 0 || mem->device->read_stream_mode0(mem->chunk, len) < 0)
+            return -1;
+        mem->chunk_start = mem->position;
+        mem->chunk_len = len;
+        mem->position += len;
+    }
+    return 0;
+}
+
+static pb_rc_t imagemem_read_pixels(void* handle, uint8_t* dest, uint32_t offset, uint32_t npixels)
+{
+    svf10_imagemem_t* mem = (svf10_imagemem_t*) handle;
+    uint32_t at, run, n;
+
+    if (!mem || !dest || offset > SVF10_IMAGE_SIZE || npixels > SVF10_IMAGE_SIZE - offset)
+        return PB_RC_INVALID_PARAMETER;
+
+    while (npixels) {
+        /* One row at a time, skipping the padding between rows. */
+        at = SVF10_FRAME_HEADER + offset / SVF10_IMAGE_WIDTH * SVF10_FRAME_STRIDE
+             + offset % SVF10_IMAGE_WIDTH;
+        run = SVF10_IMAGE_WIDTH - offset % SVF10_IMAGE_WIDTH;
+        if (run > npixels)
+            run = npixels;
+
+        if (mem->frame) {
+            memcpy(dest, mem->frame + at, run);
+            n = run;
+        } else {
+            if (stream_to(mem, at) < 0)
+                return at < mem->chunk_start ? PB_RC_NOT_SUPPORTED : PB_RC_READER_NOT_AVAILABLE;
+            n = mem->chunk_start + mem->chunk_len - at;
+            if (n > run)
+                n = run;
+            memcpy(dest, mem->chunk + (at - mem->chunk_start), n);
+        }
+        dest += n;
+        offset += n;
+        npixels -= n;
+    }
+    return PB_RC_OK;
+}
+
+static pb_rc_t imagemem_close(void* handle)
+{
+    svf10_imagemem_t* mem = (svf10_imagemem_t*) handle;
+    pb_rc_t rc = PB_RC_OK;
+
+    if (!mem)
+        return PB_RC_INVALID_PARAMETER;
+    /* If chip select could not be released the sensor is still streaming,
+     * and the next command to it would be read as part of the frame. */
+    if (mem->streaming && mem->device->end_stream_mode0() < 0)
+        rc = PB_RC_READER_NOT_AVAILABLE;
+    free(mem);
+    return rc;
+}
+
+pbif_const pb_imagememI svf10_imagemem = {
+    imagemem_read_pixels,
+    imagemem_close
+};
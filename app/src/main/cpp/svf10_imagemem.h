@@ -0,0 +1,54 @@
+/*
+ * SVF10 image memory.
+ *
+ * A pb_imagememI that serves the pixels of a pb_image_renderer_create()
+ * image straight from an SVF10 frame, so the frame is never repacked into
+ * a second full-size buffer. The source is either a frame already read, in
+ * the layout read_frame_mode0() returns (header and row padding are
+ * skipped as pixels are read), or the sensor itself: a mode 0 readout
+ * streamed over SPI as the renderer asks for pixels, with one chunk of it
+ * resident at a time.
+ *
+ *   handle = svf10_imagemem_open_device(&device);
+ *   image = pb_image_renderer_create(&svf10_imagemem, handle,
+ *                                    SVF10_IMAGE_WIDTH, SVF10_IMAGE_HEIGHT,
+ *                                    SVF10_RESOLUTION_DPI, 0, &result);
+ */
+
+#ifndef SVF10_IMAGEMEM_H
+#define SVF10_IMAGEMEM_H
+
+#include <stdint.h>
+#include "pb_image_renderer.h"
+#include "svf10_device.h"
+
+/** Frame bytes a streamed readout holds at once, eight rows. */
+#define SVF10_IMAGEMEM_CHUNK     (8 * SVF10_FRAME_STRIDE)
+
+/** The SVF10 image memory. Handles come from the open functions below and
+  * are freed by close(). close() of a streamed handle returns
+  * PB_RC_READER_NOT_AVAILABLE if chip select could not be released; the
+  * handle is freed all the same. */
+extern pbif_const pb_imagememI svf10_imagemem;
+
+typedef struct svf10_imagemem_st svf10_imagemem_t;
+
+/** Opens a frame in memory. The frame is not copied and must stay valid
+  * until close().
+  *
+  * @return the handle, or 0 if out of memory. */
+svf10_imagemem_t* svf10_imagemem_open_frame(const uint8_t* frame);
+
+/** Starts streaming the frame the sensor holds, as read_frame_mode0()
+  * would read it: the capture must have finished (svf10_capture_ready).
+  * Chip select stays asserted until close(), so nothing else may use the
+  * device in between; hold its lock for the lifetime of the image.
+  *
+  * The readout only moves forward. read_pixels() skips over pixels not
+  * asked for, and fails with PB_RC_NOT_SUPPORTED for pixels before the
+  * chunk it holds, so the renderer has to ask for rows in order.
+  *
+  * @return the handle, or 0 if out of memory or the read command failed. */
+svf10_imagemem_t* svf10_imagemem_open_device(Svf10Device* device);
+
+#endif /* SVF10_IMAGEMEM_H */
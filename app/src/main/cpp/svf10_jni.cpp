@@ -0,0 +1,332 @@
+#include <string>
+#include <unistd.h>
+#include <android/bitmap.h>
+#include <android/log.h>
+#include "svf10_jni.h"
+#include "svf10_pipeline.h"
+#include "svf10_convert.h"
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define SVF_DISPLAY_THRESHOLD   svf10_resister_frame[SVF10_REG_DISPLAY_THRESHOLD]
+
+Svf10Device svf10_device;
+
+uint8_t svf10_chip_id[8];
+uint8_t svf10_status_buffer[8];
+uint8_t svf10_resister_frame[SVF10_REG_COUNT];
+
+/* Preprocessing pipelines ---------------------------------------------------*/
+
+static const svf10_stage_t fp_loop_stages[] = {
+    SVF10_STAGE_BLOCKS, SVF10_STAGE_BOX4, SVF10_STAGE_HIST_EQ
+};
+static const svf10_stage_t fp_temp_stages[] = {
+    SVF10_STAGE_BOX3, SVF10_STAGE_STATS
+};
+
+/* Runs fp_loop_stages on every frame. */
+Svf10Capture fp_capture(svf10_device);
+
+pthread_mutex_t svf10_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t svf10_context_key;
+
+static void svf10_context_release(void* ctx)
+{
+    svf10_context_delete((svf10_context_t*) ctx);
+}
+
+svf10_context_t* svf10_thread_context(void)
+{
+    svf10_context_t* ctx = (svf10_context_t*) pthread_getspecific(svf10_context_key);
+
+    if (!ctx) {
+        ctx = svf10_context_create();
+        if (ctx && pthread_setspecific(svf10_context_key, ctx) != 0) {
+            svf10_context_delete(ctx);
+            ctx = 0;
+        }
+    }
+    return ctx;
+}
+
+/* JNI handles, looked up once in svf10_jni_load -----------------------------*/
+
+static jclass bitmap_class;
+static jmethodID bitmap_create;
+static jmethodID bitmap_is_mutable;
+static jobject bitmap_config_argb_8888;
+
+int svf10_jni_load(JNIEnv* env)
+{
+    jclass cls;
+    jfieldID field;
+
+    if (pthread_key_create(&svf10_context_key, svf10_context_release) != 0)
+        return -1;
+
+    cls = env->FindClass("android/graphics/Bitmap");
+    if (!cls)
+        return -1;
+    bitmap_class = (jclass) env->NewGlobalRef(cls);
+    bitmap_create = env->GetStaticMethodID(cls, "createBitmap", "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
+    bitmap_is_mutable = env->GetMethodID(cls, "isMutable", "()Z");
+
+    cls = env->FindClass("android/graphics/Bitmap$Config");
+    if (!cls || !bitmap_create || !bitmap_is_mutable)
+        return -1;
+    field = env->GetStaticFieldID(cls, "ARGB_8888", "Landroid/graphics/Bitmap$Config;");
+    if (!field)
+        return -1;
+    bitmap_config_argb_8888 = env->NewGlobalRef(env->GetStaticObjectField(cls, field));
+    return 0;
+}
+
+/* Opens the device on first use. Call with svf10_lock held. */
+static int svf10_device_open(void)
+{
+    if (!svf10_device.is_open()) {
+        if (svf10_device.open(SVF10_JNI_DEVICE, SVF10_JNI_SPEED_HZ) < 0)
+            return -1;
+        svf10_device.set_registers(svf10_resister_frame);
+    }
+    return 0;
+}
+
+/* Arms the sensor, waits until it reports the exposure done and reads a mode 0 frame into
+ * ctx->raw. Call with svf10_lock held. */
+static int svf10_capture(svf10_context_t* ctx)
+{
+    uint32_t ready_us;
+    int ready;
+
+    if (svf10_device_open() < 0)
+        return -1;
+    if (svf10_device.arm_capture(svf10_status_buffer) < 0)
+        return -1;
+    ready = svf10_device.wait_ready(&svf10_capture_ready, SVF10_CAPTURE_TIMEOUT_US,
+                                    svf10_status_buffer, &ready_us);
+    if (ready > 0)
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "capture ready after %u us", ready_us);
+    else
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "capture not ready after %u us", ready_us);
+    if (ready < 0 && ready_us < SVF10_CAPTURE_TIMEOUT_US)
+        usleep(SVF10_CAPTURE_TIMEOUT_US - ready_us);
+    return svf10_device.read_frame_mode0(ctx->raw);
+}
+
+/* Returns the next raw frame: the latest frame of the capture thread while
+ * it runs, otherwise a synchronous capture into ctx->raw. Returns 0 on
+ * failure. When *frame is set on return the caller holds the frame and
+ * svf10_lock; release both with svf10_release_frame().
+ *
+ * While the capture thread runs this waits up to two exposures for it to
+ * publish a frame, taking svf10_lock only to look at the ring, so other
+ * consumers and SpiOpen are not kept off the lock while it waits. */
+static const uint8_t* svf10_next_frame(svf10_context_t* ctx, const svf10_frame_t** frame)
+{
+    int ret;
+
+    *frame = 0;
+    for (int waited = 0; ; waited += 1000) {
+        pthread_mutex_lock(&svf10_lock);
+        if (!fp_capture.is_running())
+            break;
+        *frame = fp_capture.begin_read_latest();
+        if (*frame) {
+            __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "frame %u ready after %u us, processed %u us after readout",
+                                (*frame)->sequence, (*frame)->ready_us, (*frame)->process_us);
+            return (*frame)->raw;
+        }
+        pthread_mutex_unlock(&svf10_lock);
+        if (waited >= 2 * SVF10_CAPTURE_TIMEOUT_US)
+            return 0;
+        usleep(1000);
+    }
+
+    ret = svf10_capture(ctx);
+    pthread_mutex_unlock(&svf10_lock);
+    return ret < 0 ? 0 : ctx->raw;
+}
+
+void svf10_release_frame(const svf10_frame_t* frame)
+{
+    if (frame) {
+        fp_capture.end_read();
+        pthread_mutex_unlock(&svf10_lock);
+    }
+}
+
+const uint8_t* svf10_next_image(svf10_context_t* ctx, const svf10_frame_t** frame)
+{
+    const uint8_t* raw = svf10_next_frame(ctx, frame);
+
+    if (!raw)
+        return 0;
+    if (*frame) {
+        ctx->stats = (*frame)->stats;
+        ctx->coverage = (*frame)->coverage;
+        return (*frame)->image;
+    }
+
+    if (!ctx->display)
+        ctx->display = svf10_pipeline_create(fp_loop_stages, ARRAY_SIZE(fp_loop_stages));
+    if (!ctx->display)
+        return 0;
+    svf10_pipeline_set_gate(ctx->display, SVF_DISPLAY_THRESHOLD);
+    svf10_pipeline_run(ctx->display, raw, ctx->image, SVF10_IMAGE_WIDTH, &ctx->stats);
+    ctx->coverage = *svf10_pipeline_coverage(ctx->display);
+    return ctx->image;
+}
+
+jobject svf10_deliver_bitmap(JNIEnv* env, jobject bitmap, const uint8_t* image)
+{
+    AndroidBitmapInfo info;
+    void* pixels;
+    int ret;
+
+    if (!bitmap || AndroidBitmap_getInfo(env, bitmap, &info) < 0 ||
+        info.width != SVF10_IMAGE_WIDTH || info.height != SVF10_IMAGE_HEIGHT ||
+        (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 && info.format != ANDROID_BITMAP_FORMAT_A_8) ||
+        !env->CallBooleanMethod(bitmap, bitmap_is_mutable)) {
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "creating new bitmap...");
+        bitmap = env->CallStaticObjectMethod(bitmap_class, bitmap_create,
+                                             SVF10_IMAGE_WIDTH, SVF10_IMAGE_HEIGHT,
+                                             bitmap_config_argb_8888);
+        if (!bitmap || AndroidBitmap_getInfo(env, bitmap, &info) < 0)
+            return NULL;
+    }
+
+    if ((ret = AndroidBitmap_lockPixels(env, bitmap, &pixels)) < 0) {
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "AndroidBitmap_lockPixels() failed ! error=%d", ret);
+        return NULL;
+    }
+    if (info.format == ANDROID_BITMAP_FORMAT_A_8)
+        svf10_convert_image_to_grey((uint8_t*) pixels, info.stride, image, SVF10_IMAGE_WIDTH);
+    else
+        svf10_convert_image_to_rgba((uint8_t*) pixels, info.stride, image, SVF10_IMAGE_WIDTH);
+    AndroidBitmap_unlockPixels(env, bitmap);
+    return bitmap;
+}
+
+jstring svf10_jni_spi_open(JNIEnv* env, const int registers[SVF10_JNI_REGISTERS])
+{
+    svf10_context_t* ctx = svf10_thread_context();
+    int ret = 0;
+    uint32_t ready_us;
+    std::string hello;
+
+    if (!ctx) {
+        hello = "out of memory\n";
+        return env->NewStringUTF(hello.c_str());
+    }
+
+    /* The power-up sequence needs the bus to itself. */
+    pthread_mutex_lock(&svf10_lock);
+    fp_capture.stop();
+
+    if (svf10_device.open(SVF10_JNI_DEVICE, SVF10_JNI_SPEED_HZ) < 0) {
+        pthread_mutex_unlock(&svf10_lock);
+        hello = "can't open device\n";
+        return env->NewStringUTF(hello.c_str());
+    }
+
+    for (ret = SVF10_REG_DLY2X_OSC; ret <= SVF10_REG_ADC_REF; ret++)
+        svf10_resister_frame[ret] = (uint8_t) registers[ret];
+    svf10_resister_frame[SVF10_REG_GPB] = 0xf0;
+    SVF_DISPLAY_THRESHOLD = (uint8_t) registers[SVF10_JNI_REGISTERS - 1];
+
+    svf10_device.set_registers(svf10_resister_frame);
+    if (svf10_device.initialize(svf10_chip_id, svf10_status_buffer, ctx->raw) < 0) {
+        pthread_mutex_unlock(&svf10_lock);
+        hello = "Error ioctl";
+        return env->NewStringUTF(hello.c_str());
+    }
+    for (ret = 0; ret < ARRAY_SIZE(svf10_chip_id); ret++)
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "%.2X,[%c] ", svf10_chip_id[ret], svf10_chip_id[ret]);
+
+    hello = "Chip_ID_READ_SUCCESS\n";
+    hello += "SVF10_Sreg_Set_SUCCESS\n";
+    hello += "SVF10_Sreg_Read_Creg_Set_SUCCESS\n";
+    hello += "SVF10_Memory_Read_Mode5_SUCCESS\n";
+    hello += "SVF10_Sreg_Set_SUCCESS\n";
+    hello += "SVF10_Capture_Offset_SUCCESS\n";
+
+    ret = svf10_device.wait_ready(&svf10_offset_ready, SVF10_OFFSET_TIMEOUT_US,
+                                  svf10_status_buffer, &ready_us);
+    if (ret > 0)
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "offset ready after %u us", ready_us);
+    else
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "offset not ready after %u us", ready_us);
+    if (ret < 0 && ready_us < SVF10_OFFSET_TIMEOUT_US)
+        usleep(SVF10_OFFSET_TIMEOUT_US - ready_us);
+    pthread_mutex_unlock(&svf10_lock);
+
+    return env->NewStringUTF(hello.c_str());
+}
+
+int svf10_jni_get_temp(void)
+{
+    svf10_context_t* ctx = svf10_thread_context();
+    const svf10_frame_t* frame;
+    const uint8_t* raw;
+
+    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "Call FPgetTemp2 Success!");
+    if (!ctx)
+        return 0;
+    raw = svf10_next_frame(ctx, &frame);
+    if (!raw) {
+        __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "capture failed");
+        raw = ctx->raw;
+    }
+    if (!ctx->quality)
+        ctx->quality = svf10_pipeline_create(fp_temp_stages, ARRAY_SIZE(fp_temp_stages));
+    if (ctx->quality)
+        svf10_pipeline_run(ctx->quality, raw, ctx->image, SVF10_IMAGE_WIDTH, &ctx->stats);
+    svf10_release_frame(frame);
+
+    __android_log_print(ANDROID_LOG_INFO, "ShinJAE", "Return FPgetTemp2 Success!");
+    return (int)ctx->stats.variance*100;
+}
+
+int svf10_jni_start_capture(void)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&svf10_lock);
+    if (svf10_device_open() == 0) {
+        fp_capture.set_slice_rows(SVF10_CAPTURE_SLICE_ROWS);
+        ret = fp_capture.start(fp_loop_stages, ARRAY_SIZE(fp_loop_stages), SVF_DISPLAY_THRESHOLD);
+    }
+    pthread_mutex_unlock(&svf10_lock);
+    return ret;
+}
+
+void svf10_jni_stop_capture(void)
+{
+    pthread_mutex_lock(&svf10_lock);
+    fp_capture.stop();
+    pthread_mutex_unlock(&svf10_lock);
+}
+
+int svf10_jni_get_frame(JNIEnv* env, jobject buffer)
+{
+    svf10_context_t* ctx = svf10_thread_context();
+    const svf10_frame_t* frame;
+    const uint8_t* image;
+    uint8_t* dst;
+    int sequence;
+
+    /* 8-bit grey, row after row, straight into the Java buffer. */
+    dst = (uint8_t*) env->GetDirectBufferAddress(buffer);
+    if (!ctx || !dst || env->GetDirectBufferCapacity(buffer) < SVF10_IMAGE_SIZE)
+        return -1;
+
+    image = svf10_next_image(ctx, &frame);
+    if (!image)
+        return -1;
+    svf10_convert_image_to_grey(dst, SVF10_IMAGE_WIDTH, image, SVF10_IMAGE_WIDTH);
+    sequence = frame ? (int) frame->sequence : 0;
+    svf10_release_frame(frame);
+    return sequence;
+}
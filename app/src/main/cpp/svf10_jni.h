@@ -0,0 +1,93 @@
+/*
+ * SVF10 JNI plumbing.
+ *
+ * The sensor session, the capture engine and the per-thread contexts
+ * behind the native methods MainActivity (native-lib) and SenvisService
+ * (native-lib2) share. The same source is compiled into both libraries,
+ * so each library still has a session of its own; only the JNI exports,
+ * whose names carry the Java class, are written out in each library, as
+ * one-line calls into the svf10_jni_* functions here.
+ *
+ *   JNI_OnLoad:      if (svf10_jni_load(env) < 0) return JNI_ERR;
+ *   FPStartCapture:  return svf10_jni_start_capture();
+ */
+
+#ifndef SVF10_JNI_H
+#define SVF10_JNI_H
+
+#include <jni.h>
+#include <pthread.h>
+#include "svf10_device.h"
+#include "svf10_capture.h"
+#include "svf10_context.h"
+
+/** The sensor's spidev node and clock. */
+#define SVF10_JNI_DEVICE   "/dev/spidev1.0"
+#define SVF10_JNI_SPEED_HZ 100000
+
+/** Registers SpiOpen takes from Java, SVF10_REG_DLY2X_OSC to
+  * SVF10_REG_ADC_REF and then SVF10_REG_DISPLAY_THRESHOLD. */
+#define SVF10_JNI_REGISTERS 14
+
+/** The sensor session, opened once and kept for the life of the library. */
+extern Svf10Device svf10_device;
+
+/** Background capture engine on svf10_device. */
+extern Svf10Capture fp_capture;
+
+/** Serializes the sensor session, the reading side of fp_capture's ring
+  * and the buffers below between threads. */
+extern pthread_mutex_t svf10_lock;
+
+extern uint8_t svf10_chip_id[8];
+extern uint8_t svf10_status_buffer[8];
+extern uint8_t svf10_resister_frame[SVF10_REG_COUNT];
+
+/** Sets up the thread context key and looks up the JNI handles the
+  * functions below need. Call from JNI_OnLoad.
+  *
+  * @return 0, or -1 if a handle could not be found. */
+int svf10_jni_load(JNIEnv* env);
+
+/** Returns the calling thread's context, creating it on first use, or 0
+  * if out of memory. Frames are processed in it; it is never shared. */
+svf10_context_t* svf10_thread_context(void);
+
+/** Produces the next FPLoop image: the capture thread's output while it
+  * runs, otherwise a synchronous capture run through the display pipeline
+  * in ctx. Returns 0 on failure. When *frame is set on return the image
+  * belongs to it; release it with svf10_release_frame(). */
+const uint8_t* svf10_next_image(svf10_context_t* ctx, const svf10_frame_t** frame);
+
+/** Releases a frame svf10_next_image() returned. frame may be 0. */
+void svf10_release_frame(const svf10_frame_t* frame);
+
+/** Writes a 96x96 image into bitmap when it is a mutable 96x96 RGBA_8888
+  * or ALPHA_8 bitmap, so the caller can hand the same bitmap in for every
+  * frame. Anything else gets a new RGBA_8888 bitmap.
+  *
+  * @return the bitmap written, or NULL. */
+jobject svf10_deliver_bitmap(JNIEnv* env, jobject bitmap, const uint8_t* image);
+
+/** SpiOpen: stops capture, opens the sensor with the given registers,
+  * powers it up and captures the offset.
+  *
+  * @return a status message for the UI. */
+jstring svf10_jni_spi_open(JNIEnv* env, const int registers[SVF10_JNI_REGISTERS]);
+
+/** FPgetTemp2: captures a frame and returns its variance times 100. */
+int svf10_jni_get_temp(void);
+
+/** FPStartCapture: opens the sensor if needed and starts the capture
+  * engine in sliced mode. Returns 0, or -1 on error. */
+int svf10_jni_start_capture(void);
+
+/** FPStopCapture. */
+void svf10_jni_stop_capture(void);
+
+/** FPGetFrame: writes the next image as 8-bit grey into the direct
+  * buffer. Returns the frame's sequence number, 0 for a synchronous
+  * capture, or -1 on error. */
+int svf10_jni_get_frame(JNIEnv* env, jobject buffer);
+
+#endif /* SVF10_JNI_H */
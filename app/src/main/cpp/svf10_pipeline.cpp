@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include "svf10_pipeline.h"
+
+/* A filter stage keeps only the input rows its kernel can still read. */
+#define RING_ROWS SVF10_FILTER_MAX_ROWS
+
+typedef struct {
+    svf10_stage_t type;
+    /* Filter stages: rows read above the output row, total rows read. */
+    int above;
+    int nrows;
+    svf10_filter_row_fn_t* row_fn;
+    /* Rows pushed into / produced by this stage during the current sweep. */
+    int received;
+    int emitted;
+    uint32_t sum;
+    uint32_t sum_sq;
+    uint8_t ring[RING_ROWS][SVF10_FILTER_STRIDE];
+    uint8_t out[SVF10_IMAGE_WIDTH];
+} stage_state_t;
+
+struct svf10_pipeline_st {
+    int nstages;
+    stage_state_t stages[SVF10_PIPELINE_MAX_STAGES];
+    double gate;
+
+    /* State of the current run: the frame, the rows of it the first
+     * sweep has taken and the stages that sweep runs. */
+    const uint8_t* frame;
+    int fed;
+    int first_end;
+    uint8_t* image;
+    int image_stride;
+    int gather_histogram;
+    uint32_t histogram[256];
+    uint8_t lut[256];
+    uint8_t source_row[SVF10_IMAGE_WIDTH];
+    int have_stats;
+    svf10_image_stats_t stats;
+    int have_coverage;
+    svf10_coverage_t coverage;
+    svf10_integral_t integral;
+};
+
+static int clamp_row(int i)
+{
+    if (i < 0)
+        return 0;
+    if (i > SVF10_IMAGE_HEIGHT - 1)
+        return SVF10_IMAGE_HEIGHT - 1;
+    return i;
+}
+
+svf10_pipeline_t* svf10_pipeline_create(const svf10_stage_t* stages, int nstages)
+{
+    svf10_pipeline_t* pipeline;
+    stage_state_t* st;
+    int blocks = 0;
+
+    if (nstages <= 0 || nstages > SVF10_PIPELINE_MAX_STAGES)
+        return 0;
+
+    pipeline = (svf10_pipeline_t*) calloc(1, sizeof(*pipeline));
+    if (!pipeline)
+        return 0;
+
+    pipeline->nstages = nstages;
+    pipeline->gate = -1.0;
+    for (int s = 0; s < nstages; s++) {
+        st = &pipeline->stages[s];
+        st->type = stages[s];
+        switch (stages[s]) {
+            case SVF10_STAGE_STATS:
+            case SVF10_STAGE_HIST_EQ:
+                break;
+            case SVF10_STAGE_BLOCKS:
+                /* The stage shares the pipeline's tables. */
+                if (blocks++) {
+                    free(pipeline);
+                    return 0;
+                }
+                break;
+            case SVF10_STAGE_BOX2:
+                st->above = 1; st->nrows = 2; st->row_fn = svf10_filter_box2_row;
+                break;
+            case SVF10_STAGE_BOX3:
+                st->above = 1; st->nrows = 3; st->row_fn = svf10_filter_box3_row;
+                break;
+            case SVF10_STAGE_BOX4:
+                st->above = 2; st->nrows = 4; st->row_fn = svf10_filter_box4_row;
+                break;
+            case SVF10_STAGE_GAUSSIAN3:
+                st->above = 1; st->nrows = 3; st->row_fn = svf10_filter_gaussian3_row;
+                break;
+            default:
+                free(pipeline);
+                return 0;
+        }
+    }
+    return pipeline;
+}
+
+void svf10_pipeline_delete(svf10_pipeline_t* pipeline)
+{
+    free(pipeline);
+}
+
+void svf10_pipeline_set_gate(svf10_pipeline_t* pipeline, double min_variance)
+{
+    pipeline->gate = min_variance;
+}
+
+static void stats_finish(const stage_state_t* st, svf10_image_stats_t* stats)
+{
+    const double n = SVF10_IMAGE_SIZE;
+
+    stats->sum = st->sum;
+    stats->sum_sq = st->sum_sq;
+    stats->mean = st->sum / n;
+    /* Both products are below 2^53, so the numerator is exact. */
+    stats->variance = ((double) st->sum_sq * n - (double) st->sum * st->sum) / (n * n);
+}
+
+/* Pushes input row index of stage s; stages [s, end) form the current
+ * sweep, anything past end is the output image. */
+static void push_row(svf10_pipeline_t* p, int s, int end, const uint8_t* row, int index)
+{
+    stage_state_t* st;
+    uint8_t* dst;
+    const uint8_t* rows[SVF10_FILTER_MAX_ROWS];
+    int o;
+
+    if (s == end) {
+        dst = p->image + index * p->image_stride;
+        if (dst != row)
+            memcpy(dst, row, SVF10_IMAGE_WIDTH);
+        if (p->gather_histogram)
+            for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+                p->histogram[row[j]]++;
+        return;
+    }
+
+    st = &p->stages[s];
+    if (st->type == SVF10_STAGE_STATS) {
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+            st->sum += row[j];
+            st->sum_sq += row[j] * row[j];
+        }
+        if (index == SVF10_IMAGE_HEIGHT - 1) {
+            stats_finish(st, &p->stats);
+            p->have_stats = 1;
+        }
+        push_row(p, s + 1, end, row, index);
+        return;
+    }
+    if (st->type == SVF10_STAGE_BLOCKS) {
+        svf10_integral_add_row(&p->integral, row);
+        if (index == SVF10_IMAGE_HEIGHT - 1) {
+            svf10_integral_stats(&p->integral, 0, 0, SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH, &p->stats);
+            p->have_stats = 1;
+            svf10_coverage(&p->integral, p->gate < 0.0 ? 0.0 : p->gate,
+                           SVF10_PRESENT_BLOCKS, &p->coverage);
+            p->have_coverage = 1;
+        }
+        push_row(p, s + 1, end, row, index);
+        return;
+    }
+
+    svf10_filter_pad_row(row, st->ring[index % RING_ROWS]);
+    st->received = index + 1;
+
+    /* Emit every output row whose last input row has now arrived; the last
+     * input row also releases the rows that clamp at the bottom edge. */
+    while (st->emitted < SVF10_IMAGE_HEIGHT &&
+           (st->emitted + st->nrows - st->above <= st->received ||
+            st->received == SVF10_IMAGE_HEIGHT)) {
+        o = st->emitted;
+        for (int r = 0; r < st->nrows; r++)
+            rows[r] = st->ring[clamp_row(o - st->above + r) % RING_ROWS] + SVF10_FILTER_PAD;
+        st->row_fn(rows, st->out);
+        st->emitted++;
+        push_row(p, s + 1, end, st->out, o);
+    }
+}
+
+/* Returns the stage that ends the sweep starting at begin: the next
+ * histogram equalization, or nstages. */
+static int sweep_end(const svf10_pipeline_t* p, int begin)
+{
+    int end;
+
+    for (end = begin; end < p->nstages; end++)
+        if (p->stages[end].type == SVF10_STAGE_HIST_EQ)
+            break;
+    return end;
+}
+
+static void sweep_reset(svf10_pipeline_t* p, int begin, int end)
+{
+    for (int s = begin; s < end; s++) {
+        p->stages[s].received = 0;
+        p->stages[s].emitted = 0;
+        p->stages[s].sum = 0;
+        p->stages[s].sum_sq = 0;
+        if (p->stages[s].type == SVF10_STAGE_BLOCKS)
+            svf10_integral_reset(&p->integral);
+    }
+    p->gather_histogram = end < p->nstages;
+    if (p->gather_histogram)
+        memset(p->histogram, 0, sizeof(p->histogram));
+}
+
+void svf10_pipeline_begin(svf10_pipeline_t* pipeline,
+                          const uint8_t* frame,
+                          uint8_t* image,
+                          int image_stride)
+{
+    pipeline->frame = frame;
+    pipeline->fed = 0;
+    pipeline->image = image;
+    pipeline->image_stride = image_stride;
+    pipeline->have_stats = 0;
+    pipeline->have_coverage = 0;
+    pipeline->first_end = sweep_end(pipeline, 0);
+    sweep_reset(pipeline, 0, pipeline->first_end);
+}
+
+void svf10_pipeline_feed(svf10_pipeline_t* pipeline, int rows)
+{
+    const uint8_t* src = SVF10_FRAME_PIXELS(pipeline->frame);
+
+    if (rows > SVF10_IMAGE_HEIGHT)
+        rows = SVF10_IMAGE_HEIGHT;
+    for (int i = pipeline->fed; i < rows; i++)
+        push_row(pipeline, 0, pipeline->first_end, src + i * SVF10_FRAME_STRIDE, i);
+    if (rows > pipeline->fed)
+        pipeline->fed = rows;
+}
+
+int svf10_pipeline_finish(svf10_pipeline_t* pipeline, svf10_image_stats_t* stats)
+{
+    uint8_t* image = pipeline->image;
+    const int image_stride = pipeline->image_stride;
+    int begin, end = pipeline->first_end;
+    const uint8_t* row;
+
+    svf10_pipeline_feed(pipeline, SVF10_IMAGE_HEIGHT);
+
+    /* Histogram equalization: every further sweep reads the output image
+     * back through the lookup table of the one before. */
+    while (end < pipeline->nstages) {
+        svf10_filter_hist_eq_lut(pipeline->histogram, pipeline->lut);
+        begin = end + 1;
+        end = sweep_end(pipeline, begin);
+        sweep_reset(pipeline, begin, end);
+        for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++) {
+            row = image + i * image_stride;
+            for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+                pipeline->source_row[j] = pipeline->lut[row[j]];
+            push_row(pipeline, begin, end, pipeline->source_row, i);
+        }
+    }
+
+    if (stats && pipeline->have_stats)
+        *stats = pipeline->stats;
+
+    if (pipeline->gate >= 0.0 &&
+        (pipeline->have_coverage ? !pipeline->coverage.present :
+         pipeline->have_stats && pipeline->stats.variance <= pipeline->gate)) {
+        for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+            memcpy(image + i * image_stride,
+                   SVF10_FRAME_PIXELS(pipeline->frame) + i * SVF10_FRAME_STRIDE,
+                   SVF10_IMAGE_WIDTH);
+        return 0;
+    }
+    return 1;
+}
+
+int svf10_pipeline_run(svf10_pipeline_t* pipeline,
+                       const uint8_t* frame,
+                       uint8_t* image,
+                       int image_stride,
+                       svf10_image_stats_t* stats)
+{
+    svf10_pipeline_begin(pipeline, frame, image, image_stride);
+    return svf10_pipeline_finish(pipeline, stats);
+}
+
+const svf10_coverage_t* svf10_pipeline_coverage(const svf10_pipeline_t* pipeline)
+{
+    return pipeline->have_coverage ? &pipeline->coverage : 0;
+}
+
+const svf10_integral_t* svf10_pipeline_integral(const svf10_pipeline_t* pipeline)
+{
+    return pipeline->have_coverage ? &pipeline->integral : 0;
+}
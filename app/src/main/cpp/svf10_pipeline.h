@@ -0,0 +1,110 @@
+/*
+ * SVF10 preprocessing pipeline.
+ *
+ * Runs a configurable list of preprocessing stages over a raw SPI frame in a
+ * single sweep. Rows are read once from the strided receive buffer and pushed
+ * through the neighbourhood filters via small per-stage row rings, so the
+ * working set stays a few hundred bytes per stage instead of one full
+ * 96x96 copy per filter. Histogram equalization needs the whole image before
+ * it can map any pixel; it ends the sweep it is in and its lookup table is
+ * applied while the next sweep reads its rows back from the (cache resident)
+ * output image.
+ */
+
+#ifndef SVF10_PIPELINE_H
+#define SVF10_PIPELINE_H
+
+#include <stdint.h>
+#include "svf10_filter.h"
+#include "svf10_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Pipeline stages. */
+typedef enum svf10_stage_e {
+    /** Records mean and variance of the rows passing this point. */
+    SVF10_STAGE_STATS = 0,
+    SVF10_STAGE_BOX2 = 1,
+    SVF10_STAGE_BOX3 = 2,
+    SVF10_STAGE_BOX4 = 3,
+    SVF10_STAGE_GAUSSIAN3 = 4,
+    SVF10_STAGE_HIST_EQ = 5,
+    /** Builds the summed-area tables and block coverage of the rows
+      * passing this point, and records their statistics as STATS does.
+      * A pipeline has at most one BLOCKS stage. */
+    SVF10_STAGE_BLOCKS = 6
+} svf10_stage_t;
+
+#define SVF10_PIPELINE_MAX_STAGES   8
+
+typedef struct svf10_pipeline_st svf10_pipeline_t;
+
+/** Creates a pipeline running the given stages in order.
+  *
+  * @return the pipeline, or 0 if the stage list is empty, too long or
+  *         contains an unknown stage.
+  */
+svf10_pipeline_t* svf10_pipeline_create(const svf10_stage_t* stages, int nstages);
+
+/** Deletes a pipeline. */
+void svf10_pipeline_delete(svf10_pipeline_t* pipeline);
+
+/** Sets a gate: frames that fail it are output unfiltered by
+  * svf10_pipeline_run(). With a BLOCKS stage the gate is finger presence,
+  * at least SVF10_PRESENT_BLOCKS blocks with a variance above
+  * min_variance. Otherwise the variance of the last STATS stage must be
+  * above min_variance; this is the SVF_DISPLAY_THRESHOLD check FPLoop
+  * used to do by hand. A negative value disables the gate, which is the
+  * default; BLOCKS then uses 0. With a gate set, the output image must not
+  * alias the frame. */
+void svf10_pipeline_set_gate(svf10_pipeline_t* pipeline, double min_variance);
+
+/** Runs the pipeline over a raw SPI frame.
+  *
+  * @param[in] frame is the SVF10_FRAME_SIZE byte receive buffer.
+  * @param[out] image receives the 96x96 result. It may be the pixel area
+  *             of frame itself (SVF10_FRAME_PIXELS, SVF10_FRAME_STRIDE).
+  * @param[in] image_stride is the row stride of image.
+  * @param[out] stats receives the statistics of the last STATS stage,
+  *             may be 0.
+  *
+  * @return 1 if the stages were applied, 0 if the gate rejected the frame
+  *         and image holds the unfiltered pixels.
+  */
+int svf10_pipeline_run(svf10_pipeline_t* pipeline,
+                       const uint8_t* frame,
+                       uint8_t* image,
+                       int image_stride,
+                       svf10_image_stats_t* stats);
+
+/** The same run over a frame that is still being received, e.g. in
+  * bursts of rows: begin, then feed as rows arrive, then finish. Each feed
+  * pushes the rows that arrived since the last one through the stages up
+  * to the first HIST_EQ, so only the work after that is left once the
+  * frame is complete. svf10_pipeline_run() is begin and finish.
+  *
+  * svf10_pipeline_feed: rows [0, rows) of frame are valid.
+  * svf10_pipeline_finish: takes any rows not fed yet, and returns as
+  * svf10_pipeline_run() does. */
+void svf10_pipeline_begin(svf10_pipeline_t* pipeline,
+                          const uint8_t* frame,
+                          uint8_t* image,
+                          int image_stride);
+void svf10_pipeline_feed(svf10_pipeline_t* pipeline, int rows);
+int svf10_pipeline_finish(svf10_pipeline_t* pipeline, svf10_image_stats_t* stats);
+
+/** Returns the coverage computed by the BLOCKS stage in the last run, or 0
+  * if there is none. */
+const svf10_coverage_t* svf10_pipeline_coverage(const svf10_pipeline_t* pipeline);
+
+/** Returns the summed-area tables of the last run, or 0 if the pipeline
+  * has no BLOCKS stage or has not run. */
+const svf10_integral_t* svf10_pipeline_integral(const svf10_pipeline_t* pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_PIPELINE_H */
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "svf10_quality.h"
+#include "pb_quality_pb.h"
+#include "pb_image.h"
+
+/* Summed-area tables compute_quality builds the coverage from: 75 kB, too
+ * much for the stack of a JNI thread, so each thread allocates one on its
+ * first call and keeps it until it exits. */
+static pthread_key_t integral_key;
+static pthread_once_t integral_once = PTHREAD_ONCE_INIT;
+static int integral_key_ok;
+
+static void integral_init(void)
+{
+    integral_key_ok = pthread_key_create(&integral_key, free) == 0;
+}
+
+/* Returns the calling thread's tables, or 0 if out of memory. */
+static svf10_integral_t* thread_integral(void)
+{
+    svf10_integral_t* integral;
+
+    pthread_once(&integral_once, integral_init);
+    if (!integral_key_ok)
+        return 0;
+    integral = (svf10_integral_t*) pthread_getspecific(integral_key);
+    if (!integral) {
+        integral = (svf10_integral_t*) malloc(sizeof(*integral));
+        if (integral && pthread_setspecific(integral_key, integral) != 0) {
+            free(integral);
+            integral = 0;
+        }
+    }
+    return integral;
+}
+
+static int is_svf10_image(const pb_image_t* image)
+{
+    return pb_image_get_rows(image) == SVF10_IMAGE_HEIGHT &&
+           pb_image_get_cols(image) == SVF10_IMAGE_WIDTH &&
+           pb_image_get_pixels(image) != 0;
+}
+
+pb_quality_t* svf10_quality_create(const svf10_coverage_t* coverage,
+                                   uint16_t vertical_resolution,
+                                   uint16_t horizontal_resolution)
+{
+    double area = 0.0;
+
+    if (coverage->present) {
+        /* svf10_coverage() measures blocks at the sensor's resolution. */
+        area = coverage->area_mm2;
+        if (vertical_resolution)
+            area = area * SVF10_RESOLUTION_DPI / vertical_resolution;
+        if (horizontal_resolution)
+            area = area * SVF10_RESOLUTION_DPI / horizontal_resolution;
+    }
+    return pb_quality_create(coverage->quality,
+                             (uint16_t) (area > 65535.0 ? 65535 : area + 0.5),
+                             coverage->condition);
+}
+
+static pb_rc_t compute_quality(pb_session_t* session,
+                               pb_image_t* image,
+                               pb_quality_t** quality)
+{
+    svf10_integral_t* integral;
+    svf10_coverage_t coverage;
+
+    if (!image || !quality)
+        return PB_RC_INVALID_PARAMETER;
+    if (!is_svf10_image(image))
+        return pb_quality.compute_quality(session, image, quality);
+
+    integral = thread_integral();
+    if (!integral)
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    svf10_integral_build(integral, pb_image_get_pixels(image), SVF10_IMAGE_WIDTH);
+    svf10_coverage(integral, SVF10_QUALITY_MIN_VARIANCE, SVF10_PRESENT_BLOCKS, &coverage);
+
+    *quality = svf10_quality_create(&coverage,
+                                    pb_image_get_vertical_resolution(image),
+                                    pb_image_get_horizontal_resolution(image));
+    if (!*quality)
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    pb_image_set_quality_values(image, *quality);
+    return PB_RC_OK;
+}
+
+static pb_rc_t finger_stable(pb_session_t* session,
+                             const pb_image_t* previous_image,
+                             const pb_image_t* image,
+                             int* stable)
+{
+    uint32_t sad;
+
+    if (!previous_image || !image || !stable)
+        return PB_RC_INVALID_PARAMETER;
+    if (!is_svf10_image(previous_image) || !is_svf10_image(image))
+        return pb_quality.finger_stable(session, previous_image, image, stable);
+
+    sad = svf10_image_sad(pb_image_get_pixels(previous_image), SVF10_IMAGE_WIDTH,
+                          pb_image_get_pixels(image), SVF10_IMAGE_WIDTH);
+    *stable = sad <= (uint32_t) SVF10_STABLE_MAX_DIFF * SVF10_IMAGE_SIZE;
+    return PB_RC_OK;
+}
+
+pbif_const pb_qualityI svf10_quality = {
+    compute_quality,
+    finger_stable
+};
@@ -0,0 +1,48 @@
+/*
+ * SVF10 quality module.
+ *
+ * A pb_qualityI for 96x96 SVF10 images built on the block statistics of
+ * svf10_stats: compute_quality reads image quality, fingerprint area and
+ * condition off the coverage map, finger_stable compares two captures by
+ * their frame difference. Both take microseconds per frame, so they can run
+ * on every capture of pb_capture_image or multitemplate enrollment.
+ * Images of any other size are handed to BMF's pb_quality.
+ */
+
+#ifndef SVF10_QUALITY_H
+#define SVF10_QUALITY_H
+
+#include "pb_qualityI.h"
+#include "svf10_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Block variance a covered block exceeds, a block standard deviation of
+  * 8 grey levels. Ridges on this sensor are well above it, the background
+  * is well below. */
+#define SVF10_QUALITY_MIN_VARIANCE  64.0
+
+/** Largest mean absolute pixel difference between two captures that
+  * finger_stable still reports as stable. Sensor noise alone stays below
+  * it; a one pixel shift of the ridges is far above it. */
+#define SVF10_STABLE_MAX_DIFF       12
+
+/** The SVF10 quality module. As with pb_quality, the image object is also
+  * tagged with the computed values. */
+extern pbif_const pb_qualityI svf10_quality;
+
+/** Creates the quality object of a coverage computed at the given
+  * resolution, in dpi. The area is 0 unless a finger is present.
+  *
+  * @return the quality object, or 0 if out of memory. */
+pb_quality_t* svf10_quality_create(const svf10_coverage_t* coverage,
+                                   uint16_t vertical_resolution,
+                                   uint16_t horizontal_resolution);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_QUALITY_H */
@@ -0,0 +1,247 @@
+#include <unistd.h>
+#include <atomic>
+#include "svf10_sensor.h"
+#include "svf10_image_pool.h"
+#include "pb_image.h"
+
+/* Poll interval while waiting for the capture engine or a busy reader. */
+#define SVF10_READER_POLL_US     1000
+
+/* Images of synchronous captures BMF may hold at once. */
+#define SVF10_READER_IMAGES      4
+
+/* The module's one reader. device, capture and lock are set before the
+ * session starts; started and cancelled are shared with whichever thread
+ * calls cancel. */
+static struct {
+    Svf10Device* device;
+    Svf10Capture* capture;
+    pthread_mutex_t* lock;
+    pb_reader_t* reader;
+    std::atomic<int> started;
+    std::atomic<int> cancelled;
+    svf10_image_pool_t* pool;
+} svf10_reader;
+
+void svf10_sensor_set_device(Svf10Device* device, Svf10Capture* capture,
+                             pthread_mutex_t* lock)
+{
+    svf10_reader.device = device;
+    svf10_reader.capture = capture;
+    svf10_reader.lock = lock;
+}
+
+static void reader_lock(void)
+{
+    if (svf10_reader.lock)
+        pthread_mutex_lock(svf10_reader.lock);
+}
+
+static void reader_unlock(void)
+{
+    if (svf10_reader.lock)
+        pthread_mutex_unlock(svf10_reader.lock);
+}
+
+static uint64_t elapsed_ms(int64_t since_ns)
+{
+    return (uint64_t) (svf10_monotonic_ns() - since_ns) / 1000000;
+}
+
+/* Takes the image of the next frame: detached from the capture engine's
+ * ring, or read straight into a buffer of the reader's pool. Returns 1 and
+ * sets *buffer if there is one, 0 if the engine or the pool has none yet,
+ * -1 on error. */
+static int reader_next_image(svf10_image_buffer_t** buffer)
+{
+    const svf10_frame_t* frame;
+    uint32_t ready_us;
+    int ready, ret = 1;
+
+    *buffer = 0;
+    reader_lock();
+    if (!svf10_reader.device->is_open()) {
+        ret = -1;
+    } else if (svf10_reader.capture && svf10_reader.capture->is_running()) {
+        frame = svf10_reader.capture->begin_read_latest();
+        if (frame) {
+            *buffer = svf10_reader.capture->detach_image(frame);
+            svf10_reader.capture->end_read();
+        }
+        ret = *buffer ? 1 : 0;
+    } else if (!(*buffer = svf10_image_pool_get(svf10_reader.pool))) {
+        ret = 0;
+    } else if (svf10_reader.device->arm_capture(0) < 0) {
+        ret = -1;
+    } else {
+        /* A failed poll falls back to the full exposure time. */
+        ready = svf10_reader.device->wait_ready(&svf10_capture_ready, SVF10_CAPTURE_TIMEOUT_US,
+                                                0, &ready_us);
+        if (ready < 0 && ready_us < SVF10_CAPTURE_TIMEOUT_US)
+            usleep(SVF10_CAPTURE_TIMEOUT_US - ready_us);
+        if (svf10_reader.device->read_image_mode0((*buffer)->pixels) < 0)
+            ret = -1;
+    }
+    reader_unlock();
+    if (ret < 0) {
+        svf10_image_pool_put(*buffer);
+        *buffer = 0;
+    }
+    return ret;
+}
+
+static pb_rc_t capture_start(pb_reader_t* reader, uint16_t timeout)
+{
+    const int64_t start_ns = svf10_monotonic_ns();
+    int expected;
+
+    (void) reader;
+    if (!svf10_reader.device || !svf10_reader.device->is_open())
+        return PB_RC_READER_NOT_AVAILABLE;
+    for (;;) {
+        expected = 0;
+        if (svf10_reader.started.compare_exchange_strong(expected, 1))
+            return PB_RC_OK;
+        if (elapsed_ms(start_ns) >= timeout)
+            return PB_RC_READER_BUSY;
+        usleep(SVF10_READER_POLL_US);
+    }
+}
+
+static pb_rc_t capture_stop(pb_reader_t* reader)
+{
+    (void) reader;
+    svf10_reader.started.store(0);
+    return PB_RC_OK;
+}
+
+static pb_rc_t capture_image(pb_reader_t* reader,
+                             pb_reader_captureI_callback_fn_t* callback,
+                             void* context,
+                             uint16_t timeout)
+{
+    const int64_t start_ns = svf10_monotonic_ns();
+    svf10_image_buffer_t* buffer;
+    pb_image_t* image;
+    pb_rc_t rc;
+    int ret;
+
+    if (!callback)
+        return PB_RC_INVALID_PARAMETER;
+    if (!svf10_reader.started.load())
+        return PB_RC_NOT_INITIALIZED;
+
+    svf10_reader.cancelled.store(0);
+    while (!svf10_reader.cancelled.load()) {
+        if (timeout && elapsed_ms(start_ns) >= timeout)
+            return PB_RC_TIMED_OUT;
+
+        ret = reader_next_image(&buffer);
+        if (ret < 0)
+            return PB_RC_READER_NOT_AVAILABLE;
+        if (ret == 0) {
+            usleep(SVF10_READER_POLL_US);
+            continue;
+        }
+
+        /* BMF references the buffer and puts it back into its pool with
+         * the last reference to the image. */
+        image = pb_image_create_mre(SVF10_IMAGE_HEIGHT, SVF10_IMAGE_WIDTH,
+                                    pb_reader_get_vertical_resolution(reader),
+                                    pb_reader_get_horizontal_resolution(reader),
+                                    buffer->pixels, PB_IMPRESSION_TYPE_LIVE_SCAN_PLAIN,
+                                    SVF10_IMAGE_SIZE, 0, svf10_image_pool_put, buffer);
+        if (!image) {
+            svf10_image_pool_put(buffer);
+            return PB_RC_MEMORY_ALLOCATION_FAILED;
+        }
+        /* The callback owns the image and may cancel from within. */
+        rc = callback(PB_READER_IMAGE_CAPTURED, image, context);
+        if (rc != PB_RC_OK)
+            return rc;
+    }
+    return PB_RC_OK;
+}
+
+static pb_rc_t capture_cancel(pb_reader_t* reader)
+{
+    (void) reader;
+    svf10_reader.cancelled.store(1);
+    return PB_RC_OK;
+}
+
+static const pb_reader_captureI svf10_reader_capture = {
+    capture_start,
+    capture_stop,
+    capture_image,
+    capture_cancel
+};
+
+static pb_rc_t start_session(pb_session_t* session,
+                             pb_sensorI_plugnplay_callback_fn_t* plugnplay_callback,
+                             void* plugnplay_context)
+{
+    if (svf10_reader.reader)
+        return PB_RC_OK;
+    if (!svf10_reader.device)
+        return PB_RC_READER_NOT_AVAILABLE;
+
+    svf10_reader.pool = svf10_image_pool_create(SVF10_READER_IMAGES);
+    if (!svf10_reader.pool)
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    svf10_reader.reader = pb_reader_create(SVF10_READER_ID, SVF10_READER_NAME, 0,
+                                           SVF10_IMAGE_WIDTH, SVF10_IMAGE_HEIGHT,
+                                           SVF10_RESOLUTION_DPI, SVF10_RESOLUTION_DPI,
+                                           &svf10_reader_capture, 0);
+    if (!svf10_reader.reader) {
+        svf10_image_pool_delete(svf10_reader.pool);
+        svf10_reader.pool = 0;
+        return PB_RC_MEMORY_ALLOCATION_FAILED;
+    }
+    svf10_reader.started.store(0);
+    if (plugnplay_callback)
+        plugnplay_callback(session, svf10_reader.reader, 1, plugnplay_context);
+    return PB_RC_OK;
+}
+
+static pb_rc_t end_session(pb_session_t* session)
+{
+    (void) session;
+    pb_reader_delete(svf10_reader.reader);
+    svf10_reader.reader = 0;
+    /* Images still referenced keep their buffers until released. */
+    svf10_image_pool_delete(svf10_reader.pool);
+    svf10_reader.pool = 0;
+    return PB_RC_OK;
+}
+
+static pb_rc_t get_nbr_of_readers(pb_session_t* session, uint16_t* nbr_of_readers)
+{
+    (void) session;
+    if (!nbr_of_readers)
+        return PB_RC_INVALID_PARAMETER;
+    *nbr_of_readers = svf10_reader.reader ? 1 : 0;
+    return PB_RC_OK;
+}
+
+static pb_rc_t list_readers(pb_session_t* session, pb_reader_t* readers[],
+                            uint16_t* nbr_of_readers)
+{
+    (void) session;
+    if (!readers || !nbr_of_readers)
+        return PB_RC_INVALID_PARAMETER;
+    if (!svf10_reader.reader || *nbr_of_readers == 0) {
+        *nbr_of_readers = 0;
+        return PB_RC_OK;
+    }
+    readers[0] = pb_reader_retain(svf10_reader.reader);
+    *nbr_of_readers = 1;
+    return PB_RC_OK;
+}
+
+pbif_const pb_sensorI svf10_sensor = {
+    start_session,
+    end_session,
+    get_nbr_of_readers,
+    list_readers
+};
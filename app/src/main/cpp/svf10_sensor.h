@@ -0,0 +1,42 @@
+/*
+ * SVF10 sensor module.
+ *
+ * A pb_sensorI with one reader, "Senvis SVF10", whose pb_reader_captureI
+ * captures over the SVF10 SPI protocol, so pb_capture_image,
+ * pb_wait_for_finger_present and multitemplate enrollment drive the sensor
+ * directly. capture_image streams frames to the callback until cancelled or
+ * timed out: the newest frames of the capture engine while it runs, as its
+ * pipeline left them, otherwise raw frames captured synchronously (arm,
+ * poll status, read). Either way the pb_image_t references a pooled buffer
+ * the pixels were decoded into; nothing is allocated or copied per frame.
+ */
+
+#ifndef SVF10_SENSOR_H
+#define SVF10_SENSOR_H
+
+#include <pthread.h>
+#include "pb_sensorI.h"
+#include "svf10_device.h"
+#include "svf10_capture.h"
+
+/** Images are delivered at the sensor's native size and resolution. */
+#define SVF10_READER_NAME        "Senvis SVF10"
+#define SVF10_READER_ID          "svf10-0"
+
+/** The SVF10 sensor module. */
+extern pbif_const pb_sensorI svf10_sensor;
+
+/** Sets what the reader captures from: an open device, the capture engine
+  * running on it (may be 0) and the lock that serializes both between
+  * threads (may be 0 if there is a single user). Call before
+  * start_session; the reader is unavailable until the device is open.
+  *
+  * With the engine running the reader takes its frames from the ring,
+  * reading it under lock like every other consumer.
+  *
+  * capture_image streams until cancelled or until timeout ms have passed;
+  * a timeout of 0 streams until cancelled. */
+void svf10_sensor_set_device(Svf10Device* device, Svf10Capture* capture,
+                             pthread_mutex_t* lock);
+
+#endif /* SVF10_SENSOR_H */
@@ -0,0 +1,304 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "svf10_sim.h"
+#include "svf10_unpack.h"
+
+/* Sensor states, the SLV_SUT_* values native-lib uses. */
+#define SIM_CAP_O   0
+#define SIM_CAP_N   1
+#define SIM_SLEEP   2
+#define SIM_MEM_R   3
+
+/* Bus timing of 100 kHz. The exposure and offset times are the fixed waits
+ * the driver used before it polled the status, an upper bound of both. */
+const svf10_sim_timing_t svf10_sim_timing_device = {
+    0,
+    80000,
+    SVF10_CAPTURE_TIMEOUT_US,
+    SVF10_OFFSET_TIMEOUT_US,
+    1
+};
+
+static const uint8_t default_chip_id[SVF10_CHIP_ID_SIZE] = {
+    0x00, 'S', 'V', 'F', '1', '0', 'P', 0x00
+};
+
+/* Inverse of svf10_unpack_shifted(): what the sensor clocks out for a
+ * register read that unpacks to src. dst and src must not overlap. */
+static void encode_shifted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < n; i++)
+        dst[i] = (uint8_t) (svf10_bit_reverse[src[i]] << 1 | svf10_bit_reverse[src[i + 1]] >> 7);
+    if (n)
+        dst[n - 1] = (uint8_t) (svf10_bit_reverse[src[n - 1]] << 1);
+}
+
+/* Inverse of svf10_unpack_inverted(). dst may be the same buffer as src. */
+static void encode_inverted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = svf10_bit_reverse[255 - src[i]];
+}
+
+static int hex_value(int c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    return (tolower(c) - 'a') + 10;
+}
+
+Svf10Simulator::Svf10Simulator()
+    : frames_(0),
+      count_(0),
+      next_(0),
+      loop_(true),
+      busy_state_(SIM_SLEEP),
+      idle_state_(SIM_SLEEP),
+      busy_until_ns_(0),
+      offset_pending_(false),
+      selected_(CMD_NONE),
+      mode0_frame_(0),
+      mode0_offset_(0),
+      frames_read_(0)
+{
+    memset(&timing_, 0, sizeof(timing_));
+    memcpy(chip_id_, default_chip_id, sizeof(chip_id_));
+}
+
+Svf10Simulator::~Svf10Simulator()
+{
+    free(frames_);
+}
+
+int Svf10Simulator::set_frames(const uint8_t* frames, size_t count)
+{
+    uint8_t* copy = 0;
+
+    if (count) {
+        copy = (uint8_t*) malloc(count * SVF10_FRAME_SIZE);
+        if (!copy)
+            return -1;
+        /* Stored as they go over the wire, so a read is a copy. */
+        encode_inverted(copy, frames, count * SVF10_FRAME_SIZE);
+    }
+    free(frames_);
+    frames_ = copy;
+    count_ = count;
+    next_ = 0;
+    selected_ = CMD_NONE;
+    return 0;
+}
+
+int Svf10Simulator::load_frames(const char* path)
+{
+    FILE* file;
+    uint8_t* data;
+    long size;
+    size_t n, i, len;
+    bool hex = true;
+    int saved, hi = -1;
+
+    file = fopen(path, "rb");
+    if (!file)
+        return -1;
+    if (fseek(file, 0, SEEK_END) < 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) < 0) {
+        saved = errno;
+        fclose(file);
+        errno = saved;
+        return -1;
+    }
+    data = (uint8_t*) malloc(size ? size : 1);
+    if (!data) {
+        fclose(file);
+        errno = ENOMEM;
+        return -1;
+    }
+    n = fread(data, 1, size, file);
+    fclose(file);
+
+    for (i = 0; i < n && hex; i++)
+        hex = isxdigit(data[i]) || isspace(data[i]);
+    if (hex) {
+        /* Packs the hex digits in place, two per byte. */
+        for (i = 0, len = 0; i < n; i++) {
+            if (isspace(data[i]))
+                continue;
+            if (hi < 0) {
+                hi = hex_value(data[i]);
+            } else {
+                data[len++] = (uint8_t) (hi << 4 | hex_value(data[i]));
+                hi = -1;
+            }
+        }
+        /* An odd digit count is not a dump. */
+        n = hi < 0 ? len : 0;
+    }
+
+    if (n == 0 || n % SVF10_FRAME_SIZE) {
+        free(data);
+        errno = EINVAL;
+        return -1;
+    }
+    if (set_frames(data, n / SVF10_FRAME_SIZE) < 0) {
+        free(data);
+        errno = ENOMEM;
+        return -1;
+    }
+    free(data);
+    return (int) count_;
+}
+
+void Svf10Simulator::set_chip_id(const uint8_t* chip_id)
+{
+    memcpy(chip_id_, chip_id, sizeof(chip_id_));
+}
+
+int Svf10Simulator::state()
+{
+    return svf10_monotonic_ns() < busy_until_ns_ ? busy_state_ : idle_state_;
+}
+
+/* Commands are told apart by their second byte. The offset capture is the
+ * only command whose first byte goes out in a transfer of its own. */
+Svf10Simulator::command_e Svf10Simulator::decode(const uint8_t* tx, uint32_t len)
+{
+    uint8_t b0, b1;
+
+    if (len == 1) {
+        offset_pending_ = true;
+        return CMD_OFFSET;
+    }
+    if (offset_pending_) {
+        offset_pending_ = false;
+        return CMD_NONE;
+    }
+    if (len < 2)
+        return CMD_NONE;
+
+    b0 = svf10_bit_reverse[tx[0]];
+    b1 = svf10_bit_reverse[tx[1]];
+    if (b0 == 0x00 && b1 == 0x10)
+        return CMD_CHIP_ID;
+    if (b1 == 0x3e)
+        return CMD_MODE5;
+    if (b1 == 0x30)
+        return CMD_MODE0;
+    /* Control register set and status read both answer with the status. */
+    if ((b1 & 0xf0) == 0x60)
+        return CMD_STATUS;
+    /* Sleep-sense starts the exposure. */
+    if ((b1 & 0xf0) == 0x40)
+        return CMD_ARM;
+    return CMD_NONE;
+}
+
+int Svf10Simulator::reply(command_e command, uint8_t* rx, uint32_t len)
+{
+    uint8_t data[SVF10_CHIP_ID_SIZE + SVF10_STATUS_SIZE];
+    const uint8_t* frame;
+    uint32_t n;
+
+    switch (command) {
+    case CMD_CHIP_ID:
+    case CMD_STATUS:
+        memset(data, 0, sizeof(data));
+        if (command == CMD_CHIP_ID)
+            memcpy(data, chip_id_, sizeof(chip_id_));
+        else
+            data[0] = SVF10_STATUS_STATE(state());
+        n = len < sizeof(data) ? len : sizeof(data);
+        encode_shifted(rx, data, n);
+        memset(rx + n, 0, len - n);
+        return 0;
+
+    case CMD_MODE5:
+        /* An empty offset frame. */
+        memset(rx, 0, len);
+        return 0;
+
+    case CMD_MODE0:
+        /* Continues where the last transfer of the readout stopped; past
+         * the end of the frame the line idles high. */
+        frame = mode0_frame_ + mode0_offset_;
+        n = SVF10_FRAME_SIZE - mode0_offset_;
+        n = len < n ? len : n;
+        memcpy(rx, frame, n);
+        memset(rx + n, 0xff, len - n);
+        mode0_offset_ += n;
+        return 0;
+
+    default:
+        memset(rx, 0, len);
+        return 0;
+    }
+}
+
+/* Picks the frame a mode 0 command reads out. */
+int Svf10Simulator::begin_mode0()
+{
+    if (next_ >= count_ && loop_)
+        next_ = 0;
+    if (next_ >= count_) {
+        errno = ENODATA;
+        return -1;
+    }
+    mode0_frame_ = frames_ + next_ * SVF10_FRAME_SIZE;
+    mode0_offset_ = 0;
+    next_++;
+    frames_read_++;
+    busy_until_ns_ = 0;
+    idle_state_ = SIM_SLEEP;
+    return 0;
+}
+
+int Svf10Simulator::transfer(struct spi_ioc_transfer* tr, unsigned count)
+{
+    command_e command = selected_;
+    uint64_t bytes = 0;
+    uint64_t wait_us;
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        uint8_t* rx = (uint8_t*) (uintptr_t) tr[i].rx_buf;
+        const uint8_t* tx = (const uint8_t*) (uintptr_t) tr[i].tx_buf;
+
+        bytes += tr[i].len;
+        if (tx) {
+            command = decode(tx, tr[i].len);
+            if (command == CMD_ARM) {
+                busy_state_ = SIM_CAP_N;
+                idle_state_ = SIM_MEM_R;
+                busy_until_ns_ = svf10_monotonic_ns() + (int64_t) timing_.capture_us * 1000;
+            } else if (command == CMD_MODE0) {
+                if (begin_mode0() < 0)
+                    return -1;
+            } else if (command == CMD_OFFSET) {
+                busy_state_ = SIM_CAP_O;
+                idle_state_ = SIM_SLEEP;
+                busy_until_ns_ = svf10_monotonic_ns() + (int64_t) timing_.offset_us * 1000;
+            }
+            /* Nothing comes back while a command is clocked out. */
+            if (rx)
+                memset(rx, 0, tr[i].len);
+        } else if (rx) {
+            if (reply(command, rx, tr[i].len) < 0)
+                return -1;
+        }
+        if (timing_.honour_delays && tr[i].delay_usecs)
+            usleep(tr[i].delay_usecs);
+    }
+
+    selected_ = count && tr[count - 1].cs_change ? command : CMD_NONE;
+
+    wait_us = timing_.message_us + bytes * timing_.byte_ns / 1000;
+    if (wait_us)
+        usleep((useconds_t) wait_us);
+    /* Answer as spidev does, so the check of its result runs here too. */
+    return svf10_spidev_result((int) bytes, tr, count);
+}
@@ -0,0 +1,126 @@
+/*
+ * Simulated SVF10 sensor.
+ *
+ * Svf10Simulator is a Svf10Transport that answers the command sequences
+ * Svf10Device sends the way the sensor does, so the capture, preprocessing
+ * and matching code can run without the device. Mode 0 reads replay
+ * recorded frames, the chip ID and status registers are emulated, and the
+ * sensor state follows the commands with a configurable exposure time.
+ * Replies are encoded for the wire (bit order, the one-bit shift of
+ * register reads and the inverted image data), so the same unpacking runs
+ * as on the device. A message ending with cs_change keeps the sensor
+ * selected, so a mode 0 readout may continue over several messages.
+ * Every message is answered with the byte count spidev would return and
+ * checked with svf10_spidev_result(), as Svf10SpidevTransport checks the
+ * ioctl.
+ */
+
+#ifndef SVF10_SIM_H
+#define SVF10_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "svf10_transport.h"
+#include "svf10_device.h"
+
+/** Timing of the simulated sensor. All zero answers every message
+  * immediately, which is the fastest a pipeline can be driven. */
+typedef struct {
+    /** Fixed cost of every message, in microseconds. */
+    uint32_t message_us;
+    /** Wire time per byte in nanoseconds, 80000 at 100 kHz. */
+    uint32_t byte_ns;
+    /** From arming a capture to the frame being readable (MEM_R). */
+    uint32_t capture_us;
+    /** From the offset capture command to its completion. */
+    uint32_t offset_us;
+    /** Sleep for the delay_usecs of each transfer, as spidev does. */
+    int honour_delays;
+} svf10_sim_timing_t;
+
+/** Approximates the sensor on /dev/spidev1.0 at 100 kHz. */
+extern const svf10_sim_timing_t svf10_sim_timing_device;
+
+class Svf10Simulator : public Svf10Transport {
+public:
+    Svf10Simulator();
+    ~Svf10Simulator();
+
+    /** Loads recorded frames, replacing any loaded before. A frame is the
+      * SVF10_FRAME_SIZE bytes read_frame_mode0() returns. The file is
+      * either the frames back to back, or the "%.2X" per byte hex dump
+      * native-lib can write (whitespace is ignored).
+      *
+      * @return the number of frames loaded, or -1 with errno set. */
+    int load_frames(const char* path);
+
+    /** Copies count frames from memory, replacing any loaded before.
+      *
+      * @return 0 if successful, or -1. */
+    int set_frames(const uint8_t* frames, size_t count);
+
+    size_t frame_count() const { return count_; }
+
+    /** Restarts the replay at the first frame. */
+    void rewind() { next_ = 0; }
+
+    /** Replays from the first frame once every frame has been read, which
+      * is the default. Otherwise a mode 0 read past the last frame fails
+      * with ENODATA. */
+    void set_loop(bool loop) { loop_ = loop; }
+
+    void set_timing(const svf10_sim_timing_t* timing) { timing_ = *timing; }
+
+    /** Sets the reply to the chip ID command, as Svf10Device returns it.
+      * Bit 0 of the first byte is lost in the one-bit shift of register
+      * reads, so the default puts "SVF10P" after a zero byte. */
+    void set_chip_id(const uint8_t* chip_id);
+
+    /** Frames read so far. */
+    uint64_t frames_read() const { return frames_read_; }
+
+    int transfer(struct spi_ioc_transfer* tr, unsigned count);
+
+private:
+    Svf10Simulator(const Svf10Simulator&);
+    Svf10Simulator& operator=(const Svf10Simulator&);
+
+    /* What the last command transfer asked for. */
+    enum command_e {
+        CMD_NONE,
+        CMD_CHIP_ID,
+        CMD_STATUS,
+        CMD_ARM,
+        CMD_OFFSET,
+        CMD_MODE5,
+        CMD_MODE0
+    };
+
+    command_e decode(const uint8_t* tx, uint32_t len);
+    int begin_mode0();
+    int reply(command_e command, uint8_t* rx, uint32_t len);
+    int state();
+
+    uint8_t* frames_;
+    size_t count_;
+    size_t next_;
+    bool loop_;
+    svf10_sim_timing_t timing_;
+    uint8_t chip_id_[SVF10_CHIP_ID_SIZE];
+
+    /* Sensor state: SLV_SUT_* until busy_until_ns, then idle_state_. */
+    int busy_state_;
+    int idle_state_;
+    int64_t busy_until_ns_;
+    bool offset_pending_;
+
+    /* The command chip select is held for after the last message, and the
+     * position of the mode 0 readout in progress. */
+    command_e selected_;
+    const uint8_t* mode0_frame_;
+    uint32_t mode0_offset_;
+
+    uint64_t frames_read_;
+};
+
+#endif /* SVF10_SIM_H */
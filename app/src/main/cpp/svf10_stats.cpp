@@ -0,0 +1,151 @@
+#include <math.h>
+#include <string.h>
+#include "svf10_stats.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SVF10_STATS_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SVF10_STATS_SSE2
+#endif
+
+void svf10_integral_reset(svf10_integral_t* integral)
+{
+    /* Only row 0 is read before it is written. */
+    memset(integral->sum, 0, SVF10_INTEGRAL_STRIDE * sizeof(integral->sum[0]));
+    memset(integral->sum_sq, 0, SVF10_INTEGRAL_STRIDE * sizeof(integral->sum_sq[0]));
+    integral->rows = 0;
+}
+
+void svf10_integral_add_row(svf10_integral_t* integral, const uint8_t* row)
+{
+    const int i = integral->rows;
+    const uint32_t* above = integral->sum + i * SVF10_INTEGRAL_STRIDE;
+    const uint32_t* above_sq = integral->sum_sq + i * SVF10_INTEGRAL_STRIDE;
+    uint32_t* sum = integral->sum + (i + 1) * SVF10_INTEGRAL_STRIDE;
+    uint32_t* sum_sq = integral->sum_sq + (i + 1) * SVF10_INTEGRAL_STRIDE;
+    uint32_t run = 0, run_sq = 0;
+
+    sum[0] = 0;
+    sum_sq[0] = 0;
+    for (int j = 0; j < SVF10_IMAGE_WIDTH; j++) {
+        run += row[j];
+        run_sq += row[j] * row[j];
+        sum[j + 1] = above[j + 1] + run;
+        sum_sq[j + 1] = above_sq[j + 1] + run_sq;
+    }
+    integral->rows = i + 1;
+}
+
+void svf10_integral_build(svf10_integral_t* integral, const uint8_t* src, int src_stride)
+{
+    svf10_integral_reset(integral);
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++)
+        svf10_integral_add_row(integral, src + i * src_stride);
+}
+
+static uint32_t rect(const uint32_t* t, int top, int left, int bottom, int right)
+{
+    return t[bottom * SVF10_INTEGRAL_STRIDE + right] - t[top * SVF10_INTEGRAL_STRIDE + right]
+         - t[bottom * SVF10_INTEGRAL_STRIDE + left] + t[top * SVF10_INTEGRAL_STRIDE + left];
+}
+
+void svf10_integral_stats(const svf10_integral_t* integral,
+                          int top, int left, int height, int width,
+                          svf10_image_stats_t* stats)
+{
+    const double n = (double) height * width;
+
+    stats->sum = rect(integral->sum, top, left, top + height, left + width);
+    stats->sum_sq = rect(integral->sum_sq, top, left, top + height, left + width);
+    stats->mean = stats->sum / n;
+    /* Both products are below 2^53, so the numerator is exact. */
+    stats->variance = ((double) stats->sum_sq * n - (double) stats->sum * stats->sum) / (n * n);
+}
+
+void svf10_coverage(const svf10_integral_t* integral,
+                    double min_variance, int min_blocks,
+                    svf10_coverage_t* coverage)
+{
+    const double mm = SVF10_BLOCK_SIZE * 25.4 / SVF10_RESOLUTION_DPI;
+    svf10_image_stats_t block;
+    double stddev = 0.0, mean = 0.0, q;
+    int n = 0, b = 0;
+
+    for (int by = 0; by < SVF10_BLOCKS_Y; by++) {
+        for (int bx = 0; bx < SVF10_BLOCKS_X; bx++, b++) {
+            svf10_integral_stats(integral, by * SVF10_BLOCK_SIZE, bx * SVF10_BLOCK_SIZE,
+                                 SVF10_BLOCK_SIZE, SVF10_BLOCK_SIZE, &block);
+            coverage->covered[b] = block.variance > min_variance;
+            if (coverage->covered[b]) {
+                n++;
+                stddev += sqrt(block.variance);
+                mean += block.mean;
+            }
+        }
+    }
+
+    coverage->blocks = n;
+    coverage->present = n >= min_blocks;
+    coverage->area_mm2 = n * mm * mm;
+    if (n) {
+        q = stddev / n * 100.0 / SVF10_QUALITY_FULL_STDDEV;
+        coverage->quality = (uint8_t) (q > 100.0 ? 100 : q + 0.5);
+        coverage->condition = (uint8_t) (mean / n * 100.0 / 255.0 + 0.5);
+    } else {
+        coverage->quality = 0;
+        coverage->condition = 50;
+    }
+}
+
+uint32_t svf10_image_sad_ref(const uint8_t* a, int a_stride,
+                             const uint8_t* b, int b_stride)
+{
+    uint32_t sad = 0;
+
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++, a += a_stride, b += b_stride)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j++)
+            sad += a[j] > b[j] ? a[j] - b[j] : b[j] - a[j];
+    return sad;
+}
+
+uint32_t svf10_image_sad(const uint8_t* a, int a_stride,
+                         const uint8_t* b, int b_stride)
+{
+#if defined(SVF10_STATS_NEON)
+    uint32x4_t acc = vdupq_n_u32(0);
+    uint16x8_t row;
+
+    /* A row adds at most 12 * 255 to each 16-bit lane. */
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++, a += a_stride, b += b_stride) {
+        row = vdupq_n_u16(0);
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 16)
+            row = vpadalq_u8(row, vabdq_u8(vld1q_u8(a + j), vld1q_u8(b + j)));
+        acc = vpadalq_u16(acc, row);
+    }
+    return vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+           vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#elif defined(SVF10_STATS_SSE2)
+    __m128i acc = _mm_setzero_si128();
+
+    for (int i = 0; i < SVF10_IMAGE_HEIGHT; i++, a += a_stride, b += b_stride)
+        for (int j = 0; j < SVF10_IMAGE_WIDTH; j += 16)
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*) (a + j)),
+                                                  _mm_loadu_si128((const __m128i*) (b + j))));
+    return (uint32_t) (_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#else
+    return svf10_image_sad_ref(a, a_stride, b, b_stride);
+#endif
+}
+
+const char* svf10_stats_impl(void)
+{
+#if defined(SVF10_STATS_NEON)
+    return "neon";
+#elif defined(SVF10_STATS_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
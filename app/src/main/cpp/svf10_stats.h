@@ -0,0 +1,121 @@
+/*
+ * SVF10 image and block statistics.
+ *
+ * Summed-area tables of the pixels and of their squares give the mean and
+ * variance of any rectangle with four lookups each. They are built one row
+ * at a time, so the pipeline fills them in the sweep that already reads
+ * every row of a frame. A coverage map of 8x8 pixel blocks, finger presence
+ * and the area, quality and condition BMF asks for follow from them at a
+ * cost of a few microseconds per frame.
+ */
+
+#ifndef SVF10_STATS_H
+#define SVF10_STATS_H
+
+#include <stdint.h>
+#include "svf10_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Mean and (population) variance of a 96x96 image, the same values
+  * image_quality() left in temp and temp2. */
+typedef struct {
+    uint32_t sum;
+    uint32_t sum_sq;
+    double mean;
+    double variance;
+} svf10_image_stats_t;
+
+/** Sensor resolution in dots per inch. */
+#define SVF10_RESOLUTION_DPI     500
+
+/** Coverage blocks: SVF10_BLOCK_SIZE square, SVF10_BLOCKS_X across and
+  * SVF10_BLOCKS_Y down. */
+#define SVF10_BLOCK_SIZE         8
+#define SVF10_BLOCKS_X           (SVF10_IMAGE_WIDTH / SVF10_BLOCK_SIZE)
+#define SVF10_BLOCKS_Y           (SVF10_IMAGE_HEIGHT / SVF10_BLOCK_SIZE)
+#define SVF10_BLOCKS             (SVF10_BLOCKS_X * SVF10_BLOCKS_Y)
+
+/** A finger is present when at least this many blocks are covered, a
+  * quarter of the sensor. */
+#define SVF10_PRESENT_BLOCKS     (SVF10_BLOCKS / 4)
+
+/** Block standard deviation that maps to quality 100. */
+#define SVF10_QUALITY_FULL_STDDEV 64
+
+#define SVF10_INTEGRAL_STRIDE    (SVF10_IMAGE_WIDTH + 1)
+
+/** Summed-area tables. Entry (i, j) holds the sum over rows [0, i) and
+  * columns [0, j); row 0 and column 0 are zero. The largest sum of
+  * squares, 96 * 96 * 255^2, fits 32 bits. */
+typedef struct {
+    uint32_t sum[(SVF10_IMAGE_HEIGHT + 1) * SVF10_INTEGRAL_STRIDE];
+    uint32_t sum_sq[(SVF10_IMAGE_HEIGHT + 1) * SVF10_INTEGRAL_STRIDE];
+    /** Rows added since the last reset. */
+    int rows;
+} svf10_integral_t;
+
+/** Empties the tables. */
+void svf10_integral_reset(svf10_integral_t* integral);
+
+/** Adds the next 96-pixel row. At most SVF10_IMAGE_HEIGHT rows may be
+  * added after a reset. */
+void svf10_integral_add_row(svf10_integral_t* integral, const uint8_t* row);
+
+/** Resets the tables and adds all rows of a 96x96 image. */
+void svf10_integral_build(svf10_integral_t* integral, const uint8_t* src, int src_stride);
+
+/** Statistics of the rectangle of height x width pixels at (top, left).
+  * Its rows must have been added. */
+void svf10_integral_stats(const svf10_integral_t* integral,
+                          int top, int left, int height, int width,
+                          svf10_image_stats_t* stats);
+
+/** Coverage of one frame. */
+typedef struct {
+    /** 1 for each block, row by row, whose variance is above the
+      * threshold, i.e. that shows ridges. */
+    uint8_t covered[SVF10_BLOCKS];
+    /** Number of covered blocks. */
+    int blocks;
+    /** Nonzero if blocks >= the presence threshold. */
+    int present;
+    /** Covered area in mm^2, 0 when no block is covered. */
+    double area_mm2;
+    /** Mean standard deviation of the covered blocks, scaled so that
+      * SVF10_QUALITY_FULL_STDDEV is 100 (PB_IMAGE_QUALITY_* range). */
+    uint8_t quality;
+    /** Mean grey level of the covered blocks scaled to 0..100, darker
+      * being wetter (PB_CONDITION_* range). 50 if nothing is covered. */
+    uint8_t condition;
+} svf10_coverage_t;
+
+/** Computes the coverage from complete tables.
+  *
+  * @param[in] min_variance is the block variance a covered block exceeds.
+  * @param[in] min_blocks is the presence threshold in blocks. */
+void svf10_coverage(const svf10_integral_t* integral,
+                    double min_variance, int min_blocks,
+                    svf10_coverage_t* coverage);
+
+/** Sum of absolute differences of two 96x96 images, the frame difference
+  * a finger stability check compares. The largest value, 96 * 96 * 255,
+  * fits 32 bits. */
+uint32_t svf10_image_sad(const uint8_t* a, int a_stride,
+                         const uint8_t* b, int b_stride);
+
+/** Scalar reference implementation of svf10_image_sad(). */
+uint32_t svf10_image_sad_ref(const uint8_t* a, int a_stride,
+                             const uint8_t* b, int b_stride);
+
+/** Returns the name of the vector path compiled in: "neon", "sse2" or
+  * "scalar". */
+const char* svf10_stats_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_STATS_H */
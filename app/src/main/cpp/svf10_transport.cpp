@@ -0,0 +1,77 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "svf10_transport.h"
+
+Svf10SpidevTransport::Svf10SpidevTransport()
+    : fd_(-1)
+{
+}
+
+Svf10SpidevTransport::~Svf10SpidevTransport()
+{
+    close();
+}
+
+int Svf10SpidevTransport::open(const char* path, uint32_t speed_hz)
+{
+    uint8_t mode = SPI_MODE_0;
+    uint8_t bits = 8;
+    uint8_t lsb_first = 0;
+    int fd, saved;
+
+    if (fd_ >= 0)
+        return 0;
+
+    fd = ::open(path, O_RDWR);
+    if (fd < 0)
+        return -1;
+
+    if (ioctl(fd, SPI_IOC_WR_MODE, &mode) == -1 ||
+        ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1 ||
+        ioctl(fd, SPI_IOC_WR_LSB_FIRST, &lsb_first) == -1 ||
+        ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz) == -1) {
+        saved = errno;
+        ::close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    fd_ = fd;
+    return 0;
+}
+
+void Svf10SpidevTransport::close()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int Svf10SpidevTransport::transfer(struct spi_ioc_transfer* tr, unsigned count)
+{
+    if (fd_ < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    /* SPI_IOC_MESSAGE(n) with a run-time n. */
+    return svf10_spidev_result(ioctl(fd_, _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, SPI_MSGSIZE(count)), tr),
+                               tr, count);
+}
+
+int svf10_spidev_result(int ret, const struct spi_ioc_transfer* tr, unsigned count)
+{
+    uint32_t total = 0;
+
+    if (ret < 0)
+        return -1;
+    for (unsigned i = 0; i < count; i++)
+        total += tr[i].len;
+    if ((uint32_t) ret != total) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * SVF10 SPI transport.
+ *
+ * Svf10Device builds spi_ioc_transfer messages and hands them to a
+ * transport. Svf10SpidevTransport sends them to a spidev node with one
+ * SPI_IOC_MESSAGE ioctl; other transports (see svf10_sim.h) answer them
+ * without hardware.
+ */
+
+#ifndef SVF10_TRANSPORT_H
+#define SVF10_TRANSPORT_H
+
+#include <stdint.h>
+#include <linux/spi/spidev.h>
+
+class Svf10Transport {
+public:
+    virtual ~Svf10Transport() {}
+
+    /** Runs one SPI message of count transfers. Chip select, delay_usecs
+      * and the rx buffers follow spidev semantics.
+      *
+      * @return 0 if successful, or -1 with errno set. */
+    virtual int transfer(struct spi_ioc_transfer* tr, unsigned count) = 0;
+};
+
+/** Checks ret, the result of a SPI_IOC_MESSAGE ioctl on the count
+  * transfers of tr. spidev returns the bytes the message moved: 0 for a
+  * message of empty transfers, such as the deselect that ends a mode 0
+  * readout, which is a success. Transports that answer without hardware
+  * pass what spidev would return through the same check.
+  *
+  * @return 0 if ret is the summed length of the transfers, or -1 with
+  *         errno set. */
+int svf10_spidev_result(int ret, const struct spi_ioc_transfer* tr, unsigned count);
+
+class Svf10SpidevTransport : public Svf10Transport {
+public:
+    Svf10SpidevTransport();
+    ~Svf10SpidevTransport();
+
+    /** Opens and configures the spidev node (mode 0, 8 bits, MSB first).
+      * Does nothing if the node is already open.
+      *
+      * @return 0 if successful, or -1 with errno set. */
+    int open(const char* path, uint32_t speed_hz);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    int transfer(struct spi_ioc_transfer* tr, unsigned count);
+
+private:
+    Svf10SpidevTransport(const Svf10SpidevTransport&);
+    Svf10SpidevTransport& operator=(const Svf10SpidevTransport&);
+
+    int fd_;
+};
+
+#endif /* SVF10_TRANSPORT_H */
@@ -0,0 +1,207 @@
+#include "svf10_unpack.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SVF10_UNPACK_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SVF10_UNPACK_SSE2
+#endif
+
+const uint8_t svf10_bit_reverse[256] = {
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
+    0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8,
+    0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+    0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC, 0x3C, 0xBC, 0x7C, 0xFC,
+    0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2, 0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2,
+    0x0A, 0x8A, 0x4A, 0xCA, 0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+    0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6, 0x36, 0xB6, 0x76, 0xF6,
+    0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE, 0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE,
+    0x01, 0x81, 0x41, 0xC1, 0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+    0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9, 0x39, 0xB9, 0x79, 0xF9,
+    0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5, 0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5,
+    0x0D, 0x8D, 0x4D, 0xCD, 0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+    0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3, 0x33, 0xB3, 0x73, 0xF3,
+    0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB, 0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB,
+    0x07, 0x87, 0x47, 0xC7, 0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+    0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF,
+};
+
+/* ------------------------------------------------------------------------- */
+/* Scalar reference implementations                                          */
+/* ------------------------------------------------------------------------- */
+
+static uint8_t reverse_ref(uint8_t input)
+{
+    uint8_t ret = input;
+
+    ret = (ret & 0xF0) >> 4 | (ret & 0x0F) << 4;
+    ret = (ret & 0xCC) >> 2 | (ret & 0x33) << 2;
+    ret = (ret & 0xAA) >> 1 | (ret & 0x55) << 1;
+
+    return ret;
+}
+
+void svf10_unpack_shifted_ref(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    uint8_t prev = 0, cur;
+
+    for (size_t i = 0; i < n; i++) {
+        cur = src[i];
+        dst[i] = reverse_ref((uint8_t) ((cur >> 1) | (prev & 0x01) << 7));
+        prev = cur;
+    }
+}
+
+void svf10_unpack_inverted_ref(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (uint8_t) (255 - reverse_ref(src[i]));
+}
+
+/* ------------------------------------------------------------------------- */
+/* Table driven tail loops                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* reverse((cur >> 1) | (prev & 1) << 7) == reverse(cur) << 1 | prev & 1 */
+static void unpack_shifted_tail(uint8_t* dst, const uint8_t* src, size_t i, size_t n, uint8_t prev)
+{
+    uint8_t cur;
+
+    for (; i < n; i++) {
+        cur = src[i];
+        dst[i] = (uint8_t) (svf10_bit_reverse[cur] << 1 | (prev & 0x01));
+        prev = cur;
+    }
+}
+
+static void unpack_inverted_tail(uint8_t* dst, const uint8_t* src, size_t i, size_t n)
+{
+    for (; i < n; i++)
+        dst[i] = (uint8_t) ~svf10_bit_reverse[src[i]];
+}
+
+/* ------------------------------------------------------------------------- */
+/* Vector implementations                                                    */
+/* ------------------------------------------------------------------------- */
+
+#if defined(SVF10_UNPACK_NEON)
+
+static inline uint8x16_t reverse_u8x16(uint8x16_t v)
+{
+#if defined(__aarch64__)
+    return vrbitq_u8(v);
+#else
+    static const uint8_t nibble[16] = {
+        0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+        0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+    };
+    uint8x8x2_t table = {{ vld1_u8(nibble), vld1_u8(nibble + 8) }};
+    uint8x16_t lo = vandq_u8(v, vdupq_n_u8(0x0F));
+    uint8x16_t hi = vshrq_n_u8(v, 4);
+    uint8x8_t rlo = vorr_u8(vshl_n_u8(vtbl2_u8(table, vget_low_u8(lo)), 4),
+                            vtbl2_u8(table, vget_low_u8(hi)));
+    uint8x8_t rhi = vorr_u8(vshl_n_u8(vtbl2_u8(table, vget_high_u8(lo)), 4),
+                            vtbl2_u8(table, vget_high_u8(hi)));
+    return vcombine_u8(rlo, rhi);
+#endif
+}
+
+void svf10_unpack_shifted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    uint8x16_t prev = vdupq_n_u8(0), v, r, carry;
+    uint8_t last = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        v = vld1q_u8(src + i);
+        last = src[i + 15];
+        r = reverse_u8x16(v);
+        /* Bit 7 of the previous reversed byte is bit 0 of the raw one. */
+        carry = vextq_u8(prev, r, 15);
+        vst1q_u8(dst + i, vorrq_u8(vshlq_n_u8(r, 1), vshrq_n_u8(carry, 7)));
+        prev = r;
+    }
+    unpack_shifted_tail(dst, src, i, n, last);
+}
+
+void svf10_unpack_inverted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+        vst1q_u8(dst + i, vmvnq_u8(reverse_u8x16(vld1q_u8(src + i))));
+    unpack_inverted_tail(dst, src, i, n);
+}
+
+#elif defined(SVF10_UNPACK_SSE2)
+
+static inline __m128i reverse_epi8(__m128i v)
+{
+    const __m128i m0f = _mm_set1_epi8(0x0F);
+    const __m128i m33 = _mm_set1_epi8(0x33);
+    const __m128i m55 = _mm_set1_epi8(0x55);
+
+    /* 16-bit shifts are safe here; the masks drop every bit that crosses
+     * a byte boundary. */
+    v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), m0f), _mm_slli_epi16(_mm_and_si128(v, m0f), 4));
+    v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 2), m33), _mm_slli_epi16(_mm_and_si128(v, m33), 2));
+    v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 1), m55), _mm_slli_epi16(_mm_and_si128(v, m55), 1));
+    return v;
+}
+
+void svf10_unpack_shifted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    const __m128i one = _mm_set1_epi8(0x01);
+    __m128i prev = _mm_setzero_si128(), r, carry;
+    uint8_t last = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        r = reverse_epi8(_mm_loadu_si128((const __m128i*) (src + i)));
+        last = src[i + 15];
+        /* Bit 7 of the previous reversed byte is bit 0 of the raw one. */
+        carry = _mm_or_si128(_mm_slli_si128(r, 1), _mm_srli_si128(prev, 15));
+        carry = _mm_and_si128(_mm_srli_epi16(carry, 7), one);
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(_mm_add_epi8(r, r), carry));
+        prev = r;
+    }
+    unpack_shifted_tail(dst, src, i, n, last);
+}
+
+void svf10_unpack_inverted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    const __m128i ones = _mm_set1_epi8((char) 0xFF);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i r = reverse_epi8(_mm_loadu_si128((const __m128i*) (src + i)));
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_xor_si128(r, ones));
+    }
+    unpack_inverted_tail(dst, src, i, n);
+}
+
+#else
+
+void svf10_unpack_shifted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    unpack_shifted_tail(dst, src, 0, n, 0);
+}
+
+void svf10_unpack_inverted(uint8_t* dst, const uint8_t* src, size_t n)
+{
+    unpack_inverted_tail(dst, src, 0, n);
+}
+
+#endif
+
+const char* svf10_unpack_impl(void)
+{
+#if defined(SVF10_UNPACK_NEON)
+    return "neon";
+#elif defined(SVF10_UNPACK_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
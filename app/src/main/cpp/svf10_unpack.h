@@ -0,0 +1,46 @@
+/*
+ * SVF10 SPI payload unpacking.
+ *
+ * The SVF10 shifts its reply out LSB first and one clock late, so every
+ * received byte holds seven bits of its own value and one bit of the
+ * previous byte. These functions undo both over a whole buffer at once.
+ */
+
+#ifndef SVF10_UNPACK_H
+#define SVF10_UNPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Bit-reversal table, svf10_bit_reverse[x] is x with bit order swapped. */
+extern const uint8_t svf10_bit_reverse[256];
+
+/** Realigns a register or memory read:
+  *
+  *   dst[0] = reverse(src[0] >> 1)
+  *   dst[i] = reverse((src[i] >> 1) | (src[i - 1] & 0x01) << 7)
+  *
+  * dst may be the same buffer as src. */
+void svf10_unpack_shifted(uint8_t* dst, const uint8_t* src, size_t n);
+
+/** Converts a mode 0 image read: dst[i] = 255 - reverse(src[i]).
+  * dst may be the same buffer as src. */
+void svf10_unpack_inverted(uint8_t* dst, const uint8_t* src, size_t n);
+
+/** Scalar reference implementations of the above. */
+void svf10_unpack_shifted_ref(uint8_t* dst, const uint8_t* src, size_t n);
+void svf10_unpack_inverted_ref(uint8_t* dst, const uint8_t* src, size_t n);
+
+/** Returns the name of the vector path compiled in: "neon", "sse2" or
+  * "scalar". */
+const char* svf10_unpack_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_UNPACK_H */
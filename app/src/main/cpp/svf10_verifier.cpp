@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "svf10_verifier.h"
+#include "svf10_algorithm.h"
+#include "pb_match_result.h"
+
+struct svf10_verifier_st {
+    /* One algorithm per thread; the workers hold theirs for their lifetime
+     * and the calling thread takes the one left over. */
+    svf10_algorithm_pool_t* pool;
+    int nworkers;
+    pthread_t workers[SVF10_VERIFIER_MAX_THREADS - 1];
+
+    /* Held for a whole verification, so calls run one at a time. */
+    pthread_mutex_t call_lock;
+
+    /* lock guards everything below. A new verification bumps generation
+     * and wakes the workers on work_cond; the caller waits on done_cond
+     * for the shards still running. */
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    uint32_t generation;
+    int exit;
+
+    pb_template_t** enrolled;
+    int nenrolled;
+    const pb_template_t* T;
+    pb_far_t far;
+    /* Next shard to take, shards being verified, the enrolled index that
+     * accepted (-1 while none has) and the first error. */
+    int next;
+    int nshards;
+    int running;
+    int found;
+    pb_rc_t error;
+};
+
+/* Takes and verifies shards until none is left or one has accepted.
+ * Called and returns with the lock held. */
+static void run_shards(svf10_verifier_t* v, pb_algorithm_t* algorithm)
+{
+    pb_match_result_t* result;
+    pb_rc_t rc;
+    int first, n, matched;
+
+    while (v->found < 0 && v->next < v->nshards) {
+        first = v->next++ * SVF10_VERIFIER_SHARD;
+        n = v->nenrolled - first;
+        if (n > SVF10_VERIFIER_SHARD)
+            n = SVF10_VERIFIER_SHARD;
+        v->running++;
+        pthread_mutex_unlock(&v->lock);
+
+        /* The job stays put while a shard of it is running. */
+        result = 0;
+        matched = -1;
+        rc = pb_algorithm_verify_templates_ex(algorithm, v->enrolled + first, (uint8_t) n,
+                                              v->T, v->far, &result);
+        if (rc == PB_RC_OK && pb_match_result_get_decision(result) == PB_DECISION_MATCH) {
+            matched = pb_match_result_get_matching_template_index(result);
+            matched = first + (matched >= 0 && matched < n ? matched : 0);
+        }
+        pb_match_result_delete(result);
+
+        pthread_mutex_lock(&v->lock);
+        if (matched >= 0 && v->found < 0)
+            v->found = matched;
+        if (rc != PB_RC_OK && v->error == PB_RC_OK)
+            v->error = rc;
+        if (--v->running == 0)
+            pthread_cond_signal(&v->done_cond);
+    }
+}
+
+static void* worker_main(void* arg)
+{
+    svf10_verifier_t* v = (svf10_verifier_t*) arg;
+    pb_algorithm_t* algorithm = svf10_algorithm_pool_get(v->pool);
+    uint32_t seen;
+
+    pthread_mutex_lock(&v->lock);
+    seen = v->generation;
+    for (;;) {
+        while (!v->exit && v->generation == seen)
+            pthread_cond_wait(&v->work_cond, &v->lock);
+        if (v->exit)
+            break;
+        seen = v->generation;
+        run_shards(v, algorithm);
+    }
+    pthread_mutex_unlock(&v->lock);
+
+    svf10_algorithm_pool_put(v->pool, algorithm);
+    return 0;
+}
+
+svf10_verifier_t* svf10_verifier_create(const pb_algorithmI* algorithm, int nthreads)
+{
+    svf10_verifier_t* v;
+
+    if (nthreads <= 0 || nthreads > SVF10_VERIFIER_MAX_THREADS)
+        return 0;
+
+    v = (svf10_verifier_t*) calloc(1, sizeof(*v));
+    if (!v)
+        return 0;
+    v->pool = svf10_algorithm_pool_create(algorithm, nthreads);
+    if (!v->pool) {
+        free(v);
+        return 0;
+    }
+    pthread_mutex_init(&v->call_lock, 0);
+    pthread_mutex_init(&v->lock, 0);
+    pthread_cond_init(&v->work_cond, 0);
+    pthread_cond_init(&v->done_cond, 0);
+
+    for (; v->nworkers < nthreads - 1; v->nworkers++)
+        if (pthread_create(&v->workers[v->nworkers], 0, worker_main, v) != 0) {
+            svf10_verifier_delete(v);
+            return 0;
+        }
+    return v;
+}
+
+void svf10_verifier_delete(svf10_verifier_t* verifier)
+{
+    if (!verifier)
+        return;
+
+    pthread_mutex_lock(&verifier->lock);
+    verifier->exit = 1;
+    pthread_cond_broadcast(&verifier->work_cond);
+    pthread_mutex_unlock(&verifier->lock);
+    for (int i = 0; i < verifier->nworkers; i++)
+        pthread_join(verifier->workers[i], 0);
+
+    svf10_algorithm_pool_delete(verifier->pool);
+    pthread_cond_destroy(&verifier->done_cond);
+    pthread_cond_destroy(&verifier->work_cond);
+    pthread_mutex_destroy(&verifier->lock);
+    pthread_mutex_destroy(&verifier->call_lock);
+    free(verifier);
+}
+
+pb_rc_t svf10_verifier_verify(svf10_verifier_t* verifier,
+                              pb_template_t* enrolled[],
+                              int nenrolled,
+                              const pb_template_t* T,
+                              pb_far_t false_accept_rate,
+                              int* decision,
+                              int* index)
+{
+    svf10_verifier_t* v = verifier;
+    pb_algorithm_t* algorithm;
+    pb_rc_t rc;
+    int found;
+
+    if (!v || !T || !decision || nenrolled < 0 || (nenrolled && !enrolled))
+        return PB_RC_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&v->call_lock);
+    algorithm = svf10_algorithm_pool_get(v->pool);
+
+    pthread_mutex_lock(&v->lock);
+    v->enrolled = enrolled;
+    v->nenrolled = nenrolled;
+    v->T = T;
+    v->far = false_accept_rate;
+    v->next = 0;
+    v->nshards = (nenrolled + SVF10_VERIFIER_SHARD - 1) / SVF10_VERIFIER_SHARD;
+    v->found = -1;
+    v->error = PB_RC_OK;
+    v->generation++;
+    /* A single shard is quicker verified here than handed over. */
+    if (v->nshards > 1)
+        pthread_cond_broadcast(&v->work_cond);
+
+    run_shards(v, algorithm);
+    while (v->running)
+        pthread_cond_wait(&v->done_cond, &v->lock);
+    found = v->found;
+    rc = found >= 0 ? PB_RC_OK : v->error;
+    pthread_mutex_unlock(&v->lock);
+
+    svf10_algorithm_pool_put(v->pool, algorithm);
+    pthread_mutex_unlock(&v->call_lock);
+
+    *decision = found >= 0 ? PB_DECISION_MATCH : PB_DECISION_NON_MATCH;
+    if (index)
+        *index = found;
+    return rc;
+}
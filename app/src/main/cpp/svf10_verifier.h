@@ -0,0 +1,73 @@
+/*
+ * SVF10 gallery verifier.
+ *
+ * Verifies one template against a gallery of enrolled templates too large
+ * for one pb_algorithm_verify_templates() call to answer quickly. The
+ * gallery is cut into shards of SVF10_VERIFIER_SHARD templates which the
+ * calling thread and the verifier's worker threads take in turn, each
+ * with an algorithm of its own, and verify with
+ * pb_algorithm_verify_templates_ex(). The first shard to accept ends the
+ * verification: shards not yet taken are skipped, shards already running
+ * finish but their results are ignored.
+ *
+ * Any accept at the requested FAR ends the search, so with more than one
+ * thread the template reported is the first to be found, not necessarily
+ * the lowest index that would have matched.
+ */
+
+#ifndef SVF10_VERIFIER_H
+#define SVF10_VERIFIER_H
+
+#include "pb_algorithmI.h"
+#include "pb_algorithm.h"
+#include "pb_verifierI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Enrolled templates per pb_algorithm_verify_templates_ex() call. Small
+  * enough that a found match stops the other threads soon, large enough
+  * that the per-call cost of BMF stays small next to the matching. */
+#define SVF10_VERIFIER_SHARD        8
+
+/** Most threads a verifier runs, the calling thread included. */
+#define SVF10_VERIFIER_MAX_THREADS  8
+
+typedef struct svf10_verifier_st svf10_verifier_t;
+
+/** Creates a verifier running nthreads threads, the calling thread of
+  * svf10_verifier_verify() being one of them, each with a warm algorithm
+  * of the given kind (see svf10_algorithm.h).
+  *
+  * @return the verifier, or 0 if the algorithms or threads could not be
+  *         created. */
+svf10_verifier_t* svf10_verifier_create(const pb_algorithmI* algorithm, int nthreads);
+
+/** Stops the worker threads and deletes the verifier. No verification may
+  * be running. */
+void svf10_verifier_delete(svf10_verifier_t* verifier);
+
+/** Verifies T against the nenrolled templates of enrolled. Thread safe;
+  * concurrent calls run one after the other.
+  *
+  * @param[out] decision is PB_DECISION_MATCH if any enrolled template
+  *             accepted T at false_accept_rate, else PB_DECISION_NON_MATCH.
+  * @param[out] index is the index into enrolled of the template that
+  *             accepted, or -1. May be 0 if not needed.
+  *
+  * @return PB_RC_OK if a decision was reached. If a shard failed and no
+  *         other shard accepted, that shard's error. */
+pb_rc_t svf10_verifier_verify(svf10_verifier_t* verifier,
+                              pb_template_t* enrolled[],
+                              int nenrolled,
+                              const pb_template_t* T,
+                              pb_far_t false_accept_rate,
+                              int* decision,
+                              int* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SVF10_VERIFIER_H */
@@ -46,6 +46,8 @@ public class MainActivity extends AppCompatActivity {
 
     private TextView mTextView;
     private int nFrame = 0;
+    // Reused for every frame; FPLoop draws into it instead of allocating.
+    private Bitmap fpBitmap = Bitmap.createBitmap(96, 96, Bitmap.Config.ARGB_8888);
 
     Handler handler = new Handler() {
         @Override
@@ -55,8 +57,12 @@ public class MainActivity extends AppCompatActivity {
     };
 
     void getFingerPrint() {
-        Bitmap bitmap = BitmapFactory.decodeResource(getResources(), R.drawable.dummy);
-        ivFP.setImageBitmap(FPLoop(bitmap));
+        // null for a missed frame: keep showing, and reusing, the last one.
+        Bitmap bitmap = FPLoop(fpBitmap);
+        if (bitmap != null) {
+            fpBitmap = bitmap;
+            ivFP.setImageBitmap(bitmap);
+        }
         //int temp = test();
         /*
         int threshold = 0;
@@ -197,6 +203,9 @@ public class MainActivity extends AppCompatActivity {
     public native String SpiOpen(int r1, int r2,int r3, int r4,int r5, int r6,int r7, int r8,int r9, int r10,int r11, int r12,int r13, int r14);
     public native Bitmap FPLoop(Bitmap bitmap);
     public native int FPgetTemp2();
+    public native int FPGetFrame(java.nio.ByteBuffer buffer);
+    public native int FPStartCapture();
+    public native void FPStopCapture();
     public native int test();
 //    public native String PBTest(int id);
 }
@@ -20,6 +20,8 @@ public class SenvisService extends Service{
         System.loadLibrary("native-lib2");
     }
     private MyThread2 mythread;
+    // Reused for every frame; FPLoop draws into it instead of allocating.
+    private Bitmap fpBitmap = Bitmap.createBitmap(96, 96, Bitmap.Config.ARGB_8888);
 
     @Override
     public IBinder onBind(Intent arg0) {
@@ -46,6 +48,7 @@ public class SenvisService extends Service{
                 0,
                 100,
                 10);
+        FPStartCapture();
         mythread = new MyThread2();
         mythread.start();
         Log.d("ShinJAE", "onCreate");
@@ -55,6 +58,7 @@ public class SenvisService extends Service{
     public void onDestroy() {
         // TODO Auto-generated method stub
         super.onDestroy();
+        FPStopCapture();
         mythread.flag = false;
         mythread = null;
         Log.d("ShinJAE", "onDestroy");
@@ -82,8 +86,7 @@ public class SenvisService extends Service{
             {
                 //Log.d("ShinJAE", String.valueOf(test()));
                 try {
-                    Bitmap bitmap = BitmapFactory.decodeResource(getResources(), R.drawable.dummy);
-                    Bitmap bitmap2 = FPLoop(bitmap);
+                    Bitmap bitmap2 = FPLoop(fpBitmap);
                     /*
                     try{
 
@@ -117,6 +120,9 @@ public class SenvisService extends Service{
 */
     public native String SpiOpen(int r1, int r2,int r3, int r4,int r5, int r6,int r7, int r8,int r9, int r10,int r11, int r12,int r13, int r14);
     public native Bitmap FPLoop(Bitmap bitmap);
+    public native int FPGetFrame(java.nio.ByteBuffer buffer);
+    public native int FPStartCapture();
+    public native void FPStopCapture();
     public native int test();
     public native int fin();
 }